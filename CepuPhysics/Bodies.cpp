@@ -4,6 +4,8 @@
 #include "CollisionDetection/BroadPhase.h"
 #include "BodySet.h"
 #include "BodyDescription.h"
+#include "CollisionDetection/BoundingBoxBatcher.h"
+#include "Threading/IThreadDispatcher.h"
 
 using namespace CepuUtil;
 
@@ -42,6 +44,34 @@ namespace CepuPhysics
     }
   }
 
+  void Bodies::PredictBoundingBoxes(float dt, CepuUtil::IThreadDispatcher* threadDispatcher)
+  {
+    auto bodyCount = GetActiveSet()->m_Count;
+    //Bodies are handed out to workers in contiguous blocks so each worker streams through its own stretch of the active set.
+    const int32_t BODIES_PER_JOB = 1024;
+    auto jobCount = (bodyCount + BODIES_PER_JOB - 1) / BODIES_PER_JOB;
+    if (threadDispatcher != nullptr && threadDispatcher->GetThreadCount() > 1 && jobCount > 1) {
+      int32_t jobIndex = -1;
+      threadDispatcher->DispatchWorkers([&](int32_t workerIndex) {
+        BoundingBoxBatcher batcher(this, m_Shapes, m_BroadPhase, threadDispatcher->GetThreadMemoryPool(workerIndex), dt);
+        int32_t claimedJobIndex;
+        while ((claimedJobIndex = CepuUtil::Interlocked::Increment(jobIndex)) < jobCount) {
+          auto start = claimedJobIndex * BODIES_PER_JOB;
+          auto end = glm::min(start + BODIES_PER_JOB, bodyCount);
+          for (int32_t i = start; i < end; ++i)
+            batcher.Add(i);
+        }
+        batcher.Flush();
+      }, jobCount);
+    }
+    else {
+      BoundingBoxBatcher batcher(this, m_Shapes, m_BroadPhase, m_Pool, dt);
+      for (int32_t i = 0; i < bodyCount; ++i)
+        batcher.Add(i);
+      batcher.Flush();
+    }
+  }
+
   void Bodies::AddCollidableToBroadPhase(BodyHandle bodyHandle, const RigidPose& pose, const BodyInertia& localInertia, Collidable& io_collidable)
   {
     assert(io_collidable.m_Shape.Exists());
@@ -77,6 +107,30 @@ namespace CepuPhysics
     }
   }
 
+  void Bodies::RemoveCollidablesFromBroadPhase(const CepuUtil::Buffer<int32_t>& broadPhaseIndices)
+  {
+    if (broadPhaseIndices.GetLength() == 0)
+      return;
+    auto oldLeafCount = m_BroadPhase->m_ActiveTree.m_LeafCount;
+    Buffer<int32_t> leafIndexRemap;
+    m_BroadPhase->RemoveActiveRange(broadPhaseIndices, leafIndexRemap);
+    //Leaves keep their order, so nothing before the first removed leaf moved.
+    auto firstRemovedIndex = broadPhaseIndices[0];
+    for (int32_t i = 1; i < broadPhaseIndices.GetLength(); ++i)
+      firstRemovedIndex = glm::min(firstRemovedIndex, broadPhaseIndices[i]);
+    for (int32_t i = firstRemovedIndex; i < oldLeafCount; ++i) {
+      auto newIndex = leafIndexRemap[i];
+      if (newIndex >= 0 && newIndex != i) {
+        //Only active bodies live in the active tree.
+        auto movedLeaf = m_BroadPhase->m_ActiveLeaves[newIndex];
+        assert(movedLeaf.GetMobility() != CollidableMobility::STATIC);
+        UpdateCollidableBroadPhaseIndex(movedLeaf.GetBodyHandle(), newIndex);
+      }
+    }
+    //The broad phase took the remap from its own pool.
+    m_BroadPhase->m_Pool->Return(leafIndexRemap);
+  }
+
   BodyHandle Bodies::Add(const BodyDescription& desc)
   {
     assert(m_HandleToLocation.IsAllocated() && "The backing memory of the bodies set should be initialized before use");
@@ -4,6 +4,11 @@
 #include "BodyMemoryLocation.h"
 #include "BodyReference.h"
 
+namespace CepuUtil
+{
+  class IThreadDispatcher;
+}
+
 namespace CepuPhysics
 {
   class Shapes;
@@ -22,9 +27,15 @@ namespace CepuPhysics
     void Initialize();
 
     void UpdateBounds(BodyHandle bodyHandle);
+    //Recomputes the bounds of every active body in batches, expanded to cover the motion predicted over the next dt, and writes them into the broad phase's active tree without refitting it.
+    //Also sets every active collidable's speculative margin. The tree is only valid again after the next BroadPhase::Update, which refits it in full.
+    void PredictBoundingBoxes(float dt, CepuUtil::IThreadDispatcher* threadDispatcher = nullptr);
     void AddCollidableToBroadPhase(BodyHandle bodyHandle, const RigidPose& pose, const BodyInertia& localInertia, Collidable& io_collidable);
     void UpdateCollidableBroadPhaseIndex(BodyHandle handle, int32_t newBroadPhaseIndex);
     void RemoveCollidableFromBroadPhase(const Collidable& collidable);
+    //Removes many active collidables from the broad phase in one pass and updates the broad phase index of every collidable whose leaf moved.
+    //Body removal isn't ported yet (RemoveAt and Remove have no definitions), so like RemoveCollidableFromBroadPhase this has no caller in the library yet.
+    void RemoveCollidablesFromBroadPhase(const CepuUtil::Buffer<int32_t>& broadPhaseIndices);
     BodyHandle Add(const BodyDescription& desc);
     void RemoveAt(int32_t activeBodyIndex);
     void Remove(BodyHandle handle);
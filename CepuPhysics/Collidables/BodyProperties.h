@@ -1,4 +1,6 @@
 #pragma once
+#include "Math/Vector3Wide.h"
+#include "Math/QuaternionWide.h"
 
 namespace CepuPhysics
 {
@@ -54,7 +56,34 @@ namespace CepuPhysics
 
   struct RigidPoseWide
   {
-    //@TODO (alektron)
+    static RigidPoseWide Broadcast(const RigidPose& pose)
+    {
+      RigidPoseWide result;
+      result.m_Position    = CepuUtil::Vector3Wide::Broadcast(pose.m_Position);
+      result.m_Orientation = CepuUtil::QuaternionWide::Broadcast(pose.m_Orientation);
+      return result;
+    }
+
+    void WriteSlot(int32_t slotIndex, const RigidPose& pose)
+    {
+      m_Position.WriteSlot(slotIndex, pose.m_Position);
+      m_Orientation.WriteSlot(slotIndex, pose.m_Orientation);
+    }
+
+    CepuUtil::Vector3Wide m_Position;
+    CepuUtil::QuaternionWide m_Orientation;
+  };
+
+  struct BodyVelocityWide
+  {
+    void WriteSlot(int32_t slotIndex, const BodyVelocity& velocity)
+    {
+      m_Linear.WriteSlot(slotIndex, velocity.m_Linear);
+      m_Angular.WriteSlot(slotIndex, velocity.m_Angular);
+    }
+
+    CepuUtil::Vector3Wide m_Linear;
+    CepuUtil::Vector3Wide m_Angular;
   };
 
   struct BodyActivity
@@ -1,5 +1,6 @@
 #include "CepuPhysicsPCH.h"
 #include "Box.h"
+#include "Trees/RayData.h"
 
 namespace CepuPhysics
 {
@@ -13,12 +14,28 @@ namespace CepuPhysics
     o_min = -o_max;
   }
 
+  void BoxWide::ComputeBounds(const CepuUtil::QuaternionWide& orientations, CepuUtil::Vector3Wide& o_min, CepuUtil::Vector3Wide& o_max) const
+  {
+    CepuUtil::Matrix3x3Wide basis;
+    CepuUtil::Matrix3x3Wide::CreateFromQuaternion(orientations, basis);
+    auto x = m_HalfWidth  * basis.m_X;
+    auto y = m_HalfHeight * basis.m_Y;
+    auto z = m_HalfLength * basis.m_Z;
+    o_max = CepuUtil::Vector3Wide::Abs(x) + CepuUtil::Vector3Wide::Abs(y) + CepuUtil::Vector3Wide::Abs(z);
+    o_min = -o_max;
+  }
+
+  void BoxWide::ComputeAngularExpansionData(CepuUtil::Vector& o_maximumRadius, CepuUtil::Vector& o_maximumAngularExpansion) const
+  {
+    o_maximumRadius = CepuUtil::Sqrt(m_HalfWidth * m_HalfWidth + m_HalfHeight * m_HalfHeight + m_HalfLength * m_HalfLength);
+    o_maximumAngularExpansion = o_maximumRadius - CepuUtil::Min(m_HalfWidth, CepuUtil::Min(m_HalfHeight, m_HalfLength));
+  }
+
   void Box::ComputeAngularExpansionData(float& o_maximumRadius, float& o_maximumAngularExpansion)
   {
     o_maximumRadius = glm::sqrt(m_HalfWidth * m_HalfWidth + m_HalfHeight * m_HalfHeight + m_HalfLength * m_HalfLength);
 
-    //@ (alektron) That seems a bit weird...why create vectors if a scalar would do?
-    o_maximumAngularExpansion = o_maximumRadius - glm::min(glm::vec4(m_HalfLength), glm::min(glm::vec4(m_HalfHeight), glm::vec4(m_HalfLength))).x;
+    o_maximumAngularExpansion = o_maximumRadius - glm::min(m_HalfWidth, glm::min(m_HalfHeight, m_HalfLength));
   }
 
   BodyInertia Box::ComputeInertia(float mass)
@@ -28,7 +45,26 @@ namespace CepuPhysics
 
   bool Box::RayTest(const RigidPose& pose, const glm::vec3& origin, const glm::vec3& direction, float& o_t, glm::vec3& o_normal)
   {
-    throw;
-    return false;
+    //Slab test in the box's local space. o_t is in units of the given direction's length, since rotation doesn't change it.
+    auto inverseOrientation = glm::conjugate(pose.m_Orientation);
+    auto localOrigin = inverseOrientation * (origin - pose.m_Position);
+    auto localDirection = inverseOrientation * direction;
+    glm::vec3 halfExtents(m_HalfWidth, m_HalfHeight, m_HalfLength);
+    auto inverseDirection = TreeRay::ComputeInverseDirection(localDirection);
+    auto t0 = (-halfExtents - localOrigin) * inverseDirection;
+    auto t1 = (halfExtents - localOrigin) * inverseDirection;
+    auto tEntry = glm::min(t0, t1);
+    auto tExit = glm::max(t0, t1);
+    auto exit = glm::min(tExit.x, glm::min(tExit.y, tExit.z));
+    int32_t entryAxis = tEntry.x > tEntry.y ? (tEntry.x > tEntry.z ? 0 : 2) : (tEntry.y > tEntry.z ? 1 : 2);
+    auto entry = tEntry[entryAxis];
+    if (entry > exit || exit < 0)
+      return false;
+    //Rays starting inside the box hit it immediately. The normal still comes from the last slab entered, which is the closest face behind the origin.
+    o_t = glm::max(0.f, entry);
+    glm::vec3 localNormal(0);
+    localNormal[entryAxis] = inverseDirection[entryAxis] < 0 ? 1.f : -1.f;
+    o_normal = pose.m_Orientation * localNormal;
+    return true;
   }
 }
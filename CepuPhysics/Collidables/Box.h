@@ -1,13 +1,18 @@
 #pragma once
 #include "IShape.h"
+#include "Math/Matrix3x3Wide.h"
 
 namespace CepuPhysics
 {
+  struct BoxWide;
+
   struct Box : public IConvexShape
   {
+    using Wide = BoxWide;
+
     Box() = default; //@ (alektron) We do not actually want a default constructor but we have to until we solve the "GetTypeId is not static" issue
     Box(float width, float height, float length)
-      : m_HalfWidth(width * 0.5f), m_HalfHeight(height * 0.5f), m_HalfLength(height * 0.5f) {}
+      : m_HalfWidth(width * 0.5f), m_HalfHeight(height * 0.5f), m_HalfLength(length * 0.5f) {}
 
     virtual int32_t GetTypeId() override { return 2; }; //@ (alektron) Can we make this a static function somehow? It never seems to be called on any object instance
     virtual void ComputeBounds(const glm::quat& orientation, glm::vec3& o_min, glm::vec3& o_max) override;
@@ -29,4 +34,24 @@ namespace CepuPhysics
     float m_HalfHeight = 0;
     float m_HalfLength = 0;
   };
+
+  //Vector.COUNT boxes stored component-wise, for computing the bounds of many boxes at once.
+  struct BoxWide
+  {
+    void WriteSlot(int32_t slotIndex, const Box& source)
+    {
+      m_HalfWidth [slotIndex] = source.m_HalfWidth;
+      m_HalfHeight[slotIndex] = source.m_HalfHeight;
+      m_HalfLength[slotIndex] = source.m_HalfLength;
+    }
+
+    //Wide counterpart of Box::ComputeBounds. Bounds are relative to the box's position.
+    void ComputeBounds(const CepuUtil::QuaternionWide& orientations, CepuUtil::Vector3Wide& o_min, CepuUtil::Vector3Wide& o_max) const;
+    //Wide counterpart of Box::ComputeAngularExpansionData.
+    void ComputeAngularExpansionData(CepuUtil::Vector& o_maximumRadius, CepuUtil::Vector& o_maximumAngularExpansion) const;
+
+    CepuUtil::Vector m_HalfWidth;
+    CepuUtil::Vector m_HalfHeight;
+    CepuUtil::Vector m_HalfLength;
+  };
 }
@@ -0,0 +1,119 @@
+#include "CepuPhysicsPCH.h"
+#include "Capsule.h"
+
+namespace CepuPhysics
+{
+  void Capsule::ComputeBounds(const glm::quat& orientation, glm::vec3& o_min, glm::vec3& o_max)
+  {
+    auto segmentOffset = m_HalfLength * (orientation * glm::vec3(0, 1, 0));
+    o_max = glm::abs(segmentOffset) + glm::vec3(m_Radius);
+    o_min = -o_max;
+  }
+
+  void CapsuleWide::ComputeBounds(const CepuUtil::QuaternionWide& orientations, CepuUtil::Vector3Wide& o_min, CepuUtil::Vector3Wide& o_max) const
+  {
+    CepuUtil::Matrix3x3Wide basis;
+    CepuUtil::Matrix3x3Wide::CreateFromQuaternion(orientations, basis);
+    o_max = CepuUtil::Vector3Wide::Abs(m_HalfLength * basis.m_Y) + m_Radius;
+    o_min = -o_max;
+  }
+
+  void CapsuleWide::ComputeAngularExpansionData(CepuUtil::Vector& o_maximumRadius, CepuUtil::Vector& o_maximumAngularExpansion) const
+  {
+    o_maximumRadius = m_HalfLength + m_Radius;
+    o_maximumAngularExpansion = m_HalfLength;
+  }
+
+  void Capsule::ComputeAngularExpansionData(float& o_maximumRadius, float& o_maximumAngularExpansion)
+  {
+    o_maximumRadius = m_HalfLength + m_Radius;
+    //The surface closest to the center is the side of the cylinder at m_Radius; the farthest is the tip of a cap.
+    o_maximumAngularExpansion = m_HalfLength;
+  }
+
+  BodyInertia Capsule::ComputeInertia(float mass)
+  {
+    //The mass is split between the cylinder and the two hemispheres by volume. The hemispheres' contribution about the X and Z axes
+    //includes the parallel axis offset of their centers of mass from the capsule's center.
+    auto radiusSquared = m_Radius * m_Radius;
+    auto halfLengthSquared = m_HalfLength * m_HalfLength;
+    auto cylinderVolume = 2 * m_HalfLength * radiusSquared * glm::pi<float>();
+    auto sphereVolume = (4.f / 3.f) * radiusSquared * m_Radius * glm::pi<float>();
+    auto inverseTotalVolume = 1.f / (cylinderVolume + sphereVolume);
+    cylinderVolume *= inverseTotalVolume;
+    sphereVolume *= inverseTotalVolume;
+
+    BodyInertia inertia;
+    inertia.m_InverseMass = 1.f / mass;
+    auto inverseXZ = inertia.m_InverseMass / (
+      cylinderVolume * ((3.f / 12.f) * radiusSquared + (4.f / 12.f) * halfLengthSquared) +
+      sphereVolume * ((2.f / 5.f) * radiusSquared + (6.f / 8.f) * m_Radius * m_HalfLength + halfLengthSquared));
+    auto inverseY = inertia.m_InverseMass / (cylinderVolume * (1.f / 2.f) * radiusSquared + sphereVolume * (2.f / 5.f) * radiusSquared);
+    inertia.m_InverseInertiaTensor = glm::mat3(0);
+    inertia.m_InverseInertiaTensor[0][0] = inverseXZ;
+    inertia.m_InverseInertiaTensor[1][1] = inverseY;
+    inertia.m_InverseInertiaTensor[2][2] = inverseXZ;
+    return inertia;
+  }
+
+  bool Capsule::RayTest(const RigidPose& pose, const glm::vec3& origin, const glm::vec3& direction, float& o_t, glm::vec3& o_normal)
+  {
+    //Works in the capsule's local space with the direction left unnormalized, so o_t is in units of the given direction's length.
+    auto inverseOrientation = glm::conjugate(pose.m_Orientation);
+    auto localOrigin = inverseOrientation * (origin - pose.m_Position);
+    auto localDirection = inverseOrientation * direction;
+    auto radiusSquared = m_Radius * m_Radius;
+
+    //Rays starting inside the capsule hit it immediately, with the normal pointing away from the internal segment.
+    auto originToSegment = localOrigin - glm::vec3(0, glm::clamp(localOrigin.y, -m_HalfLength, m_HalfLength), 0);
+    auto originToSegmentLengthSquared = glm::dot(originToSegment, originToSegment);
+    if (originToSegmentLengthSquared <= radiusSquared) {
+      o_t = 0;
+      auto localNormal = originToSegmentLengthSquared > 1e-14f ? originToSegment / glm::sqrt(originToSegmentLengthSquared) : -glm::normalize(localDirection);
+      o_normal = pose.m_Orientation * localNormal;
+      return true;
+    }
+
+    //Test the infinite cylinder around the segment first. If it's entered between the segment's endpoints, that's the hit;
+    //otherwise the only candidate left is the cap on the side where the ray entered.
+    auto directionLengthSquared = glm::dot(localDirection, localDirection);
+    auto a = localDirection.x * localDirection.x + localDirection.z * localDirection.z;
+    auto b = localOrigin.x * localDirection.x + localOrigin.z * localDirection.z;
+    auto c = localOrigin.x * localOrigin.x + localOrigin.z * localOrigin.z - radiusSquared;
+    if (c > 0 && b >= 0)
+      return false;
+    float capY;
+    if (a > 1e-12f * directionLengthSquared) {
+      auto discriminant = b * b - a * c;
+      if (discriminant < 0)
+        return false;
+      //An origin inside the infinite cylinder but beyond a cap has already entered it.
+      auto t = glm::max(0.f, (-b - glm::sqrt(discriminant)) / a);
+      auto hit = localOrigin + localDirection * t;
+      if (hit.y >= -m_HalfLength && hit.y <= m_HalfLength) {
+        o_t = t;
+        o_normal = pose.m_Orientation * (glm::vec3(hit.x, 0, hit.z) / m_Radius);
+        return true;
+      }
+      capY = hit.y < 0 ? -m_HalfLength : m_HalfLength;
+    }
+    else {
+      //Running parallel to the axis; only rays inside the infinite cylinder, and so beyond a cap, can hit.
+      if (c > 0)
+        return false;
+      capY = localOrigin.y < 0 ? -m_HalfLength : m_HalfLength;
+    }
+
+    auto capOffset = localOrigin - glm::vec3(0, capY, 0);
+    auto capB = glm::dot(capOffset, localDirection);
+    auto capC = glm::dot(capOffset, capOffset) - radiusSquared;
+    if (capB >= 0 && capC > 0)
+      return false;
+    auto capDiscriminant = capB * capB - directionLengthSquared * capC;
+    if (capDiscriminant < 0)
+      return false;
+    o_t = (-capB - glm::sqrt(capDiscriminant)) / directionLengthSquared;
+    o_normal = pose.m_Orientation * ((capOffset + localDirection * o_t) / m_Radius);
+    return true;
+  }
+}
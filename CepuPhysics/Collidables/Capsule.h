@@ -0,0 +1,51 @@
+#pragma once
+#include "IShape.h"
+#include "Math/Matrix3x3Wide.h"
+
+namespace CepuPhysics
+{
+  struct CapsuleWide;
+
+  //Swept sphere whose internal line segment runs along the local Y axis.
+  struct Capsule : public IConvexShape
+  {
+    using Wide = CapsuleWide;
+
+    Capsule() = default;
+    Capsule(float radius, float length)
+      : m_Radius(radius), m_HalfLength(length * 0.5f) {}
+
+    virtual int32_t GetTypeId() override { return 1; };
+    virtual void ComputeBounds(const glm::quat& orientation, glm::vec3& o_min, glm::vec3& o_max) override;
+    virtual void ComputeAngularExpansionData(float& o_maximumRadius, float& o_maximumAngularExpansion) override;
+    virtual BodyInertia ComputeInertia(float mass) override;
+    virtual bool RayTest(const RigidPose& pose, const glm::vec3& origin, const glm::vec3& direction, float& o_t, glm::vec3& o_normal) override;
+
+    virtual ShapeBatch* CreateShapeBatch(CepuUtil::BufferPool* pool, int32_t initialCapacity) override;
+
+    //Length of the internal line segment, not counting the caps.
+    float GetLength() { return m_HalfLength * 2; }
+    void SetLength(float v) { m_HalfLength = v * 0.5f; }
+
+    float m_Radius     = 0;
+    float m_HalfLength = 0;
+  };
+
+  //Vector.COUNT capsules stored component-wise, for computing the bounds of many capsules at once.
+  struct CapsuleWide
+  {
+    void WriteSlot(int32_t slotIndex, const Capsule& source)
+    {
+      m_Radius    [slotIndex] = source.m_Radius;
+      m_HalfLength[slotIndex] = source.m_HalfLength;
+    }
+
+    //Wide counterpart of Capsule::ComputeBounds. Bounds are relative to the capsule's position.
+    void ComputeBounds(const CepuUtil::QuaternionWide& orientations, CepuUtil::Vector3Wide& o_min, CepuUtil::Vector3Wide& o_max) const;
+    //Wide counterpart of Capsule::ComputeAngularExpansionData.
+    void ComputeAngularExpansionData(CepuUtil::Vector& o_maximumRadius, CepuUtil::Vector& o_maximumAngularExpansion) const;
+
+    CepuUtil::Vector m_Radius;
+    CepuUtil::Vector m_HalfLength;
+  };
+}
@@ -18,6 +18,37 @@ namespace CepuPhysics
     float m_SweepConvergenceThreshold = 0;
 
     bool AllowExpansionBeyondSpeculativeMargin() const { return (int)m_Mode > 0; }
+
+    //Bounding boxes are expanded by velocity only up to the speculative margin. Cheapest option; fast movers can tunnel.
+    static ContinuousDetection Discrete(float minimumSpeculativeMargin = 0, float maximumSpeculativeMargin = std::numeric_limits<float>::max())
+    {
+      ContinuousDetection result;
+      result.m_Mode = ContinuousDetectionMode::DISCRETE;
+      result.m_MinimumSpeculativeMargin = minimumSpeculativeMargin;
+      result.m_MaximumSpeculativeMargin = maximumSpeculativeMargin;
+      return result;
+    }
+
+    //Bounding boxes are expanded by the full predicted motion, so pairs are found even if they're further apart than the speculative margin.
+    static ContinuousDetection Passive(float minimumSpeculativeMargin = 0, float maximumSpeculativeMargin = std::numeric_limits<float>::max())
+    {
+      ContinuousDetection result = Discrete(minimumSpeculativeMargin, maximumSpeculativeMargin);
+      result.m_Mode = ContinuousDetectionMode::PASSIVE;
+      return result;
+    }
+
+    //Like Passive, but the collidable is also meant to be swept along its motion to find its time of first impact, so it can't tunnel.
+    //BroadPhase::Sweep finds the candidates. The sweep parameters tune the shape sweeps run against them: the smallest time step a sweep subdivides into,
+    //and the distance below which a sweep counts as converged.
+    static ContinuousDetection Continuous(float minimumSweepTimestep = 1e-3f, float sweepConvergenceThreshold = 1e-3f,
+      float minimumSpeculativeMargin = 0, float maximumSpeculativeMargin = std::numeric_limits<float>::max())
+    {
+      ContinuousDetection result = Discrete(minimumSpeculativeMargin, maximumSpeculativeMargin);
+      result.m_Mode = ContinuousDetectionMode::CONTINUOUS;
+      result.m_MinimumSweepTimestep = minimumSweepTimestep;
+      result.m_SweepConvergenceThreshold = sweepConvergenceThreshold;
+      return result;
+    }
   };
 
   struct Collidable
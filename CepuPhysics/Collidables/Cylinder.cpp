@@ -0,0 +1,128 @@
+#include "CepuPhysicsPCH.h"
+#include "Cylinder.h"
+
+namespace CepuPhysics
+{
+  void Cylinder::ComputeBounds(const glm::quat& orientation, glm::vec3& o_min, glm::vec3& o_max)
+  {
+    //The cap discs reach r * sqrt(1 - axis[i]^2) along world axis i, on top of the axis' own half length extent.
+    auto axis = orientation * glm::vec3(0, 1, 0);
+    auto discExtents = m_Radius * glm::sqrt(glm::max(glm::vec3(0), glm::vec3(1) - axis * axis));
+    o_max = glm::abs(m_HalfLength * axis) + discExtents;
+    o_min = -o_max;
+  }
+
+  void CylinderWide::ComputeBounds(const CepuUtil::QuaternionWide& orientations, CepuUtil::Vector3Wide& o_min, CepuUtil::Vector3Wide& o_max) const
+  {
+    CepuUtil::Matrix3x3Wide basis;
+    CepuUtil::Matrix3x3Wide::CreateFromQuaternion(orientations, basis);
+    auto& axis = basis.m_Y;
+    CepuUtil::Vector zero(0.f), one(1.f);
+    CepuUtil::Vector3Wide discExtents(
+      m_Radius * CepuUtil::Sqrt(CepuUtil::Max(zero, one - axis.m_X * axis.m_X)),
+      m_Radius * CepuUtil::Sqrt(CepuUtil::Max(zero, one - axis.m_Y * axis.m_Y)),
+      m_Radius * CepuUtil::Sqrt(CepuUtil::Max(zero, one - axis.m_Z * axis.m_Z)));
+    o_max = CepuUtil::Vector3Wide::Abs(m_HalfLength * axis) + discExtents;
+    o_min = -o_max;
+  }
+
+  void CylinderWide::ComputeAngularExpansionData(CepuUtil::Vector& o_maximumRadius, CepuUtil::Vector& o_maximumAngularExpansion) const
+  {
+    o_maximumRadius = CepuUtil::Sqrt(m_HalfLength * m_HalfLength + m_Radius * m_Radius);
+    o_maximumAngularExpansion = o_maximumRadius - CepuUtil::Min(m_HalfLength, m_Radius);
+  }
+
+  void Cylinder::ComputeAngularExpansionData(float& o_maximumRadius, float& o_maximumAngularExpansion)
+  {
+    o_maximumRadius = glm::sqrt(m_HalfLength * m_HalfLength + m_Radius * m_Radius);
+    o_maximumAngularExpansion = o_maximumRadius - glm::min(m_HalfLength, m_Radius);
+  }
+
+  BodyInertia Cylinder::ComputeInertia(float mass)
+  {
+    BodyInertia inertia;
+    inertia.m_InverseMass = 1.f / mass;
+    auto radiusSquared = m_Radius * m_Radius;
+    auto inverseXZ = inertia.m_InverseMass / ((1.f / 12.f) * (3 * radiusSquared + 4 * m_HalfLength * m_HalfLength));
+    auto inverseY = inertia.m_InverseMass / (0.5f * radiusSquared);
+    inertia.m_InverseInertiaTensor = glm::mat3(0);
+    inertia.m_InverseInertiaTensor[0][0] = inverseXZ;
+    inertia.m_InverseInertiaTensor[1][1] = inverseY;
+    inertia.m_InverseInertiaTensor[2][2] = inverseXZ;
+    return inertia;
+  }
+
+  bool Cylinder::RayTest(const RigidPose& pose, const glm::vec3& origin, const glm::vec3& direction, float& o_t, glm::vec3& o_normal)
+  {
+    //Intersects the ray with the slab between the caps and with the infinite cylinder around the axis, in the cylinder's local space.
+    //The direction is left unnormalized, so o_t is in units of the given direction's length.
+    auto inverseOrientation = glm::conjugate(pose.m_Orientation);
+    auto localOrigin = inverseOrientation * (origin - pose.m_Position);
+    auto localDirection = inverseOrientation * direction;
+    auto radiusSquared = m_Radius * m_Radius;
+
+    auto radialDistanceSquared = localOrigin.x * localOrigin.x + localOrigin.z * localOrigin.z;
+    if (radialDistanceSquared <= radiusSquared && glm::abs(localOrigin.y) <= m_HalfLength) {
+      //Rays starting inside the cylinder hit it immediately. Like Box::RayTest, the normal comes from the nearest surface.
+      o_t = 0;
+      auto radialDistance = glm::sqrt(radialDistanceSquared);
+      glm::vec3 localNormal;
+      if (m_HalfLength - glm::abs(localOrigin.y) < m_Radius - radialDistance || radialDistance < 1e-7f)
+        localNormal = glm::vec3(0, localOrigin.y < 0 ? -1.f : 1.f, 0);
+      else
+        localNormal = glm::vec3(localOrigin.x, 0, localOrigin.z) / radialDistance;
+      o_normal = pose.m_Orientation * localNormal;
+      return true;
+    }
+
+    float capEntry, capExit;
+    if (glm::abs(localDirection.y) > 1e-15f) {
+      auto inverseDirectionY = 1.f / localDirection.y;
+      auto t0 = (-m_HalfLength - localOrigin.y) * inverseDirectionY;
+      auto t1 = (m_HalfLength - localOrigin.y) * inverseDirectionY;
+      capEntry = glm::min(t0, t1);
+      capExit = glm::max(t0, t1);
+    }
+    else {
+      if (glm::abs(localOrigin.y) > m_HalfLength)
+        return false;
+      capEntry = -std::numeric_limits<float>::max();
+      capExit = std::numeric_limits<float>::max();
+    }
+
+    float sideEntry, sideExit;
+    auto a = localDirection.x * localDirection.x + localDirection.z * localDirection.z;
+    auto b = localOrigin.x * localDirection.x + localOrigin.z * localDirection.z;
+    auto c = radialDistanceSquared - radiusSquared;
+    if (a > 1e-12f * glm::dot(localDirection, localDirection)) {
+      auto discriminant = b * b - a * c;
+      if (discriminant < 0)
+        return false;
+      auto root = glm::sqrt(discriminant);
+      sideEntry = (-b - root) / a;
+      sideExit = (-b + root) / a;
+    }
+    else {
+      if (c > 0)
+        return false;
+      sideEntry = -std::numeric_limits<float>::max();
+      sideExit = std::numeric_limits<float>::max();
+    }
+
+    auto entry = glm::max(capEntry, sideEntry);
+    auto exit = glm::min(capExit, sideExit);
+    if (entry > exit || exit < 0)
+      return false;
+    o_t = glm::max(0.f, entry);
+    glm::vec3 localNormal;
+    if (capEntry > sideEntry) {
+      localNormal = glm::vec3(0, localDirection.y < 0 ? 1.f : -1.f, 0);
+    }
+    else {
+      auto hit = localOrigin + localDirection * o_t;
+      localNormal = glm::vec3(hit.x, 0, hit.z) / m_Radius;
+    }
+    o_normal = pose.m_Orientation * localNormal;
+    return true;
+  }
+}
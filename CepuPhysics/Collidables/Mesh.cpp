@@ -0,0 +1,115 @@
+#include "CepuPhysicsPCH.h"
+#include "Mesh.h"
+#include "Trees/Tree_RayCast.h"
+
+using namespace CepuUtil;
+
+namespace CepuPhysics
+{
+  //Two sided ray/triangle test. o_normal is the unnormalized face normal, flipped to face the ray's origin.
+  static bool RayTestTriangle(const Triangle& triangle, const glm::vec3& origin, const glm::vec3& direction, float maximumT, float& o_t, glm::vec3& o_normal)
+  {
+    //Solves origin + direction * t = A + AB * v + AC * w by Cramer's rule.
+    auto ab = triangle.m_B - triangle.m_A;
+    auto ac = triangle.m_C - triangle.m_A;
+    auto normal = glm::cross(ab, ac);
+    auto determinant = -glm::dot(direction, normal);
+    //Rays parallel to the plane and degenerate triangles can't be hit.
+    if (determinant == 0)
+      return false;
+    auto inverseDeterminant = 1.f / determinant;
+    auto ao = origin - triangle.m_A;
+    auto t = glm::dot(ao, normal) * inverseDeterminant;
+    if (t < 0 || t > maximumT)
+      return false;
+    auto e = glm::cross(ao, direction);
+    auto v = glm::dot(ac, e) * inverseDeterminant;
+    auto w = -glm::dot(ab, e) * inverseDeterminant;
+    if (v < 0 || w < 0 || v + w > 1)
+      return false;
+    o_t = t;
+    o_normal = determinant > 0 ? normal : -normal;
+    return true;
+  }
+
+  Mesh::Mesh(const Buffer<Triangle>& triangles, const glm::vec3& scale, BufferPool& pool)
+    : m_Triangles(triangles), m_Tree(pool, triangles.GetLength())
+  {
+    assert(triangles.GetLength() > 0 && "Meshes need at least one triangle.");
+    SetScale(scale);
+    Buffer<BoundingBox> leafBounds;
+    pool.Take(triangles.GetLength(), leafBounds);
+    for (int32_t i = 0; i < triangles.GetLength(); ++i) {
+      auto& triangle = triangles[i];
+      leafBounds[i].m_Min = glm::min(triangle.m_A, glm::min(triangle.m_B, triangle.m_C));
+      leafBounds[i].m_Max = glm::max(triangle.m_A, glm::max(triangle.m_B, triangle.m_C));
+    }
+    m_Tree.BuildFrom(leafBounds, pool);
+    pool.Return(leafBounds);
+  }
+
+  void Mesh::SetScale(const glm::vec3& scale)
+  {
+    assert(scale.x != 0 && scale.y != 0 && scale.z != 0 && "Mesh scale components must be nonzero.");
+    m_Scale = scale;
+    m_InverseScale = glm::vec3(1) / scale;
+  }
+
+  void Mesh::ComputeBounds(const glm::quat& orientation, glm::vec3& o_min, glm::vec3& o_max) const
+  {
+    glm::mat3 basis(orientation);
+    o_min = glm::vec3(std::numeric_limits<float>::max());
+    o_max = glm::vec3(-std::numeric_limits<float>::max());
+    for (int32_t i = 0; i < m_Triangles.GetLength(); ++i) {
+      Triangle triangle;
+      GetLocalTriangle(i, triangle);
+      auto a = basis * triangle.m_A;
+      auto b = basis * triangle.m_B;
+      auto c = basis * triangle.m_C;
+      o_min = glm::min(o_min, glm::min(a, glm::min(b, c)));
+      o_max = glm::max(o_max, glm::max(a, glm::max(b, c)));
+    }
+  }
+
+  bool Mesh::RayTest(const RigidPose& pose, const glm::vec3& origin, const glm::vec3& direction, float& o_t, glm::vec3& o_normal) const
+  {
+    struct LeafTester
+    {
+      const Mesh* m_Mesh;
+      float m_T;
+      glm::vec3 m_Normal;
+      bool m_Hit;
+
+      void TestLeaf(int32_t leafIndex, const RayData& ray, float& maximumT)
+      {
+        float t;
+        glm::vec3 normal;
+        if (RayTestTriangle(m_Mesh->m_Triangles[leafIndex], ray.Origin, ray.Direction, maximumT, t, normal)) {
+          maximumT = t;
+          m_T = t;
+          m_Normal = normal;
+          m_Hit = true;
+        }
+      }
+    };
+    //The tree and triangles are unscaled, so the ray is taken into unscaled local space. Scaling is affine, so t is the same in every space.
+    auto inverseOrientation = glm::conjugate(pose.m_Orientation);
+    auto localOrigin = (inverseOrientation * (origin - pose.m_Position)) * m_InverseScale;
+    auto localDirection = (inverseOrientation * direction) * m_InverseScale;
+    LeafTester tester{ this, 0, glm::vec3(0), false };
+    auto maximumT = std::numeric_limits<float>::max();
+    CepuPhysics::RayCast(m_Tree, localOrigin, localDirection, maximumT, tester);
+    if (!tester.m_Hit)
+      return false;
+    o_t = tester.m_T;
+    //Normals transform by the inverse transpose, which for a scale is the inverse scale.
+    o_normal = pose.m_Orientation * glm::normalize(tester.m_Normal * m_InverseScale);
+    return true;
+  }
+
+  void Mesh::Dispose(BufferPool& pool)
+  {
+    pool.Return(m_Triangles);
+    m_Tree.Dispose(pool);
+  }
+}
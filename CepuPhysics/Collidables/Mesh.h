@@ -0,0 +1,64 @@
+#pragma once
+#include "IShape.h"
+#include "Trees/Tree_VolumeQueries.h"
+
+namespace CepuPhysics
+{
+  struct Triangle
+  {
+    glm::vec3 m_A;
+    glm::vec3 m_B;
+    glm::vec3 m_C;
+  };
+
+  //Triangle soup meant for static level geometry. The triangles are indexed by a Tree of the mesh's own, built in one pass with the binned SAH builder;
+  //leaf i of the tree is triangle i, so tree queries report triangle indices directly.
+  //Triangles are stored unscaled and the mesh's scale is applied on the fly, so rescaling a mesh doesn't require a rebuild.
+  //Meshes are not convex and have no inertia; they're meant for statics and kinematics.
+  struct Mesh : public IShape
+  {
+    Mesh() = default;
+    //Takes ownership of the triangles, which must come from the given pool and hold exactly the mesh's triangles. Dispose returns them along with the tree.
+    Mesh(const CepuUtil::Buffer<Triangle>& triangles, const glm::vec3& scale, CepuUtil::BufferPool& pool);
+
+    virtual int32_t GetTypeId() override { return 8; };
+    virtual ShapeBatch* CreateShapeBatch(CepuUtil::BufferPool* pool, int32_t initialCapacity) override;
+
+    //Bounds of the scaled mesh under the given orientation, relative to its position. Every vertex is visited, so this is linear in the triangle count.
+    void ComputeBounds(const glm::quat& orientation, glm::vec3& o_min, glm::vec3& o_max) const;
+    //Returns the closest hit of the ray against the mesh's triangles. Triangles are two sided; the normal faces the ray's origin.
+    bool RayTest(const RigidPose& pose, const glm::vec3& origin, const glm::vec3& direction, float& o_t, glm::vec3& o_normal) const;
+
+    //Reports the index of every triangle whose bounds overlap the given bounds, which are in the mesh's local (scaled) space, through results.Handle(int32_t triangleIndex).
+    //Same handler protocol as the tree's volume queries: returning false stops the query, and the query then returns false too.
+    template<typename TLeafHandler>
+    bool FindLocalOverlaps(const glm::vec3& min, const glm::vec3& max, TLeafHandler& results) const
+    {
+      //Negative scales flip the bounds.
+      auto unscaledA = min * m_InverseScale;
+      auto unscaledB = max * m_InverseScale;
+      return GetOverlaps(m_Tree, CepuUtil::BoundingBox{ glm::min(unscaledA, unscaledB), glm::max(unscaledA, unscaledB) }, results);
+    }
+
+    //Gets the triangle at the given index with the mesh's scale applied.
+    void GetLocalTriangle(int32_t triangleIndex, Triangle& o_triangle) const
+    {
+      auto& source = m_Triangles[triangleIndex];
+      o_triangle.m_A = source.m_A * m_Scale;
+      o_triangle.m_B = source.m_B * m_Scale;
+      o_triangle.m_C = source.m_C * m_Scale;
+    }
+
+    const glm::vec3& GetScale() const { return m_Scale; }
+    void SetScale(const glm::vec3& scale);
+
+    void Dispose(CepuUtil::BufferPool& pool);
+
+    CepuUtil::Buffer<Triangle> m_Triangles;
+    Tree m_Tree;
+
+  private:
+    glm::vec3 m_Scale = glm::vec3(1);
+    glm::vec3 m_InverseScale = glm::vec3(1);
+  };
+}
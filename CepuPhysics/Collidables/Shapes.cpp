@@ -1,21 +1,86 @@
 #include "CepuPhysicsPCH.h"
 #include "Shapes.h"
 #include "BodyProperties.h"
+#include "Sphere.h"
+#include "Capsule.h"
 #include "Box.h"
+#include "Cylinder.h"
+#include "Mesh.h"
 
 namespace CepuPhysics
 {
 
+  void ShapeBatch::Remove(int32_t index)
+  {
+    m_IdPool.Return(index, m_Pool);
+  }
+
+  void ShapeBatch::RemoveAndDsiapose(int32_t index, CepuUtil::BufferPool* pool)
+  {
+    Dispose(index, pool);
+    Remove(index);
+  }
+
+  void ShapeBatch::RecursivelyRemoveAndDispose(int32_t index, Shapes* shapes, CepuUtil::BufferPool* pool)
+  {
+    RemoveAndDisposeChildren(index, shapes, pool);
+    RemoveAndDsiapose(index, pool);
+  }
+
+  void ShapeBatch::GetShapeData(int32_t shapeIndex, void** shapePointer, int32_t& o_shapeSize)
+  {
+    *shapePointer = m_ShapesData.m_Memory + m_ShapeDataSize * shapeIndex;
+    o_shapeSize = m_ShapeDataSize;
+  }
+
   void Shapes::ComputeBounds(const RigidPose& pose, TypedIndex shapeIndex, CepuUtil::BoundingBox& o_bounds) const
   {
     //Note: the min and max here are in absolute coordinates, which means this is a spot that has to be updated in the event that positions use a higher precision representation.
     m_Batches[shapeIndex.GetType()]->ComputeBounds(shapeIndex.GetIndex(), pose, o_bounds.m_Min, o_bounds.m_Max);
   }
 
+  void Shapes::Remove(TypedIndex shapeIndex)
+  {
+    if (shapeIndex.Exists())
+      m_Batches[shapeIndex.GetType()]->Remove(shapeIndex.GetIndex());
+  }
+
+  void Shapes::RemoveAndDispose(TypedIndex shapeIndex, CepuUtil::BufferPool* pool)
+  {
+    if (shapeIndex.Exists())
+      m_Batches[shapeIndex.GetType()]->RemoveAndDsiapose(shapeIndex.GetIndex(), pool);
+  }
+
+  void Shapes::RecursivelyRemoveAndDispose(TypedIndex shapeIndex, CepuUtil::BufferPool* pool)
+  {
+    if (shapeIndex.Exists())
+      m_Batches[shapeIndex.GetType()]->RecursivelyRemoveAndDispose(shapeIndex.GetIndex(), this, pool);
+  }
+
+
+  ShapeBatch* Sphere::CreateShapeBatch(CepuUtil::BufferPool* pool, int32_t initialCapacity)
+  {
+    return new ConvexShapeBatch<Sphere>(pool, initialCapacity);
+  }
+
+  ShapeBatch* Capsule::CreateShapeBatch(CepuUtil::BufferPool* pool, int32_t initialCapacity)
+  {
+    return new ConvexShapeBatch<Capsule>(pool, initialCapacity);
+  }
 
   ShapeBatch* Box::CreateShapeBatch(CepuUtil::BufferPool* pool, int32_t initialCapacity)
   {
     return new ConvexShapeBatch<Box>(pool, initialCapacity);
   }
+
+  ShapeBatch* Cylinder::CreateShapeBatch(CepuUtil::BufferPool* pool, int32_t initialCapacity)
+  {
+    return new ConvexShapeBatch<Cylinder>(pool, initialCapacity);
+  }
+
+  ShapeBatch* Mesh::CreateShapeBatch(CepuUtil::BufferPool* pool, int32_t initialCapacity)
+  {
+    return new HomogeneousCompoundShapeBatch<Mesh>(pool, initialCapacity);
+  }
 }
 
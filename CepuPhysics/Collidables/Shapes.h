@@ -1,6 +1,7 @@
 #pragma once
 #include "Memory/IdPool.h"
 #include "BodyProperties.h"
+#include "CollisionDetection/BoundingBoxBatcher.h"
 
 namespace CepuPhysics
 {
@@ -17,19 +18,17 @@ namespace CepuPhysics
     void RemoveAndDsiapose(int32_t index, CepuUtil::BufferPool* pool);
     void RecursivelyRemoveAndDispose(int32_t index, Shapes* shapes, CepuUtil::BufferPool* pool);
 
-    //virtual void ComputeBounds(const BoundingBoxBatcher& batcher) = 0;
+    virtual void ComputeBounds(BoundingBoxBatcher& batcher) = 0;
     virtual void ComputeBounds(int32_t shapeIndex, const RigidPose& pose, glm::vec3& o_min, glm::vec3& o_max) = 0;
     virtual void ComputeBounds(int32_t shapeIndex, const glm::quat& orientation, float& o_maximumRadius, float& o_maximumAngularExpansion, glm::vec3& o_min, glm::vec3& o_max)
     {
       throw "Nonconvex shapes are not required to have a maximum radius or angular expansion implementation. This should only ever be called on convexes.";
     }
 
-    //template<typename TRayHitHandler>
-    //struct RayTester
-    //{
-    //  virtual void RayTest(int32_t shapeIndex, in RigidPose pose, in RayData ray, ref float maximumT, ref TRayHitHandler hitHandler);
-    //  virtual void RayTest(int32_t shapeIndex, in RigidPose rigidPose, ref RaySource rays, ref TRayHitHandler hitHandler);
-    //};
+    //@DEVIATION Bepu uses a generic RayTester with a hit handler per shape batch. Here the batch reports the hit straight back to the caller;
+    //traversing a tree with many rays at once is RayBatcher's job.
+    //Returns whether the ray hits the shape at the given pose, along with the hit's t (in units of the direction's length) and surface normal.
+    virtual bool RayTest(int32_t shapeIndex, const RigidPose& pose, const glm::vec3& origin, const glm::vec3& direction, float& o_t, glm::vec3& o_normal) = 0;
 
     void GetShapeData(int32_t shapeIndex, void** shapePointer, int32_t& o_shapeSize);
     virtual void Clear() = 0;
@@ -142,7 +141,7 @@ namespace CepuPhysics
     virtual void Dispose(int32_t index, CepuUtil::BufferPool* pool) override { /*Most convex shapes with an associated Wide type doesn't have any internal resources to dispose.*/ };
     virtual void RemoveAndDisposeChildren(int32_t index, Shapes* shapes, CepuUtil::BufferPool* pool) override { /*And they don't have any children*/ };
 
-    //virtual void ComputeBounds(const BoundingBoxBatcher& batcher) override;
+    virtual void ComputeBounds(BoundingBoxBatcher& batcher) override { batcher.ExecuteConvexBatch(*this); }
     virtual void ComputeBounds(int32_t shapeIndex, const RigidPose& pose, glm::vec3& o_min, glm::vec3& o_max) override
     {
       this->m_Shapes[shapeIndex].ComputeBounds(pose.m_Orientation, o_min, o_max);
@@ -156,6 +155,65 @@ namespace CepuPhysics
       shape.ComputeBounds(orientation, o_min, o_max);
       shape.ComputeAngularExpansionData(o_maximumRadius, o_angularExpansion);
     }
+
+    virtual bool RayTest(int32_t shapeIndex, const RigidPose& pose, const glm::vec3& origin, const glm::vec3& direction, float& o_t, glm::vec3& o_normal) override
+    {
+      return this->m_Shapes[shapeIndex].RayTest(pose, origin, direction, o_t, o_normal);
+    }
+  };
+
+  //Batch for shapes like meshes that own their children outright. The children aren't registered in Shapes, so there's nothing to recurse into,
+  //but each instance holds pool memory that Dispose hands back.
+  //TShape needs ComputeBounds(const glm::quat&, glm::vec3&, glm::vec3&), the convex RayTest signature and Dispose(BufferPool&).
+  template<typename TShape>
+  class HomogeneousCompoundShapeBatch : public ShapeBatchT<TShape>
+  {
+  public:
+    HomogeneousCompoundShapeBatch(CepuUtil::BufferPool* pool, int32_t initialShapeCount) : ShapeBatchT<TShape>(pool, initialShapeCount)
+    {
+      this->m_Compound = true;
+    }
+    virtual ~HomogeneousCompoundShapeBatch() override { DisposeClaimedShapes(); }
+    virtual void Clear() override
+    {
+      DisposeClaimedShapes();
+      ShapeBatchT<TShape>::Clear();
+    }
+    virtual void Dispose(int32_t index, CepuUtil::BufferPool* pool) override { this->m_Shapes[index].Dispose(*pool); }
+    virtual void RemoveAndDisposeChildren(int32_t index, Shapes* shapes, CepuUtil::BufferPool* pool) override { /*The children go with the shape's own Dispose.*/ };
+
+    virtual void ComputeBounds(BoundingBoxBatcher& batcher) override { batcher.ExecuteHomogeneousCompoundBatch(*this); }
+    virtual void ComputeBounds(int32_t shapeIndex, const RigidPose& pose, glm::vec3& o_min, glm::vec3& o_max) override
+    {
+      this->m_Shapes[shapeIndex].ComputeBounds(pose.m_Orientation, o_min, o_max);
+      o_min += pose.m_Position;
+      o_max += pose.m_Position;
+    }
+
+    virtual bool RayTest(int32_t shapeIndex, const RigidPose& pose, const glm::vec3& origin, const glm::vec3& direction, float& o_t, glm::vec3& o_normal) override
+    {
+      return this->m_Shapes[shapeIndex].RayTest(pose, origin, direction, o_t, o_normal);
+    }
+
+  private:
+    //Unlike convex shapes, these can't just be forgotten when the batch goes away. Ids waiting in the id pool were disposed when they were removed.
+    void DisposeClaimedShapes()
+    {
+      auto& idPool = this->m_IdPool;
+      auto slotCount = idPool.GetHighestPossiblyClaimedId() + 1;
+      if (slotCount == 0)
+        return;
+      CepuUtil::Buffer<bool> available;
+      this->m_Pool->Take(slotCount, available);
+      available.Clear(0, slotCount);
+      for (int32_t i = 0; i < idPool.m_AvailableIdCount; ++i)
+        available[idPool.m_AvailableIds[i]] = true;
+      for (int32_t i = 0; i < slotCount; ++i) {
+        if (!available[i])
+          Dispose(i, this->m_Pool);
+      }
+      this->m_Pool->Return(available);
+    }
   };
 
   class Shapes
@@ -172,6 +230,15 @@ namespace CepuPhysics
     //Since it only calls ComputeBounds functions anyways we're going with that for consistency
     void ComputeBounds(const RigidPose& pose, TypedIndex shapeIndex, CepuUtil::BoundingBox& o_bounds) const;
 
+    //Frees the shape's slot without releasing anything it owns.
+    void Remove(TypedIndex shapeIndex);
+    //Frees the shape's slot and returns any memory the shape owns (like a mesh's triangles and tree) to the pool. Child shapes registered in Shapes are left alone.
+    void RemoveAndDispose(TypedIndex shapeIndex, CepuUtil::BufferPool* pool);
+    //Same as RemoveAndDispose, but also removes and disposes any child shapes registered in Shapes.
+    void RecursivelyRemoveAndDispose(TypedIndex shapeIndex, CepuUtil::BufferPool* pool);
+
+    ShapeBatch* GetBatch(int32_t typeIndex) const { assert(typeIndex >= 0 && typeIndex < MAX_SHAPE_BATCHES); return m_Batches[typeIndex]; }
+
     template<typename TShape>
     TShape& GetShape(int32_t shapeIndex)
     {
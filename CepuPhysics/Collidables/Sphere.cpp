@@ -0,0 +1,59 @@
+#include "CepuPhysicsPCH.h"
+#include "Sphere.h"
+
+namespace CepuPhysics
+{
+  void Sphere::ComputeBounds(const glm::quat& orientation, glm::vec3& o_min, glm::vec3& o_max)
+  {
+    o_max = glm::vec3(m_Radius);
+    o_min = -o_max;
+  }
+
+  void SphereWide::ComputeBounds(const CepuUtil::QuaternionWide& orientations, CepuUtil::Vector3Wide& o_min, CepuUtil::Vector3Wide& o_max) const
+  {
+    o_max = CepuUtil::Vector3Wide(m_Radius, m_Radius, m_Radius);
+    o_min = -o_max;
+  }
+
+  void SphereWide::ComputeAngularExpansionData(CepuUtil::Vector& o_maximumRadius, CepuUtil::Vector& o_maximumAngularExpansion) const
+  {
+    //Spheres look the same from every angle, so rotation never moves their surface.
+    o_maximumRadius = m_Radius;
+    o_maximumAngularExpansion = CepuUtil::Vector(0.f);
+  }
+
+  void Sphere::ComputeAngularExpansionData(float& o_maximumRadius, float& o_maximumAngularExpansion)
+  {
+    o_maximumRadius = m_Radius;
+    o_maximumAngularExpansion = 0;
+  }
+
+  BodyInertia Sphere::ComputeInertia(float mass)
+  {
+    BodyInertia inertia;
+    inertia.m_InverseMass = 1.f / mass;
+    inertia.m_InverseInertiaTensor = glm::mat3(inertia.m_InverseMass / ((2.f / 5.f) * m_Radius * m_Radius));
+    return inertia;
+  }
+
+  bool Sphere::RayTest(const RigidPose& pose, const glm::vec3& origin, const glm::vec3& direction, float& o_t, glm::vec3& o_normal)
+  {
+    //Solves |o + d * t|^2 = r^2 with the direction left unnormalized, so o_t comes out in units of the given direction's length.
+    auto offset = origin - pose.m_Position;
+    auto b = glm::dot(offset, direction);
+    auto c = glm::dot(offset, offset) - m_Radius * m_Radius;
+    //Outside and not moving closer.
+    if (b >= 0 && c > 0)
+      return false;
+    auto a = glm::dot(direction, direction);
+    auto discriminant = b * b - a * c;
+    if (discriminant < 0)
+      return false;
+    //Rays starting inside the sphere hit it immediately, with the normal pointing from the center to the origin.
+    o_t = c > 0 ? (-b - glm::sqrt(discriminant)) / a : 0.f;
+    auto hitOffset = offset + direction * o_t;
+    auto hitOffsetLengthSquared = glm::dot(hitOffset, hitOffset);
+    o_normal = hitOffsetLengthSquared > 1e-14f ? hitOffset / glm::sqrt(hitOffsetLengthSquared) : -direction / glm::sqrt(a);
+    return true;
+  }
+}
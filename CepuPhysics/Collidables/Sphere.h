@@ -0,0 +1,42 @@
+#pragma once
+#include "IShape.h"
+#include "Math/Matrix3x3Wide.h"
+
+namespace CepuPhysics
+{
+  struct SphereWide;
+
+  struct Sphere : public IConvexShape
+  {
+    using Wide = SphereWide;
+
+    Sphere() = default;
+    Sphere(float radius) : m_Radius(radius) {}
+
+    virtual int32_t GetTypeId() override { return 0; };
+    virtual void ComputeBounds(const glm::quat& orientation, glm::vec3& o_min, glm::vec3& o_max) override;
+    virtual void ComputeAngularExpansionData(float& o_maximumRadius, float& o_maximumAngularExpansion) override;
+    virtual BodyInertia ComputeInertia(float mass) override;
+    virtual bool RayTest(const RigidPose& pose, const glm::vec3& origin, const glm::vec3& direction, float& o_t, glm::vec3& o_normal) override;
+
+    virtual ShapeBatch* CreateShapeBatch(CepuUtil::BufferPool* pool, int32_t initialCapacity) override;
+
+    float m_Radius = 0;
+  };
+
+  //Vector.COUNT spheres stored component-wise, for computing the bounds of many spheres at once.
+  struct SphereWide
+  {
+    void WriteSlot(int32_t slotIndex, const Sphere& source)
+    {
+      m_Radius[slotIndex] = source.m_Radius;
+    }
+
+    //Wide counterpart of Sphere::ComputeBounds. Bounds are relative to the sphere's position.
+    void ComputeBounds(const CepuUtil::QuaternionWide& orientations, CepuUtil::Vector3Wide& o_min, CepuUtil::Vector3Wide& o_max) const;
+    //Wide counterpart of Sphere::ComputeAngularExpansionData.
+    void ComputeAngularExpansionData(CepuUtil::Vector& o_maximumRadius, CepuUtil::Vector& o_maximumAngularExpansion) const;
+
+    CepuUtil::Vector m_Radius;
+  };
+}
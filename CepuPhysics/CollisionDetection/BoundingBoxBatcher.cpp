@@ -0,0 +1,101 @@
+#include "CepuPhysicsPCH.h"
+#include "BoundingBoxBatcher.h"
+#include "BroadPhase.h"
+#include "Bodies.h"
+#include "BodySet.h"
+#include "Collidables/Shapes.h"
+
+namespace CepuPhysics
+{
+  BoundingBoxBatcher::BoundingBoxBatcher(Bodies* bodies, Shapes* shapes, BroadPhase* broadPhase, CepuUtil::BufferPool* pool, float dt)
+    : m_Bodies(bodies), m_Shapes(shapes), m_BroadPhase(broadPhase), m_Pool(pool), m_Dt(dt)
+  {
+    pool->TakeAtLeast(Shapes::MAX_SHAPE_BATCHES, m_Batches);
+    //We rely on the span being unallocated to begin with for lazy initialization.
+    m_Batches.Clear(0, Shapes::MAX_SHAPE_BATCHES);
+    m_MinimumBatchIndex = Shapes::MAX_SHAPE_BATCHES;
+    m_MaximumBatchIndex = -1;
+  }
+
+  void BoundingBoxBatcher::Add(int32_t bodyIndex)
+  {
+    auto& collidable = m_Bodies->GetActiveSet()->m_Collidables[bodyIndex];
+    auto shapeIndex = collidable.m_Shape;
+    if (!shapeIndex.Exists())
+      return;
+
+    auto batchIndex = shapeIndex.GetType();
+    m_MinimumBatchIndex = glm::min(m_MinimumBatchIndex, batchIndex);
+    m_MaximumBatchIndex = glm::max(m_MaximumBatchIndex, batchIndex);
+    auto& batch = m_Batches[batchIndex];
+    if (!batch.m_Span.IsAllocated())
+      batch = CepuUtil::QuickList<BoundsComputationInstance>(COLLIDABLES_PER_FLUSH, m_Pool);
+    auto& instance = batch.AllocateUnsafely();
+    instance.m_BodyIndex = bodyIndex;
+    instance.m_ShapeIndex = shapeIndex.GetIndex();
+    if (batch.m_Count == COLLIDABLES_PER_FLUSH) {
+      m_Shapes->GetBatch(batchIndex)->ComputeBounds(*this);
+      batch.m_Count = 0;
+    }
+  }
+
+  void BoundingBoxBatcher::Flush()
+  {
+    for (int32_t i = m_MinimumBatchIndex; i <= m_MaximumBatchIndex; ++i) {
+      auto& batch = m_Batches[i];
+      if (batch.m_Count > 0)
+        m_Shapes->GetBatch(i)->ComputeBounds(*this);
+      if (batch.m_Span.IsAllocated())
+        batch.Dispose(m_Pool);
+    }
+    m_Pool->Return(m_Batches);
+  }
+
+  void BoundingBoxBatcher::GatherMotionStates(const CepuUtil::QuickList<BoundsComputationInstance>& instances, int32_t bundleStart, int32_t countInBundle,
+    RigidPoseWide& o_poses, BodyVelocityWide& o_velocities)
+  {
+    auto& solverStates = m_Bodies->GetActiveSet()->m_SolverStates;
+    for (int32_t i = 0; i < countInBundle; ++i) {
+      auto& motion = solverStates[instances[bundleStart + i].m_BodyIndex].m_Motion;
+      o_poses.WriteSlot(i, motion.m_Pose);
+      o_velocities.WriteSlot(i, motion.m_Velocity);
+    }
+  }
+
+  void BoundingBoxBatcher::ExpandAndScatterBounds(const CepuUtil::QuickList<BoundsComputationInstance>& instances, int32_t bundleStart, int32_t countInBundle,
+    const RigidPoseWide& poses, const BodyVelocityWide& velocities, const CepuUtil::Vector& maximumRadius, const CepuUtil::Vector& maximumAngularExpansion,
+    const CepuUtil::Vector3Wide& mins, const CepuUtil::Vector3Wide& maxes)
+  {
+    using namespace CepuUtil;
+    auto& collidables = m_Bodies->GetActiveSet()->m_Collidables;
+    Vector minimumMargins, maximumMargins, expansionLimits;
+    for (int32_t i = 0; i < countInBundle; ++i) {
+      auto& continuity = collidables[instances[bundleStart + i].m_BodyIndex].m_Continuity;
+      minimumMargins[i] = continuity.m_MinimumSpeculativeMargin;
+      maximumMargins[i] = continuity.m_MaximumSpeculativeMargin;
+      expansionLimits[i] = continuity.AllowExpansionBeyondSpeculativeMargin() ? std::numeric_limits<float>::max() : 0.f;
+    }
+
+    Vector dt(m_Dt);
+    auto linearDisplacement = velocities.m_Linear * dt;
+    //Rotating by angle a moves a point at distance r from the center by 2r*sin(a/2) <= r*a. No rotation can move the surface further out than the shape's maximum angular expansion.
+    auto angularExpansion = Min(maximumAngularExpansion, Vector3Wide::Length(velocities.m_Angular) * dt * maximumRadius);
+    auto speculativeMargins = Max(minimumMargins, Min(maximumMargins, Vector3Wide::Length(linearDisplacement) + angularExpansion));
+    //Discrete collidables only look ahead as far as their speculative margin; anything beyond it couldn't generate a contact anyway.
+    auto maximumExpansion = Max(expansionLimits, speculativeMargins);
+    auto minExpansion = Vector3Wide::Max(Vector3Wide(-maximumExpansion), Vector3Wide::Min(linearDisplacement, Vector3Wide()) - angularExpansion);
+    auto maxExpansion = Vector3Wide::Min(Vector3Wide(maximumExpansion), Vector3Wide::Max(linearDisplacement, Vector3Wide()) + angularExpansion);
+
+    //Note: the min and max here are in absolute coordinates, which means this is a spot that has to be updated in the event that positions use a higher precision representation.
+    auto worldMins  = mins  + minExpansion + poses.m_Position;
+    auto worldMaxes = maxes + maxExpansion + poses.m_Position;
+    for (int32_t i = 0; i < countInBundle; ++i) {
+      auto& collidable = collidables[instances[bundleStart + i].m_BodyIndex];
+      collidable.m_SpeculativeMargin = speculativeMargins[i];
+      glm::vec3* minPointer, *maxPointer;
+      m_BroadPhase->GetActiveBoundsPointers(collidable.m_BroadPhaseIndex, &minPointer, &maxPointer);
+      *minPointer = worldMins.ReadSlot(i);
+      *maxPointer = worldMaxes.ReadSlot(i);
+    }
+  }
+}
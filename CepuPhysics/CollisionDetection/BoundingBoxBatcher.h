@@ -0,0 +1,108 @@
+#pragma once
+#include "Memory/QuickList.h"
+#include "Collidables/BodyProperties.h"
+#include "Math/Vector3Wide.h"
+
+namespace CepuPhysics
+{
+  class Bodies;
+  class Shapes;
+  class BroadPhase;
+  template<typename TShape> class ConvexShapeBatch;
+  template<typename TShape> class HomogeneousCompoundShapeBatch;
+
+  struct BoundsComputationInstance
+  {
+    int32_t m_BodyIndex;
+    int32_t m_ShapeIndex;
+  };
+
+  //Collects active bodies by shape type and computes their bounding boxes in batches, writing the results straight into the active tree's leaves.
+  //Bounds are expanded to cover the motion predicted over the next dt and each collidable's speculative margin is written back along the way.
+  //Unlike Bodies::UpdateBounds, no refit is done for the written leaves; the whole tree gets refit by the next BroadPhase::Update anyway.
+  //Batching keeps the shape type dispatch out of the per body path and lets each shape type process a contiguous block of instances at a time.
+  //Not thread safe; multithreaded updates give each worker its own batcher working on a disjoint set of bodies.
+  class BoundingBoxBatcher
+  {
+  public:
+    //Number of instances accumulated per shape type before their bounds are computed. A multiple of every Vector::COUNT so full flushes leave no partial bundles.
+    static const int32_t COLLIDABLES_PER_FLUSH = 16;
+    static_assert(COLLIDABLES_PER_FLUSH % CepuUtil::Vector::COUNT == 0, "Flushes should consist of whole bundles.");
+
+    BoundingBoxBatcher(Bodies* bodies, Shapes* shapes, BroadPhase* broadPhase, CepuUtil::BufferPool* pool, float dt);
+
+    //Queues the active body at the given index. Bodies without a shape are ignored.
+    void Add(int32_t bodyIndex);
+    //Computes the bounds of every queued instance and returns the batcher's memory to the pool. The batcher can't be used afterwards.
+    void Flush();
+
+    //Called by convex shape batches to compute the bounds of every queued instance of their type.
+    //Instances are processed Vector::COUNT at a time through the shape's Wide type (TShape::Wide), which needs WriteSlot(int32_t, const TShape&)
+    //ComputeBounds(const QuaternionWide&, Vector3Wide&, Vector3Wide&) and ComputeAngularExpansionData(Vector&, Vector&).
+    template<typename TShape>
+    void ExecuteConvexBatch(ConvexShapeBatch<TShape>& shapeBatch)
+    {
+      auto& instances = m_Batches[shapeBatch.GetTypeId()];
+      typename TShape::Wide shapes;
+      RigidPoseWide poses;
+      BodyVelocityWide velocities;
+      CepuUtil::Vector3Wide mins, maxes;
+      CepuUtil::Vector maximumRadius, maximumAngularExpansion;
+      for (int32_t bundleStart = 0; bundleStart < instances.m_Count; bundleStart += CepuUtil::Vector::COUNT) {
+        auto countInBundle = glm::min(CepuUtil::Vector::COUNT, instances.m_Count - bundleStart);
+        for (int32_t i = 0; i < countInBundle; ++i)
+          shapes.WriteSlot(i, shapeBatch.m_Shapes[instances[bundleStart + i].m_ShapeIndex]);
+        GatherMotionStates(instances, bundleStart, countInBundle, poses, velocities);
+        shapes.ComputeBounds(poses.m_Orientation, mins, maxes);
+        shapes.ComputeAngularExpansionData(maximumRadius, maximumAngularExpansion);
+        ExpandAndScatterBounds(instances, bundleStart, countInBundle, poses, velocities, maximumRadius, maximumAngularExpansion, mins, maxes);
+      }
+    }
+
+    //Called by homogeneous compound batches (meshes). Their bounds have no wide path, so each instance's bounds come from TShape::ComputeBounds,
+    //but the motion expansion and scatter still run a bundle at a time.
+    template<typename TShape>
+    void ExecuteHomogeneousCompoundBatch(HomogeneousCompoundShapeBatch<TShape>& shapeBatch)
+    {
+      auto& instances = m_Batches[shapeBatch.GetTypeId()];
+      RigidPoseWide poses;
+      BodyVelocityWide velocities;
+      CepuUtil::Vector3Wide mins, maxes;
+      CepuUtil::Vector maximumRadius;
+      for (int32_t bundleStart = 0; bundleStart < instances.m_Count; bundleStart += CepuUtil::Vector::COUNT) {
+        auto countInBundle = glm::min(CepuUtil::Vector::COUNT, instances.m_Count - bundleStart);
+        GatherMotionStates(instances, bundleStart, countInBundle, poses, velocities);
+        for (int32_t i = 0; i < countInBundle; ++i) {
+          glm::vec3 min, max;
+          shapeBatch.m_Shapes[instances[bundleStart + i].m_ShapeIndex].ComputeBounds(poses.m_Orientation.ReadSlot(i), min, max);
+          mins.WriteSlot(i, min);
+          maxes.WriteSlot(i, max);
+          //There's no cheaper bound on the extent of an arbitrary compound than its bounding box, and no inner radius to subtract,
+          //so any rotation is assumed to be able to move the surface as far as the farthest corner.
+          maximumRadius[i] = glm::length(glm::max(glm::abs(min), glm::abs(max)));
+        }
+        ExpandAndScatterBounds(instances, bundleStart, countInBundle, poses, velocities, maximumRadius, maximumRadius, mins, maxes);
+      }
+    }
+
+  private:
+    void GatherMotionStates(const CepuUtil::QuickList<BoundsComputationInstance>& instances, int32_t bundleStart, int32_t countInBundle,
+      RigidPoseWide& o_poses, BodyVelocityWide& o_velocities);
+    //Expands the local bounds by the predicted motion, offsets them by the body positions and writes them into the broad phase.
+    //Also stores the speculative margin of every collidable in the bundle.
+    void ExpandAndScatterBounds(const CepuUtil::QuickList<BoundsComputationInstance>& instances, int32_t bundleStart, int32_t countInBundle,
+      const RigidPoseWide& poses, const BodyVelocityWide& velocities, const CepuUtil::Vector& maximumRadius, const CepuUtil::Vector& maximumAngularExpansion,
+      const CepuUtil::Vector3Wide& mins, const CepuUtil::Vector3Wide& maxes);
+
+    Bodies* m_Bodies = nullptr;
+    Shapes* m_Shapes = nullptr;
+    BroadPhase* m_BroadPhase = nullptr;
+    CepuUtil::BufferPool* m_Pool = nullptr;
+    float m_Dt = 0;
+
+    //One list per shape type, lazily allocated on first use.
+    CepuUtil::Buffer<CepuUtil::QuickList<BoundsComputationInstance>> m_Batches;
+    int32_t m_MinimumBatchIndex = 0;
+    int32_t m_MaximumBatchIndex = -1;
+  };
+}
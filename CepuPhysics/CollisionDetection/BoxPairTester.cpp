@@ -0,0 +1,348 @@
+#include "CepuPhysicsPCH.h"
+#include "BoxPairTester.h"
+#include "Math/Matrix3x3Wide.h"
+
+using namespace CepuUtil;
+
+namespace CepuPhysics
+{
+  //Number of contact candidates considered by the face clipping: an entry and an exit point for each of the incident face's 4 edges, plus the reference face's 4 corners.
+  constexpr const int32_t BOX_FACE_CANDIDATE_COUNT = 12;
+
+  //Box in A's local space.
+  struct LocalBoxWide
+  {
+    Vector3Wide m_Center;
+    Vector3Wide m_Axes[3];
+    Vector m_HalfExtents[3];
+  };
+
+  //Lane-wise pick between three values by an index stored as a float (0, 1 or 2).
+  static Vector SelectByIndex(const Vector& index, const Vector& v0, const Vector& v1, const Vector& v2)
+  {
+    return ConditionalSelect(LessThan(index, Vector(0.5f)), v0, ConditionalSelect(LessThan(index, Vector(1.5f)), v1, v2));
+  }
+
+  static Vector3Wide SelectByIndex(const Vector& index, const Vector3Wide& v0, const Vector3Wide& v1, const Vector3Wide& v2)
+  {
+    return Vector3Wide::ConditionalSelect(LessThan(index, Vector(0.5f)), v0, Vector3Wide::ConditionalSelect(LessThan(index, Vector(1.5f)), v1, v2));
+  }
+
+  static Vector Sign(const Vector& v)
+  {
+    return ConditionalSelect(LessThan(v, Vector(0.f)), Vector(-1.f), Vector(1.f));
+  }
+
+  //Penetration depth of the boxes along a unit axis: the sum of their extents along it minus the distance between their centers along it.
+  static Vector ComputeDepth(const Vector3Wide& axis, const LocalBoxWide& a, const LocalBoxWide& b)
+  {
+    auto extentA = Abs(axis.m_X) * a.m_HalfExtents[0] + Abs(axis.m_Y) * a.m_HalfExtents[1] + Abs(axis.m_Z) * a.m_HalfExtents[2];
+    auto extentB = Abs(Vector3Wide::Dot(axis, b.m_Axes[0])) * b.m_HalfExtents[0] + Abs(Vector3Wide::Dot(axis, b.m_Axes[1])) * b.m_HalfExtents[1] +
+      Abs(Vector3Wide::Dot(axis, b.m_Axes[2])) * b.m_HalfExtents[2];
+    return extentA + extentB - Abs(Vector3Wide::Dot(axis, b.m_Center));
+  }
+
+  struct SeparatingAxisWide
+  {
+    //Depth plus the axis type's bias; axes compete on this.
+    Vector m_Score;
+    Vector m_Depth;
+    Vector3Wide m_Normal;
+    //0 for a face of A, 1 for a face of B, 2 for an edge pair.
+    Vector m_Type;
+    Vector m_IndexA;
+    Vector m_IndexB;
+  };
+
+  static void TryAxis(const Vector3Wide& axis, const Vector& depth, const Vector& bias, float type, float indexA, float indexB, SeparatingAxisWide& io_best)
+  {
+    auto score = depth + bias;
+    auto useAxis = LessThan(score, io_best.m_Score);
+    io_best.m_Score = ConditionalSelect(useAxis, score, io_best.m_Score);
+    io_best.m_Depth = ConditionalSelect(useAxis, depth, io_best.m_Depth);
+    io_best.m_Normal = Vector3Wide::ConditionalSelect(useAxis, axis, io_best.m_Normal);
+    io_best.m_Type = ConditionalSelect(useAxis, Vector(type), io_best.m_Type);
+    io_best.m_IndexA = ConditionalSelect(useAxis, Vector(indexA), io_best.m_IndexA);
+    io_best.m_IndexB = ConditionalSelect(useAxis, Vector(indexB), io_best.m_IndexB);
+  }
+
+  //Contact candidates in the reference face's coordinates: u and v along its tangents, depth below its surface.
+  struct FaceCandidatesWide
+  {
+    Vector m_U[BOX_FACE_CANDIDATE_COUNT];
+    Vector m_V[BOX_FACE_CANDIDATE_COUNT];
+    Vector m_Depth[BOX_FACE_CANDIDATE_COUNT];
+    Vector m_Valid[BOX_FACE_CANDIDATE_COUNT];
+  };
+
+  struct FaceContactWide
+  {
+    Vector m_U;
+    Vector m_V;
+    Vector m_Depth;
+    Vector m_Index;
+    Vector m_Exists;
+  };
+
+  //Picks the valid candidate with the highest score, if any beats the initial threshold.
+  static void SelectCandidate(const FaceCandidatesWide& candidates, const Vector* scores, const Vector& threshold, FaceContactWide& o_contact)
+  {
+    auto bestScore = threshold;
+    o_contact.m_Exists = Vector(0.f);
+    for (int32_t i = 0; i < BOX_FACE_CANDIDATE_COUNT; ++i) {
+      auto take = BitwiseAnd(candidates.m_Valid[i], GreaterThan(scores[i], bestScore));
+      bestScore = ConditionalSelect(take, scores[i], bestScore);
+      o_contact.m_U = ConditionalSelect(take, candidates.m_U[i], o_contact.m_U);
+      o_contact.m_V = ConditionalSelect(take, candidates.m_V[i], o_contact.m_V);
+      o_contact.m_Depth = ConditionalSelect(take, candidates.m_Depth[i], o_contact.m_Depth);
+      o_contact.m_Index = ConditionalSelect(take, Vector((float)i), o_contact.m_Index);
+      o_contact.m_Exists = BitwiseOr(o_contact.m_Exists, take);
+    }
+  }
+
+  void BoxPairTester::Test(const BoxWide& a, const BoxWide& b, const Vector& speculativeMargin, const Vector3Wide& offsetB,
+    const QuaternionWide& orientationA, const QuaternionWide& orientationB, Convex4ContactManifoldWide& o_manifold)
+  {
+    //Everything happens in A's local space.
+    Matrix3x3Wide worldRA, worldRB;
+    Matrix3x3Wide::CreateFromQuaternion(orientationA, worldRA);
+    Matrix3x3Wide::CreateFromQuaternion(orientationB, worldRB);
+    LocalBoxWide boxA, boxB;
+    Vector zero(0.f), one(1.f);
+    boxA.m_Axes[0] = Vector3Wide(one, zero, zero);
+    boxA.m_Axes[1] = Vector3Wide(zero, one, zero);
+    boxA.m_Axes[2] = Vector3Wide(zero, zero, one);
+    boxA.m_HalfExtents[0] = a.m_HalfWidth;
+    boxA.m_HalfExtents[1] = a.m_HalfHeight;
+    boxA.m_HalfExtents[2] = a.m_HalfLength;
+    boxB.m_Center = Matrix3x3Wide::TransformByTransposed(offsetB, worldRA);
+    boxB.m_Axes[0] = Matrix3x3Wide::TransformByTransposed(worldRB.m_X, worldRA);
+    boxB.m_Axes[1] = Matrix3x3Wide::TransformByTransposed(worldRB.m_Y, worldRA);
+    boxB.m_Axes[2] = Matrix3x3Wide::TransformByTransposed(worldRB.m_Z, worldRA);
+    boxB.m_HalfExtents[0] = b.m_HalfWidth;
+    boxB.m_HalfExtents[1] = b.m_HalfHeight;
+    boxB.m_HalfExtents[2] = b.m_HalfLength;
+
+    //Separating axis test. Face axes come first and win ties. Edge axes have to beat them by a small margin, since nearly parallel faces
+    //produce edge axes of almost the same depth, and a single edge contact is a much worse manifold than a clipped face.
+    SeparatingAxisWide best;
+    best.m_Score = Vector(std::numeric_limits<float>::max());
+    for (int32_t i = 0; i < 3; ++i)
+      TryAxis(boxA.m_Axes[i], ComputeDepth(boxA.m_Axes[i], boxA, boxB), zero, 0, (float)i, 0, best);
+    for (int32_t j = 0; j < 3; ++j)
+      TryAxis(boxB.m_Axes[j], ComputeDepth(boxB.m_Axes[j], boxA, boxB), zero, 1, 0, (float)j, best);
+    auto edgeBias = Min(Min(a.m_HalfWidth, a.m_HalfHeight), a.m_HalfLength) * Vector(1e-2f) + Min(Min(b.m_HalfWidth, b.m_HalfHeight), b.m_HalfLength) * Vector(1e-2f);
+    for (int32_t i = 0; i < 3; ++i) {
+      for (int32_t j = 0; j < 3; ++j) {
+        auto axis = Vector3Wide::Cross(boxA.m_Axes[i], boxB.m_Axes[j]);
+        auto lengthSquared = Vector3Wide::Dot(axis, axis);
+        //Parallel edges don't define an axis; any separation between them is found by the face axes.
+        auto degenerate = LessThan(lengthSquared, Vector(1e-6f));
+        axis = axis * (one / Sqrt(Max(lengthSquared, Vector(1e-6f))));
+        auto depth = ConditionalSelect(degenerate, Vector(std::numeric_limits<float>::max()), ComputeDepth(axis, boxA, boxB));
+        TryAxis(axis, depth, edgeBias, 2, (float)i, (float)j, best);
+      }
+    }
+    //Point the normal from A toward B.
+    auto normal = best.m_Normal * Sign(Vector3Wide::Dot(best.m_Normal, boxB.m_Center));
+    auto negativeMargin = -speculativeMargin;
+    auto pairActive = GreaterThanOrEqual(best.m_Depth, negativeMargin);
+    o_manifold.m_Normal = Matrix3x3Wide::Transform(-normal, worldRA);
+    if (GetMask(pairActive) == 0) {
+      for (int32_t i = 0; i < ConvexContactManifold::MAX_CONTACT_COUNT; ++i)
+        o_manifold.m_ContactExists[i] = zero;
+      return;
+    }
+
+    //Face contacts. The box owning the separating axis provides the reference face, the other box's face most opposed to it is clipped against it.
+    auto referenceIsA = LessThan(best.m_Type, Vector(0.5f));
+    LocalBoxWide reference, incident;
+    reference.m_Center = Vector3Wide::ConditionalSelect(referenceIsA, boxA.m_Center, boxB.m_Center);
+    incident.m_Center = Vector3Wide::ConditionalSelect(referenceIsA, boxB.m_Center, boxA.m_Center);
+    for (int32_t i = 0; i < 3; ++i) {
+      reference.m_Axes[i] = Vector3Wide::ConditionalSelect(referenceIsA, boxA.m_Axes[i], boxB.m_Axes[i]);
+      incident.m_Axes[i] = Vector3Wide::ConditionalSelect(referenceIsA, boxB.m_Axes[i], boxA.m_Axes[i]);
+      reference.m_HalfExtents[i] = ConditionalSelect(referenceIsA, boxA.m_HalfExtents[i], boxB.m_HalfExtents[i]);
+      incident.m_HalfExtents[i] = ConditionalSelect(referenceIsA, boxB.m_HalfExtents[i], boxA.m_HalfExtents[i]);
+    }
+    //Outward normal of the reference face, pointing toward the incident box.
+    auto referenceNormal = Vector3Wide::ConditionalSelect(referenceIsA, normal, -normal);
+    auto referenceIndex = ConditionalSelect(referenceIsA, best.m_IndexA, best.m_IndexB);
+    auto tangentU = SelectByIndex(referenceIndex, reference.m_Axes[1], reference.m_Axes[2], reference.m_Axes[0]);
+    auto tangentV = SelectByIndex(referenceIndex, reference.m_Axes[2], reference.m_Axes[0], reference.m_Axes[1]);
+    auto halfU = SelectByIndex(referenceIndex, reference.m_HalfExtents[1], reference.m_HalfExtents[2], reference.m_HalfExtents[0]);
+    auto halfV = SelectByIndex(referenceIndex, reference.m_HalfExtents[2], reference.m_HalfExtents[0], reference.m_HalfExtents[1]);
+    auto halfN = SelectByIndex(referenceIndex, reference.m_HalfExtents[0], reference.m_HalfExtents[1], reference.m_HalfExtents[2]);
+    auto referenceFaceCenter = reference.m_Center + referenceNormal * halfN;
+
+    Vector incidentDots[3];
+    for (int32_t i = 0; i < 3; ++i)
+      incidentDots[i] = Vector3Wide::Dot(referenceNormal, incident.m_Axes[i]);
+    auto absDot0 = Abs(incidentDots[0]);
+    auto absDot1 = Abs(incidentDots[1]);
+    auto absDot2 = Abs(incidentDots[2]);
+    auto incidentIndex = ConditionalSelect(BitwiseAnd(GreaterThanOrEqual(absDot0, absDot1), GreaterThanOrEqual(absDot0, absDot2)), zero,
+      ConditionalSelect(GreaterThanOrEqual(absDot1, absDot2), one, Vector(2.f)));
+    auto incidentAxis = SelectByIndex(incidentIndex, incident.m_Axes[0], incident.m_Axes[1], incident.m_Axes[2]);
+    //The incident face's outward normal is incidentAxis * incidentSign.
+    auto incidentSign = -Sign(SelectByIndex(incidentIndex, incidentDots[0], incidentDots[1], incidentDots[2]));
+    auto incidentFaceCenter = incident.m_Center + incidentAxis * (incidentSign * SelectByIndex(incidentIndex, incident.m_HalfExtents[0], incident.m_HalfExtents[1], incident.m_HalfExtents[2]));
+    auto incidentT1 = SelectByIndex(incidentIndex, incident.m_Axes[1], incident.m_Axes[2], incident.m_Axes[0]);
+    auto incidentT2 = SelectByIndex(incidentIndex, incident.m_Axes[2], incident.m_Axes[0], incident.m_Axes[1]);
+    auto incidentHalf1 = SelectByIndex(incidentIndex, incident.m_HalfExtents[1], incident.m_HalfExtents[2], incident.m_HalfExtents[0]);
+    auto incidentHalf2 = SelectByIndex(incidentIndex, incident.m_HalfExtents[2], incident.m_HalfExtents[0], incident.m_HalfExtents[1]);
+
+    //Incident face vertices in reference face coordinates, wound around the face.
+    auto centerOffset = incidentFaceCenter - referenceFaceCenter;
+    auto centerU = Vector3Wide::Dot(centerOffset, tangentU);
+    auto centerV = Vector3Wide::Dot(centerOffset, tangentV);
+    auto centerDepth = -Vector3Wide::Dot(centerOffset, referenceNormal);
+    auto edge1 = incidentT1 * incidentHalf1;
+    auto edge2 = incidentT2 * incidentHalf2;
+    auto edge1U = Vector3Wide::Dot(edge1, tangentU), edge1V = Vector3Wide::Dot(edge1, tangentV), edge1Depth = -Vector3Wide::Dot(edge1, referenceNormal);
+    auto edge2U = Vector3Wide::Dot(edge2, tangentU), edge2V = Vector3Wide::Dot(edge2, tangentV), edge2Depth = -Vector3Wide::Dot(edge2, referenceNormal);
+    const float signs1[4] = { 1, -1, -1, 1 };
+    const float signs2[4] = { 1, 1, -1, -1 };
+    Vector vertexU[4], vertexV[4], vertexDepth[4];
+    for (int32_t i = 0; i < 4; ++i) {
+      Vector sign1(signs1[i]), sign2(signs2[i]);
+      vertexU[i] = centerU + edge1U * sign1 + edge2U * sign2;
+      vertexV[i] = centerV + edge1V * sign1 + edge2V * sign2;
+      vertexDepth[i] = centerDepth + edge1Depth * sign1 + edge2Depth * sign2;
+    }
+
+    FaceCandidatesWide candidates;
+    //Clip each incident edge against the reference face's rectangle. The entry point covers the edge's start vertex when it's inside the rectangle;
+    //the exit point is only added where the edge leaves the rectangle, since an end vertex inside the rectangle is the next edge's start vertex.
+    auto inverseEpsilon = Vector(1e-15f);
+    for (int32_t i = 0; i < 4; ++i) {
+      auto next = (i + 1) & 3;
+      auto du = vertexU[next] - vertexU[i];
+      auto dv = vertexV[next] - vertexV[i];
+      auto dDepth = vertexDepth[next] - vertexDepth[i];
+      auto inverseDu = one / ConditionalSelect(LessThan(Abs(du), inverseEpsilon), inverseEpsilon, du);
+      auto inverseDv = one / ConditionalSelect(LessThan(Abs(dv), inverseEpsilon), inverseEpsilon, dv);
+      auto tU0 = (-halfU - vertexU[i]) * inverseDu;
+      auto tU1 = (halfU - vertexU[i]) * inverseDu;
+      auto tV0 = (-halfV - vertexV[i]) * inverseDv;
+      auto tV1 = (halfV - vertexV[i]) * inverseDv;
+      auto tEntry = Max(zero, Max(Min(tU0, tU1), Min(tV0, tV1)));
+      auto tExit = Min(one, Min(Max(tU0, tU1), Max(tV0, tV1)));
+      auto overlaps = LessThanOrEqual(tEntry, tExit);
+      auto entryIndex = i * 2;
+      auto exitIndex = entryIndex + 1;
+      candidates.m_U[entryIndex] = vertexU[i] + du * tEntry;
+      candidates.m_V[entryIndex] = vertexV[i] + dv * tEntry;
+      candidates.m_Depth[entryIndex] = vertexDepth[i] + dDepth * tEntry;
+      candidates.m_Valid[entryIndex] = overlaps;
+      candidates.m_U[exitIndex] = vertexU[i] + du * tExit;
+      candidates.m_V[exitIndex] = vertexV[i] + dv * tExit;
+      candidates.m_Depth[exitIndex] = vertexDepth[i] + dDepth * tExit;
+      candidates.m_Valid[exitIndex] = BitwiseAnd(BitwiseAnd(overlaps, LessThan(tExit, one)), GreaterThan(tExit, tEntry));
+    }
+    //Reference face corners that lie within the incident face, projected along the reference normal onto it.
+    auto incidentNormal = incidentAxis * incidentSign;
+    auto inverseNormalDot = one / Vector3Wide::Dot(referenceNormal, incidentNormal);
+    auto normalDot1 = Vector3Wide::Dot(referenceNormal, incidentT1);
+    auto normalDot2 = Vector3Wide::Dot(referenceNormal, incidentT2);
+    for (int32_t i = 0; i < 4; ++i) {
+      auto candidateIndex = 8 + i;
+      auto cornerU = halfU * Vector(signs1[i]);
+      auto cornerV = halfV * Vector(signs2[i]);
+      auto cornerToIncident = incidentFaceCenter - (referenceFaceCenter + tangentU * cornerU + tangentV * cornerV);
+      auto t = Vector3Wide::Dot(cornerToIncident, incidentNormal) * inverseNormalDot;
+      //Offset of the projected corner from the incident face's center along the face's tangents.
+      auto local1 = t * normalDot1 - Vector3Wide::Dot(cornerToIncident, incidentT1);
+      auto local2 = t * normalDot2 - Vector3Wide::Dot(cornerToIncident, incidentT2);
+      candidates.m_U[candidateIndex] = cornerU;
+      candidates.m_V[candidateIndex] = cornerV;
+      candidates.m_Depth[candidateIndex] = -t;
+      candidates.m_Valid[candidateIndex] = BitwiseAnd(LessThanOrEqual(Abs(local1), incidentHalf1), LessThanOrEqual(Abs(local2), incidentHalf2));
+    }
+    for (int32_t i = 0; i < BOX_FACE_CANDIDATE_COUNT; ++i)
+      candidates.m_Valid[i] = BitwiseAnd(candidates.m_Valid[i], GreaterThanOrEqual(candidates.m_Depth[i], negativeMargin));
+
+    //Reduce to 4 contacts: the deepest, the one farthest from it, then the ones spanning the most area on either side of the line between those two.
+    FaceContactWide faceContacts[4];
+    Vector scores[BOX_FACE_CANDIDATE_COUNT];
+    auto faceScale = halfU + halfV;
+    auto epsilon = faceScale * faceScale * Vector(1e-6f);
+    SelectCandidate(candidates, candidates.m_Depth, Vector(-std::numeric_limits<float>::max()), faceContacts[0]);
+    for (int32_t i = 0; i < BOX_FACE_CANDIDATE_COUNT; ++i) {
+      auto du = candidates.m_U[i] - faceContacts[0].m_U;
+      auto dv = candidates.m_V[i] - faceContacts[0].m_V;
+      scores[i] = du * du + dv * dv;
+    }
+    SelectCandidate(candidates, scores, epsilon, faceContacts[1]);
+    auto spanU = faceContacts[1].m_U - faceContacts[0].m_U;
+    auto spanV = faceContacts[1].m_V - faceContacts[0].m_V;
+    for (int32_t i = 0; i < BOX_FACE_CANDIDATE_COUNT; ++i)
+      scores[i] = spanU * (candidates.m_V[i] - faceContacts[0].m_V) - spanV * (candidates.m_U[i] - faceContacts[0].m_U);
+    SelectCandidate(candidates, scores, epsilon, faceContacts[2]);
+    for (int32_t i = 0; i < BOX_FACE_CANDIDATE_COUNT; ++i)
+      scores[i] = -scores[i];
+    SelectCandidate(candidates, scores, epsilon, faceContacts[3]);
+    //Without a second contact there's no span, so the area scores are all zero and the last two slots stay empty.
+
+    //Face feature ids combine the candidate slot with which faces were involved, so they stay stable while the same faces are in contact.
+    auto faceKey = ConditionalSelect(referenceIsA, zero, one) + referenceIndex * Vector(2.f) + incidentIndex * Vector(8.f) +
+      ConditionalSelect(GreaterThan(incidentSign, zero), Vector(32.f), zero);
+    auto isEdge = GreaterThan(best.m_Type, Vector(1.5f));
+    for (int32_t i = 0; i < 4; ++i) {
+      auto& contact = faceContacts[i];
+      auto localOffset = referenceFaceCenter + tangentU * contact.m_U + tangentV * contact.m_V - referenceNormal * contact.m_Depth;
+      o_manifold.m_OffsetA[i] = Matrix3x3Wide::Transform(localOffset, worldRA);
+      o_manifold.m_Depth[i] = contact.m_Depth;
+      o_manifold.m_FeatureId[i] = contact.m_Index + faceKey * Vector(16.f);
+      o_manifold.m_ContactExists[i] = AndNot(BitwiseAnd(contact.m_Exists, pairActive), isEdge);
+    }
+
+    if (GetMask(BitwiseAnd(isEdge, pairActive)) != 0) {
+      //Edge contact: closest points between the edge of A and the edge of B lying farthest along the normal toward each other.
+      auto edgeA = SelectByIndex(best.m_IndexA, boxA.m_Axes[0], boxA.m_Axes[1], boxA.m_Axes[2]);
+      auto edgeB = SelectByIndex(best.m_IndexB, boxB.m_Axes[0], boxB.m_Axes[1], boxB.m_Axes[2]);
+      auto halfA = SelectByIndex(best.m_IndexA, boxA.m_HalfExtents[0], boxA.m_HalfExtents[1], boxA.m_HalfExtents[2]);
+      auto halfB = SelectByIndex(best.m_IndexB, boxB.m_HalfExtents[0], boxB.m_HalfExtents[1], boxB.m_HalfExtents[2]);
+      Vector dotsB[3];
+      for (int32_t i = 0; i < 3; ++i)
+        dotsB[i] = Vector3Wide::Dot(normal, boxB.m_Axes[i]);
+      auto cornerA = Vector3Wide(Sign(normal.m_X) * boxA.m_HalfExtents[0], Sign(normal.m_Y) * boxA.m_HalfExtents[1], Sign(normal.m_Z) * boxA.m_HalfExtents[2]);
+      auto cornerOffsetB = boxB.m_Axes[0] * (Sign(dotsB[0]) * boxB.m_HalfExtents[0]) + boxB.m_Axes[1] * (Sign(dotsB[1]) * boxB.m_HalfExtents[1]) +
+        boxB.m_Axes[2] * (Sign(dotsB[2]) * boxB.m_HalfExtents[2]);
+      auto edgeCenterA = cornerA - edgeA * Vector3Wide::Dot(cornerA, edgeA);
+      auto edgeCenterB = boxB.m_Center - (cornerOffsetB - edgeB * Vector3Wide::Dot(cornerOffsetB, edgeB));
+      auto centerOffsetAB = edgeCenterB - edgeCenterA;
+      auto edgeDot = Vector3Wide::Dot(edgeA, edgeB);
+      auto inverseDenominator = one / Max(one - edgeDot * edgeDot, Vector(1e-6f));
+      auto offsetDotA = Vector3Wide::Dot(edgeA, centerOffsetAB);
+      auto offsetDotB = Vector3Wide::Dot(edgeB, centerOffsetAB);
+      auto tB = Max(-halfB, Min(halfB, (edgeDot * offsetDotA - offsetDotB) * inverseDenominator));
+      //The clamped point on B's edge can project past the end of A's edge. Clamp A's parameter for that point, then project back onto B so the contact is
+      //the closest point on B's edge to a point that's actually on A's edge.
+      auto tA = Max(-halfA, Min(halfA, offsetDotA + edgeDot * tB));
+      tB = Max(-halfB, Min(halfB, edgeDot * tA - offsetDotB));
+      auto edgeContact = edgeCenterB + edgeB * tB;
+      auto bitsA = ConditionalSelect(GreaterThan(normal.m_X, zero), one, zero) + ConditionalSelect(GreaterThan(normal.m_Y, zero), Vector(2.f), zero) +
+        ConditionalSelect(GreaterThan(normal.m_Z, zero), Vector(4.f), zero);
+      auto bitsB = ConditionalSelect(GreaterThan(dotsB[0], zero), one, zero) + ConditionalSelect(GreaterThan(dotsB[1], zero), Vector(2.f), zero) +
+        ConditionalSelect(GreaterThan(dotsB[2], zero), Vector(4.f), zero);
+      auto edgeFeatureId = Vector(1024.f) + best.m_IndexA + best.m_IndexB * Vector(3.f) + bitsA * Vector(16.f) + bitsB * Vector(128.f);
+      auto useEdge = BitwiseAnd(isEdge, pairActive);
+      o_manifold.m_OffsetA[0] = Vector3Wide::ConditionalSelect(useEdge, Matrix3x3Wide::Transform(edgeContact, worldRA), o_manifold.m_OffsetA[0]);
+      o_manifold.m_Depth[0] = ConditionalSelect(useEdge, best.m_Depth, o_manifold.m_Depth[0]);
+      o_manifold.m_FeatureId[0] = ConditionalSelect(useEdge, edgeFeatureId, o_manifold.m_FeatureId[0]);
+      o_manifold.m_ContactExists[0] = BitwiseOr(o_manifold.m_ContactExists[0], useEdge);
+    }
+  }
+
+  void BoxPairTester::Test(const Box& a, const Box& b, float speculativeMargin, const glm::vec3& offsetB, const glm::quat& orientationA, const glm::quat& orientationB,
+    ConvexContactManifold& o_manifold)
+  {
+    BoxWide aWide, bWide;
+    aWide.WriteSlot(0, a);
+    bWide.WriteSlot(0, b);
+    Convex4ContactManifoldWide manifoldWide;
+    Test(aWide, bWide, Vector(speculativeMargin), Vector3Wide::Broadcast(offsetB), QuaternionWide::Broadcast(orientationA), QuaternionWide::Broadcast(orientationB), manifoldWide);
+    manifoldWide.ReadSlot(0, offsetB, o_manifold);
+  }
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "ContactManifold.h"
+#include "Collidables/Box.h"
+
+namespace CepuPhysics
+{
+  //Generates contacts between pairs of boxes.
+  //The separating axis test runs over all 15 candidate axes (3 face normals per box, 9 edge-edge cross products) and picks the one of least penetration.
+  //Face axes clip the incident box's face against the reference face, producing up to 4 contacts; edge axes produce a single contact between the closest points of the two edges.
+  //Contacts deeper than -speculativeMargin are kept, so nearby but separated boxes get speculative contacts.
+  struct BoxPairTester
+  {
+    //Tests Vector.COUNT pairs at once, one per lane. Lanes beyond the caller's pair count can hold anything; their results are meaningless but harmless.
+    static void Test(const BoxWide& a, const BoxWide& b, const CepuUtil::Vector& speculativeMargin, const CepuUtil::Vector3Wide& offsetB,
+      const CepuUtil::QuaternionWide& orientationA, const CepuUtil::QuaternionWide& orientationB, Convex4ContactManifoldWide& o_manifold);
+
+    //Single pair convenience wrapper. Runs the wide test with one occupied lane, so batching pairs through CollisionBatcher is much faster.
+    static void Test(const Box& a, const Box& b, float speculativeMargin, const glm::vec3& offsetB, const glm::quat& orientationA, const glm::quat& orientationB,
+      ConvexContactManifold& o_manifold);
+  };
+}
@@ -4,35 +4,59 @@
 namespace CepuPhysics
 {
   BroadPhase::BroadPhase(CepuUtil::BufferPool& pool, int32_t initialActiveLeafCapacity, int32_t initialStaticLeafCapacity)
-    : m_ActiveTree(pool, initialActiveLeafCapacity),
+    : m_FrameArena(&pool),
+      m_ActiveTree(pool, initialActiveLeafCapacity),
       m_StaticTree(pool, initialActiveLeafCapacity)
   {
     m_Pool = &pool;
     pool.TakeAtLeast(initialActiveLeafCapacity, m_ActiveLeaves);
     pool.TakeAtLeast(initialStaticLeafCapacity, m_StaticLeaves);
-
-    //activeRefineContext = new Tree.RefitAndRefineMultithreadedContext();
-    //staticRefineContext = new Tree.RefitAndRefineMultithreadedContext();
   }
 
   BroadPhase::~BroadPhase()
   {
     Dispose(m_ActiveTree, m_ActiveLeaves);
     Dispose(m_StaticTree, m_StaticLeaves);
+    m_StaticQueryTree.Dispose(*m_Pool);
   }
 
-  void BroadPhase::Update()
+  void BroadPhase::Update(CepuUtil::IThreadDispatcher* threadDispatcher)
   {
     if (m_FrameIndex == INT32_MAX)
       m_FrameIndex = 0;
-    //@TODO (alektron)
-    static_assert(MULTITHREADING_UNSUPPORTED);
 
-    m_ActiveTree.RefitAndRefine(m_Pool, m_FrameIndex);
-    m_StaticTree.RefitAndRefine(m_Pool, m_FrameIndex);
+    m_FrameArena.Reset();
+    if (threadDispatcher != nullptr)
+    {
+      m_ActiveRefineContext.RefitAndRefine(m_ActiveTree, &m_FrameArena, threadDispatcher, m_FrameIndex);
+      m_StaticRefineContext.RefitAndRefine(m_StaticTree, &m_FrameArena, threadDispatcher, m_FrameIndex);
+    }
+    else
+    {
+      m_ActiveTree.RefitAndRefine(&m_FrameArena, m_FrameIndex);
+      m_StaticTree.RefitAndRefine(&m_FrameArena, m_FrameIndex);
+    }
+    if (m_StaticQueryTreeNeedsRebuild) {
+      if (m_StaticQueryTreeRebuildDelay >= 0 && m_UpdatesSinceStaticTopologyChange++ >= m_StaticQueryTreeRebuildDelay)
+        RebuildStaticQueryTree();
+    }
+    else if (!m_StaticQueryTreeValid) {
+      m_StaticQueryTree.Refit(m_StaticTree);
+      m_StaticQueryTreeValid = true;
+    }
     m_FrameIndex++;
   }
 
+  void BroadPhase::RebuildStaticQueryTree()
+  {
+    m_StaticQueryTree.Build(m_StaticTree, *m_Pool);
+    //The build copies the static tree's internal bounds, which bounds written through GetStaticBoundsPointers only reach once the static tree is refit.
+    //The wide refit reads the leaf bounds directly, so it holds either way.
+    m_StaticQueryTree.Refit(m_StaticTree);
+    m_StaticQueryTreeValid = true;
+    m_StaticQueryTreeNeedsRebuild = false;
+  }
+
   int32_t BroadPhase::Add(CollidableReference collidable, const CepuUtil::BoundingBox& bounds, Tree& tree, CepuUtil::BufferPool& pool, CepuUtil::Buffer<CollidableReference>& leaves)
   {
     auto leafIndex = tree.Add(bounds, pool);
@@ -44,6 +68,19 @@ namespace CepuPhysics
     return leafIndex;
   }
 
+  int32_t BroadPhase::AddRange(const CepuUtil::Buffer<CollidableReference>& collidables, const CepuUtil::Buffer<CepuUtil::BoundingBox>& bounds, Tree& tree,
+    CepuUtil::BufferPool& pool, CepuUtil::Buffer<CollidableReference>& leaves, CepuUtil::IThreadDispatcher* threadDispatcher)
+  {
+    assert(collidables.GetLength() == bounds.GetLength() && "Every collidable needs bounds.");
+    auto newLeafCount = tree.m_LeafCount + bounds.GetLength();
+    if (newLeafCount > leaves.GetLength())
+      pool.ResizeToAtLeast(leaves, newLeafCount, tree.m_LeafCount);
+    auto firstLeafIndex = tree.AddRange(bounds, pool, threadDispatcher);
+    for (int32_t i = 0; i < collidables.GetLength(); ++i)
+      leaves[firstLeafIndex + i] = collidables[i];
+    return firstLeafIndex;
+  }
+
   bool BroadPhase::RemoveAt(int32_t index, Tree& tree, CepuUtil::Buffer<CollidableReference> leaves, CollidableReference& o_movedLeaf)
   {
     assert(index >= 0);
@@ -58,6 +95,19 @@ namespace CepuPhysics
     return false;
   }
 
+  void BroadPhase::RemoveRange(const CepuUtil::Buffer<int32_t>& indices, Tree& tree, CepuUtil::BufferPool& pool, CepuUtil::Buffer<CollidableReference>& leaves,
+    CepuUtil::Buffer<int32_t>& o_leafIndexRemap)
+  {
+    auto oldLeafCount = tree.m_LeafCount;
+    tree.RemoveRange(indices, pool, o_leafIndexRemap);
+    //Survivors only ever move toward the front, so compacting in order never overwrites a leaf that hasn't been moved yet.
+    for (int32_t i = 0; i < oldLeafCount; ++i) {
+      auto newIndex = o_leafIndexRemap[i];
+      if (newIndex >= 0)
+        leaves[newIndex] = leaves[i];
+    }
+  }
+
   void BroadPhase::GetBoundsPointers(int32_t broadPhaseIndex, const Tree& tree, glm::vec3** o_minPointer, glm::vec3** o_maxPointer)
   {
     auto leaf = tree.m_Leaves[broadPhaseIndex];
@@ -79,6 +129,7 @@ namespace CepuPhysics
   {
     m_ActiveTree.Clear();
     m_StaticTree.Clear();
+    InvalidateStaticQueryTree();
   }
 
   void BroadPhase::EnsureCapacity(int32_t activeCapacity, int32_t staticCapacity)
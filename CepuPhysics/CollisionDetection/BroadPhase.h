@@ -1,9 +1,14 @@
 #pragma once
 #include "Collidables/CollidableReference.h"
 #include "Trees/Tree.h"
+#include "Trees/Tree_RefitAndRefineMultithreaded.h"
+#include "Trees/WideTree.h"
+#include "Memory/FrameArena.h"
 
 namespace CepuPhysics
 {
+  struct Frustum;
+
   class BroadPhase
   {
   public:
@@ -11,22 +16,85 @@ namespace CepuPhysics
     ~BroadPhase();
 
     static bool RemoveAt(int32_t index, Tree& tree, CepuUtil::Buffer<CollidableReference> leaves, CollidableReference& o_movedLeaf);
+    static void RemoveRange(const CepuUtil::Buffer<int32_t>& indices, Tree& tree, CepuUtil::BufferPool& pool, CepuUtil::Buffer<CollidableReference>& leaves,
+      CepuUtil::Buffer<int32_t>& o_leafIndexRemap);
 
     int32_t AddActive(CollidableReference collidable, const CepuUtil::BoundingBox& bounds) { return Add(collidable, bounds, m_ActiveTree, *m_Pool, m_ActiveLeaves); }
-    int32_t AddStatic(CollidableReference collidable, const CepuUtil::BoundingBox& bounds) { return Add(collidable, bounds, m_StaticTree, *m_Pool, m_StaticLeaves); }
+    int32_t AddStatic(CollidableReference collidable, const CepuUtil::BoundingBox& bounds)
+    {
+      InvalidateStaticQueryTree();
+      return Add(collidable, bounds, m_StaticTree, *m_Pool, m_StaticLeaves);
+    }
+    //Adds collidables[i] with bounds[i] for every i and returns the leaf index of the first; the rest follow contiguously.
+    //Meant for spawning many collidables at once: capacity is reserved once and the new leaves are built into a subtree before being grafted into the tree.
+    int32_t AddActiveRange(const CepuUtil::Buffer<CollidableReference>& collidables, const CepuUtil::Buffer<CepuUtil::BoundingBox>& bounds, CepuUtil::IThreadDispatcher* threadDispatcher = nullptr)
+    {
+      return AddRange(collidables, bounds, m_ActiveTree, *m_Pool, m_ActiveLeaves, threadDispatcher);
+    }
+    int32_t AddStaticRange(const CepuUtil::Buffer<CollidableReference>& collidables, const CepuUtil::Buffer<CepuUtil::BoundingBox>& bounds, CepuUtil::IThreadDispatcher* threadDispatcher = nullptr)
+    {
+      InvalidateStaticQueryTree();
+      return AddRange(collidables, bounds, m_StaticTree, *m_Pool, m_StaticLeaves, threadDispatcher);
+    }
     bool RemoveActiveAt(int32_t index, CollidableReference& o_movedLeaf) { return RemoveAt(index, m_ActiveTree, m_ActiveLeaves, o_movedLeaf); }
-    bool RemoveStaticAt(int32_t index, CollidableReference& o_movedLeaf) { return RemoveAt(index, m_StaticTree, m_StaticLeaves, o_movedLeaf); }
+    bool RemoveStaticAt(int32_t index, CollidableReference& o_movedLeaf)
+    {
+      InvalidateStaticQueryTree();
+      return RemoveAt(index, m_StaticTree, m_StaticLeaves, o_movedLeaf);
+    }
+    //Removes every leaf in indices at once; see Tree::RemoveRange. Surviving leaves keep their relative order.
+    //o_leafIndexRemap maps every old leaf index to its new one (or -1 if removed) and must be returned to the broad phase's pool by the caller.
+    void RemoveActiveRange(const CepuUtil::Buffer<int32_t>& indices, CepuUtil::Buffer<int32_t>& o_leafIndexRemap) { RemoveRange(indices, m_ActiveTree, *m_Pool, m_ActiveLeaves, o_leafIndexRemap); }
+    void RemoveStaticRange(const CepuUtil::Buffer<int32_t>& indices, CepuUtil::Buffer<int32_t>& o_leafIndexRemap)
+    {
+      InvalidateStaticQueryTree();
+      RemoveRange(indices, m_StaticTree, *m_Pool, m_StaticLeaves, o_leafIndexRemap);
+    }
 
     static void GetBoundsPointers(int32_t broadPhaseIndex, const Tree& tree, glm::vec3** o_minPointer, glm::vec3** o_maxPointer);
     void GetActiveBoundsPointers(int32_t index, glm::vec3** o_minPointer, glm::vec3** o_maxPointer) { return GetBoundsPointers(index, m_ActiveTree, o_minPointer, o_maxPointer); }
-    void GetStaticBoundsPointers(int32_t index, glm::vec3** o_minPointer, glm::vec3** o_maxPointer) { return GetBoundsPointers(index, m_StaticTree, o_minPointer, o_maxPointer); }
+    //The pointers can be written through, so handing them out leaves static queries on the binary tree until Update refits the static query tree.
+    void GetStaticBoundsPointers(int32_t index, glm::vec3** o_minPointer, glm::vec3** o_maxPointer)
+    {
+      m_StaticQueryTreeValid = false;
+      return GetBoundsPointers(index, m_StaticTree, o_minPointer, o_maxPointer);
+    }
     
     static void UpdateBounds(int32_t broadPhaseIndex, Tree& tree, const glm::vec3& min, const glm::vec3& max);
     void UpdateActiveBounds(int32_t broadPhaseIndex, const glm::vec3& min, const glm::vec3& max) { return UpdateBounds(broadPhaseIndex, m_ActiveTree, min, max); }
-    void UpdateStaticBounds(int32_t broadPhaseIndex, const glm::vec3& min, const glm::vec3& max) { return UpdateBounds(broadPhaseIndex, m_StaticTree, min, max); }
+    void UpdateStaticBounds(int32_t broadPhaseIndex, const glm::vec3& min, const glm::vec3& max)
+    {
+      if (!m_StaticQueryTreeNeedsRebuild)
+        m_StaticQueryTree.RefitLeaf(broadPhaseIndex, min, max);
+      return UpdateBounds(broadPhaseIndex, m_StaticTree, min, max);
+    }
     
-    void Update(/*@ IThreadDispatcher threadDispatcher = null*/);
+    //Volume queries against both trees, defined in BroadPhase_Queries.h; see Tree_VolumeQueries.h for the volumes.
+    //Handlers are invoked as results.Handle(CollidableReference) and return false to stop the query, in which case the query returns false too.
+    //Active collidables are reported before static ones. Box queries go through the static query tree when it's valid.
+    template<typename TOverlapHandler>
+    bool GetOverlaps(const CepuUtil::BoundingBox& bounds, TOverlapHandler& results) const;
+    template<typename TOverlapHandler>
+    bool GetOverlaps(const glm::vec3& center, float radius, TOverlapHandler& results) const;
+    template<typename TOverlapHandler>
+    bool GetOverlaps(const Frustum& frustum, TOverlapHandler& results) const;
+    template<typename TVolume, typename TOverlapHandler>
+    bool GetOverlapsWithVolume(const TVolume& volume, TOverlapHandler& results) const;
+    //Sweeps bounds along velocity * t for t in [0, maximumT] through both trees and reports candidates from either tree in order of first contact; see Tree_Sweep.h.
+    //Handlers are invoked as results.TestLeaf(CollidableReference collidable, float t, float& maximumT) and may lower maximumT once they find an actual impact.
+    template<typename TSweepHandler>
+    void Sweep(const CepuUtil::BoundingBox& bounds, const glm::vec3& velocity, float maximumT, TSweepHandler& results) const;
+    //Casts a ray through the active tree and then the static tree, defined in BroadPhase_Queries.h; see Tree_RayCast.h.
+    //Testers are invoked as leafTester.TestLeaf(CollidableReference collidable, const RayData& ray, float& maximumT), so hits in the active tree already cull
+    //the static traversal. io_maximumT holds the final maximum on return.
+    template<typename TRayTester>
+    void RayCast(const glm::vec3& origin, const glm::vec3& direction, float& io_maximumT, TRayTester& leafTester, int32_t id = 0) const;
+
+    void Update(CepuUtil::IThreadDispatcher* threadDispatcher = nullptr);
     void Clear();
+    //Builds the static query tree from the current static tree right away, instead of waiting for m_StaticQueryTreeRebuildDelay quiet updates.
+    //Worth calling after loading a batch of static collidables.
+    void RebuildStaticQueryTree();
     
     void EnsureCapacity(int32_t activeCapacity, int32_t staticCapacity);
     
@@ -34,17 +102,40 @@ namespace CepuPhysics
 
   private:
     static int32_t Add(CollidableReference collidable, const CepuUtil::BoundingBox& bounds, Tree& tree, CepuUtil::BufferPool& pol, CepuUtil::Buffer<CollidableReference>& leaves);
+    static int32_t AddRange(const CepuUtil::Buffer<CollidableReference>& collidables, const CepuUtil::Buffer<CepuUtil::BoundingBox>& bounds, Tree& tree,
+      CepuUtil::BufferPool& pool, CepuUtil::Buffer<CollidableReference>& leaves, CepuUtil::IThreadDispatcher* threadDispatcher);
     void EnsureCapacity(Tree& tree, CepuUtil::Buffer<CollidableReference>& leaves, int32_t capacity);
     void ResizeCapacity(Tree& tree, CepuUtil::Buffer<CollidableReference>& leaves, int32_t capacity);
     void Dispose       (Tree& tree, CepuUtil::Buffer<CollidableReference>& leaves);
+    void InvalidateStaticQueryTree()
+    {
+      m_StaticQueryTreeValid = false;
+      m_StaticQueryTreeNeedsRebuild = true;
+      m_UpdatesSinceStaticTopologyChange = 0;
+    }
 
   public:
     CepuUtil::Buffer<CollidableReference> m_ActiveLeaves;
     CepuUtil::Buffer<CollidableReference> m_StaticLeaves;
     CepuUtil::BufferPool* m_Pool = nullptr;
+    //Scratch memory for the per-frame tree refinement. Reset at the start of every update.
+    CepuUtil::FrameArena m_FrameArena;
 
     Tree m_ActiveTree;
     Tree m_StaticTree;
+    //Wide copy of m_StaticTree for static box queries and ray casts. Only the leaves and their bounds matter to it, so refinement leaves it intact.
+    //UpdateStaticBounds refits it in place, and bounds written through GetStaticBoundsPointers are refit by the next Update. Static adds and removals
+    //require a rebuild, which Update only does once the static tree has gone m_StaticQueryTreeRebuildDelay updates without one, so streaming statics
+    //in and out doesn't cost a rebuild every frame. Queries fall back to m_StaticTree until then.
+    NativeWideTree m_StaticQueryTree;
+    bool m_StaticQueryTreeValid = false;
+    bool m_StaticQueryTreeNeedsRebuild = true;
+    int32_t m_UpdatesSinceStaticTopologyChange = 0;
+    //A negative delay leaves rebuilding to RebuildStaticQueryTree.
+    int32_t m_StaticQueryTreeRebuildDelay = 60;
+
+    RefitAndRefineMultithreadedContext m_ActiveRefineContext;
+    RefitAndRefineMultithreadedContext m_StaticRefineContext;
 
     int32_t m_FrameIndex = 0;
   };
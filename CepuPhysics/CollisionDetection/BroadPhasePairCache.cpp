@@ -0,0 +1,123 @@
+#include "CepuPhysicsPCH.h"
+#include "BroadPhasePairCache.h"
+#include "Threading/IThreadDispatcher.h"
+
+using namespace CepuUtil;
+
+namespace CepuPhysics
+{
+  BroadPhasePairCache::BroadPhasePairCache(BufferPool& pool, int32_t initialPairCapacity)
+    : m_Pool(&pool)
+  {
+    pool.TakeAtLeast(initialPairCapacity, m_Pairs);
+    ResizeTable(1 << SpanHelper::GetContainingPowerOf2(glm::max(2, initialPairCapacity * 2)));
+  }
+
+  void BroadPhasePairCache::Dispose()
+  {
+    assert(m_WorkerCount == 0 && "Staged pairs should be flushed before disposing the cache.");
+    m_Pool->Return(m_Pairs);
+    m_Pool->Return(m_Table);
+    m_PairCount = 0;
+  }
+
+  void BroadPhasePairCache::Prepare(IThreadDispatcher* threadDispatcher)
+  {
+    assert(m_WorkerCount == 0 && "The previous frame's staged pairs were never flushed.");
+    m_WorkerCount = threadDispatcher != nullptr ? threadDispatcher->GetThreadCount() : 1;
+    m_Pool->Take(m_WorkerCount, m_Workers);
+    //Pairs are spread across workers, so last frame's pair count split between them is a decent guess at each worker's share.
+    auto initialCapacity = glm::max(64, m_PairCount / m_WorkerCount);
+    for (int32_t i = 0; i < m_WorkerCount; ++i) {
+      auto& worker = m_Workers[i];
+      worker.Pool = threadDispatcher != nullptr ? threadDispatcher->GetThreadMemoryPool(i) : m_Pool;
+      worker.Pairs = QuickList<CollidablePair>(initialCapacity, worker.Pool);
+    }
+  }
+
+  int32_t BroadPhasePairCache::GetHomeSlot(const CollidablePair& pair) const
+  {
+    //Fibonacci hashing; the top bits of the product are the best mixed.
+    return (int32_t)((pair.GetKey() * 0x9E3779B97F4A7C15ull) >> (64 - m_TableShift));
+  }
+
+  bool BroadPhasePairCache::FindSlot(const CollidablePair& pair, int32_t& o_slot) const
+  {
+    o_slot = GetHomeSlot(pair);
+    while (true) {
+      auto pairIndex = m_Table[o_slot];
+      if (pairIndex < 0)
+        return false;
+      if (m_Pairs[pairIndex].Pair == pair)
+        return true;
+      o_slot = (o_slot + 1) & m_TableMask;
+    }
+  }
+
+  int32_t BroadPhasePairCache::IndexOf(const CollidablePair& pair) const
+  {
+    int32_t slot;
+    return FindSlot(pair, slot) ? m_Table[slot] : -1;
+  }
+
+  void BroadPhasePairCache::Insert(const CollidablePair& pair)
+  {
+    if (m_PairCount == m_Pairs.GetLength())
+      m_Pool->ResizeToAtLeast(m_Pairs, m_PairCount * 2, m_PairCount);
+    //Linear probing degrades quickly past half full.
+    if ((m_PairCount + 1) * 2 > m_Table.GetLength())
+      ResizeTable(m_Table.GetLength() * 2);
+    int32_t slot;
+    auto found = FindSlot(pair, slot);
+    assert(!found && "Pairs should only be inserted once.");
+    m_Table[slot] = m_PairCount;
+    m_Pairs[m_PairCount++] = { pair, m_FrameIndex };
+  }
+
+  void BroadPhasePairCache::RemoveAt(int32_t pairIndex)
+  {
+    int32_t slot;
+    auto found = FindSlot(m_Pairs[pairIndex].Pair, slot);
+    assert(found && "Every cached pair should be in the table.");
+    //Backward shift deletion: pull later entries of the probe run back into the hole unless that would move them in front of their home slot.
+    auto next = (slot + 1) & m_TableMask;
+    while (m_Table[next] >= 0) {
+      auto home = GetHomeSlot(m_Pairs[m_Table[next]].Pair);
+      if (((next - home) & m_TableMask) >= ((next - slot) & m_TableMask)) {
+        m_Table[slot] = m_Table[next];
+        slot = next;
+      }
+      next = (next + 1) & m_TableMask;
+    }
+    m_Table[slot] = -1;
+
+    //Keep the pair array dense by moving the last pair into the gap.
+    auto lastIndex = m_PairCount - 1;
+    if (pairIndex != lastIndex) {
+      int32_t lastSlot;
+      found = FindSlot(m_Pairs[lastIndex].Pair, lastSlot);
+      assert(found);
+      m_Table[lastSlot] = pairIndex;
+      m_Pairs[pairIndex] = m_Pairs[lastIndex];
+    }
+    m_PairCount = lastIndex;
+  }
+
+  void BroadPhasePairCache::ResizeTable(int32_t slotCount)
+  {
+    assert((slotCount & (slotCount - 1)) == 0 && "The table relies on masking, so its size must be a power of 2.");
+    if (m_Table.IsAllocated())
+      m_Pool->Return(m_Table);
+    m_Pool->Take(slotCount, m_Table);
+    m_TableMask = slotCount - 1;
+    m_TableShift = SpanHelper::GetContainingPowerOf2(slotCount);
+    for (int32_t i = 0; i < slotCount; ++i)
+      m_Table[i] = -1;
+    for (int32_t pairIndex = 0; pairIndex < m_PairCount; ++pairIndex) {
+      auto slot = GetHomeSlot(m_Pairs[pairIndex].Pair);
+      while (m_Table[slot] >= 0)
+        slot = (slot + 1) & m_TableMask;
+      m_Table[slot] = pairIndex;
+    }
+  }
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include "CollidablePair.h"
+#include "Memory/QuickList.h"
+
+namespace CepuUtil
+{
+  class IThreadDispatcher;
+}
+
+namespace CepuPhysics
+{
+  //Remembers which collidable pairs the broad phase reported last frame, so each frame's overlaps can be turned into begin/persist/end events.
+  //Usage per frame:
+  //  Prepare(threadDispatcher) sets up one staging list per worker.
+  //  HandleOverlap(workerIndex, a, b) stages a pair; it only touches the worker's own list, so workers can call it concurrently.
+  //    That's the signature CollidableOverlapFinder expects from its callbacks, so a CollidableOverlapFinder<BroadPhasePairCache> feeds the cache directly.
+  //  Flush(events) merges the staged pairs into the cache on the calling thread and reports:
+  //    events.PairBegan(CollidablePair)     for pairs that weren't reported last frame,
+  //    events.PairPersisted(CollidablePair) for pairs that were,
+  //    events.PairEnded(CollidablePair)     for pairs from last frame that weren't reported this frame; they're removed from the cache.
+  //Pairs are kept in an open addressed (linear probing) table of indices into a dense pair array, stamped with the last frame they were reported in.
+  class BroadPhasePairCache
+  {
+  public:
+    BroadPhasePairCache(CepuUtil::BufferPool& pool, int32_t initialPairCapacity = 1024);
+    void Dispose();
+
+    //With a null dispatcher (or a single thread) all pairs are staged through worker 0 using the cache's own pool.
+    void Prepare(CepuUtil::IThreadDispatcher* threadDispatcher = nullptr);
+    void HandleOverlap(int32_t workerIndex, CollidableReference a, CollidableReference b)
+    {
+      auto& worker = m_Workers[workerIndex];
+      worker.Pairs.Add(CollidablePair(a, b), worker.Pool);
+    }
+    template<typename TPairEventHandler>
+    void Flush(TPairEventHandler& events);
+
+    int32_t GetPairCount() const { return m_PairCount; }
+    const CollidablePair& GetPair(int32_t pairIndex) const { assert(pairIndex >= 0 && pairIndex < m_PairCount); return m_Pairs[pairIndex].Pair; }
+    //Returns the index of the pair in the dense pair array, or -1 if it's not cached.
+    int32_t IndexOf(const CollidablePair& pair) const;
+    bool Contains(CollidableReference a, CollidableReference b) const { return IndexOf(CollidablePair(a, b)) >= 0; }
+
+  private:
+    struct CachedPair
+    {
+      CollidablePair Pair;
+      int32_t LastSeenFrame;
+    };
+
+    struct WorkerStaging
+    {
+      CepuUtil::QuickList<CollidablePair> Pairs;
+      CepuUtil::BufferPool* Pool;
+    };
+
+    int32_t GetHomeSlot(const CollidablePair& pair) const;
+    bool FindSlot(const CollidablePair& pair, int32_t& o_slot) const;
+    void Insert(const CollidablePair& pair);
+    void RemoveAt(int32_t pairIndex);
+    void ResizeTable(int32_t slotCount);
+
+    CepuUtil::BufferPool* m_Pool;
+    CepuUtil::Buffer<CachedPair> m_Pairs;
+    int32_t m_PairCount = 0;
+    //Indices into m_Pairs, -1 for empty slots. The slot count is a power of 2 kept at least twice the pair count.
+    CepuUtil::Buffer<int32_t> m_Table;
+    int32_t m_TableMask = 0;
+    int32_t m_TableShift = 0;
+    int32_t m_FrameIndex = 0;
+
+    CepuUtil::Buffer<WorkerStaging> m_Workers;
+    int32_t m_WorkerCount = 0;
+  };
+
+  template<typename TPairEventHandler>
+  void BroadPhasePairCache::Flush(TPairEventHandler& events)
+  {
+    for (int32_t workerIndex = 0; workerIndex < m_WorkerCount; ++workerIndex) {
+      auto& worker = m_Workers[workerIndex];
+      for (int32_t i = 0; i < worker.Pairs.m_Count; ++i) {
+        auto& pair = worker.Pairs[i];
+        auto pairIndex = IndexOf(pair);
+        if (pairIndex < 0) {
+          Insert(pair);
+          events.PairBegan(pair);
+        }
+        else if (m_Pairs[pairIndex].LastSeenFrame != m_FrameIndex) {
+          m_Pairs[pairIndex].LastSeenFrame = m_FrameIndex;
+          events.PairPersisted(pair);
+        }
+      }
+      worker.Pairs.Dispose(worker.Pool);
+    }
+    m_Pool->Return(m_Workers);
+    m_WorkerCount = 0;
+    //Removal moves the last pair into the removed slot, so walking backwards visits every pair exactly once.
+    for (int32_t i = m_PairCount - 1; i >= 0; --i) {
+      if (m_Pairs[i].LastSeenFrame != m_FrameIndex) {
+        events.PairEnded(m_Pairs[i].Pair);
+        RemoveAt(i);
+      }
+    }
+    //Every cached pair now carries the current stamp, so the stamps only have to differ from one frame to the next.
+    m_FrameIndex = m_FrameIndex == INT32_MAX ? 0 : m_FrameIndex + 1;
+  }
+}
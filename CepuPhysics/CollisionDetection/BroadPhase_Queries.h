@@ -0,0 +1,93 @@
+#pragma once
+#include "BroadPhase.h"
+#include "Trees/Tree_VolumeQueries.h"
+#include "Trees/Tree_Sweep.h"
+#include "Trees/Tree_RayCast.h"
+
+namespace CepuPhysics
+{
+  //Translates leaf indices of one of the broad phase's trees into the collidables they belong to.
+  template<typename TOverlapHandler>
+  struct BroadPhaseLeafHandler
+  {
+    const CepuUtil::Buffer<CollidableReference>& m_Leaves;
+    TOverlapHandler& m_Inner;
+    bool Handle(int32_t leafIndex) { return m_Inner.Handle(m_Leaves[leafIndex]); }
+  };
+
+  //Translates (tree, leaf) pairs from a sweep over both trees into collidables. The active tree is tree 0.
+  template<typename TSweepHandler>
+  struct BroadPhaseSweepHandler
+  {
+    const CepuUtil::Buffer<CollidableReference>& m_ActiveLeaves;
+    const CepuUtil::Buffer<CollidableReference>& m_StaticLeaves;
+    TSweepHandler& m_Inner;
+    void TestLeaf(int32_t treeIndex, int32_t leafIndex, float t, float& maximumT)
+    {
+      m_Inner.TestLeaf(treeIndex == 0 ? m_ActiveLeaves[leafIndex] : m_StaticLeaves[leafIndex], t, maximumT);
+    }
+  };
+
+  //Translates leaf indices of one of the broad phase's trees into collidables for ray testers.
+  template<typename TRayTester>
+  struct BroadPhaseRayLeafTester
+  {
+    const CepuUtil::Buffer<CollidableReference>& m_Leaves;
+    TRayTester& m_Inner;
+    void TestLeaf(int32_t leafIndex, const RayData& ray, float& maximumT) { m_Inner.TestLeaf(m_Leaves[leafIndex], ray, maximumT); }
+  };
+
+  template<typename TVolume, typename TOverlapHandler>
+  bool BroadPhase::GetOverlapsWithVolume(const TVolume& volume, TOverlapHandler& results) const
+  {
+    BroadPhaseLeafHandler<TOverlapHandler> activeResults{ m_ActiveLeaves, results };
+    if (!CepuPhysics::GetOverlapsWithVolume(m_ActiveTree, volume, activeResults))
+      return false;
+    BroadPhaseLeafHandler<TOverlapHandler> staticResults{ m_StaticLeaves, results };
+    return CepuPhysics::GetOverlapsWithVolume(m_StaticTree, volume, staticResults);
+  }
+
+  template<typename TOverlapHandler>
+  bool BroadPhase::GetOverlaps(const CepuUtil::BoundingBox& bounds, TOverlapHandler& results) const
+  {
+    if (!m_StaticQueryTreeValid)
+      return GetOverlapsWithVolume(BoxQueryVolume{ bounds.m_Min, bounds.m_Max }, results);
+    BroadPhaseLeafHandler<TOverlapHandler> activeResults{ m_ActiveLeaves, results };
+    if (!CepuPhysics::GetOverlaps(m_ActiveTree, bounds, activeResults))
+      return false;
+    BroadPhaseLeafHandler<TOverlapHandler> staticResults{ m_StaticLeaves, results };
+    return m_StaticQueryTree.GetOverlaps(bounds.m_Min, bounds.m_Max, staticResults);
+  }
+
+  template<typename TOverlapHandler>
+  bool BroadPhase::GetOverlaps(const glm::vec3& center, float radius, TOverlapHandler& results) const
+  {
+    return GetOverlapsWithVolume(SphereQueryVolume{ center, radius }, results);
+  }
+
+  template<typename TOverlapHandler>
+  bool BroadPhase::GetOverlaps(const Frustum& frustum, TOverlapHandler& results) const
+  {
+    return GetOverlapsWithVolume(frustum, results);
+  }
+
+  template<typename TSweepHandler>
+  void BroadPhase::Sweep(const CepuUtil::BoundingBox& bounds, const glm::vec3& velocity, float maximumT, TSweepHandler& results) const
+  {
+    const Tree* trees[] = { &m_ActiveTree, &m_StaticTree };
+    BroadPhaseSweepHandler<TSweepHandler> treeResults{ m_ActiveLeaves, m_StaticLeaves, results };
+    CepuPhysics::Sweep(trees, 2, bounds, velocity, maximumT, *m_Pool, treeResults);
+  }
+
+  template<typename TRayTester>
+  void BroadPhase::RayCast(const glm::vec3& origin, const glm::vec3& direction, float& io_maximumT, TRayTester& leafTester, int32_t id) const
+  {
+    BroadPhaseRayLeafTester<TRayTester> activeTester{ m_ActiveLeaves, leafTester };
+    CepuPhysics::RayCast(m_ActiveTree, origin, direction, io_maximumT, activeTester, id);
+    BroadPhaseRayLeafTester<TRayTester> staticTester{ m_StaticLeaves, leafTester };
+    if (m_StaticQueryTreeValid)
+      m_StaticQueryTree.RayCast(origin, direction, io_maximumT, staticTester, id);
+    else
+      CepuPhysics::RayCast(m_StaticTree, origin, direction, io_maximumT, staticTester, id);
+  }
+}
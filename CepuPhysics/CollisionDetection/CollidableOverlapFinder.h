@@ -1,38 +1,102 @@
 #pragma once
 #include "Trees/Tree_SelfQueries.h"
+#include "Trees/Tree_SelfQueriesMultithreaded.h"
+#include "Trees/Tree_IntertreeQueries.h"
+#include "Trees/Tree_IntertreeQueriesMultithreaded.h"
+#include "BroadPhase.h"
 
 namespace CepuPhysics
 {
   class ICollidableOverlapFinder
   {
-    virtual void DispatchOverlaps(float dt) = 0;
+  public:
+    virtual ~ICollidableOverlapFinder() = default;
+    virtual void DispatchOverlaps(float dt, CepuUtil::IThreadDispatcher* threadDispatcher = nullptr) = 0;
   };
 
-  //The overlap finder requires type knowledge about the narrow phase that the broad phase lacks. Don't really want to infect the broad phase with a bunch of narrow phase dependent 
+  //The overlap finder requires type knowledge about the narrow phase that the broad phase lacks. Don't really want to infect the broad phase with a bunch of narrow phase dependent
   //generic parameters, so instead we just explicitly create a type-aware overlap finder to help the broad phase.
+  //@TODO (alektron) There is no narrow phase yet. Until there is, overlaps are handed straight to the callbacks through
+  //TNarrowPhaseCallbacks::HandleOverlap(int32_t workerIndex, CollidableReference a, CollidableReference b), which must be safe to call from multiple workers at once.
+  //BroadPhasePairCache implements exactly that, for callers that want begin/persist/end events instead of the raw overlaps.
   template<typename TNarrowPhaseCallbacks>
   class CollidableOverlapFinder : public ICollidableOverlapFinder
   {
   public:
     struct SelfOverlapHandler : public IOverlapHandler
     {
+      SelfOverlapHandler() = default;
+      SelfOverlapHandler(CepuUtil::Buffer<CollidableReference> leaves, TNarrowPhaseCallbacks* callbacks, int32_t workerIndex)
+        : m_Leaves(leaves), m_Callbacks(callbacks), m_WorkerIndex(workerIndex) {}
+
+      virtual void Handle(int32_t indexA, int32_t indexB) override
+      {
+        m_Callbacks->HandleOverlap(m_WorkerIndex, m_Leaves[indexA], m_Leaves[indexB]);
+      }
 
+      CepuUtil::Buffer<CollidableReference> m_Leaves;
+      TNarrowPhaseCallbacks* m_Callbacks = nullptr;
+      int32_t m_WorkerIndex = 0;
     };
 
     struct IntertreeOverlapHandler : public IOverlapHandler
     {
+      IntertreeOverlapHandler() = default;
+      IntertreeOverlapHandler(CepuUtil::Buffer<CollidableReference> leavesA, CepuUtil::Buffer<CollidableReference> leavesB, TNarrowPhaseCallbacks* callbacks, int32_t workerIndex)
+        : m_LeavesA(leavesA), m_LeavesB(leavesB), m_Callbacks(callbacks), m_WorkerIndex(workerIndex) {}
+
+      virtual void Handle(int32_t indexA, int32_t indexB) override
+      {
+        m_Callbacks->HandleOverlap(m_WorkerIndex, m_LeavesA[indexA], m_LeavesB[indexB]);
+      }
 
+      CepuUtil::Buffer<CollidableReference> m_LeavesA;
+      CepuUtil::Buffer<CollidableReference> m_LeavesB;
+      TNarrowPhaseCallbacks* m_Callbacks = nullptr;
+      int32_t m_WorkerIndex = 0;
     };
 
-    virtual void DispatchOverlaps(float dt) override
-    {
-      static_assert(MULTITHREADING_UNSUPPORTED);
+    CollidableOverlapFinder(BroadPhase* broadPhase, TNarrowPhaseCallbacks* callbacks)
+      : m_BroadPhase(broadPhase), m_Callbacks(callbacks) {}
 
-      SelfOverlapHandler selfTestHandler(m_BroadPhase->m_ActiveLeaves);
-      GetSelfOverlaps(m_BroadPhase->m_ActiveTree, selfTestHandler);
+    virtual void DispatchOverlaps(float dt, CepuUtil::IThreadDispatcher* threadDispatcher = nullptr) override
+    {
+      if (threadDispatcher != nullptr && threadDispatcher->GetThreadCount() > 1) {
+        auto threadCount = threadDispatcher->GetThreadCount();
+        m_SelfHandlers.resize(threadCount);
+        m_IntertreeHandlers.resize(threadCount);
+        for (int32_t i = 0; i < threadCount; ++i) {
+          m_SelfHandlers[i] = SelfOverlapHandler(m_BroadPhase->m_ActiveLeaves, m_Callbacks, i);
+          m_IntertreeHandlers[i] = IntertreeOverlapHandler(m_BroadPhase->m_ActiveLeaves, m_BroadPhase->m_StaticLeaves, m_Callbacks, i);
+        }
+        m_SelfTestContext.PrepareJobs(m_BroadPhase->m_ActiveTree, m_SelfHandlers.data(), threadCount, m_BroadPhase->m_Pool);
+        m_IntertreeTestContext.PrepareJobs(m_BroadPhase->m_ActiveTree, m_BroadPhase->m_StaticTree, m_IntertreeHandlers.data(), threadCount, m_BroadPhase->m_Pool);
+        //Both tests share a single dispatch; the self test jobs come first in the combined index space.
+        auto selfJobCount = m_SelfTestContext.GetJobCount();
+        threadDispatcher->DispatchTasks(selfJobCount + m_IntertreeTestContext.GetJobCount(), [this, selfJobCount](int32_t jobIndex, int32_t workerIndex) {
+          if (jobIndex < selfJobCount)
+            m_SelfTestContext.ExecuteJob(jobIndex, workerIndex);
+          else
+            m_IntertreeTestContext.ExecuteJob(jobIndex - selfJobCount, workerIndex);
+        });
+        m_SelfTestContext.CompleteSelfTest();
+        m_IntertreeTestContext.CompleteTest();
+      }
+      else {
+        SelfOverlapHandler selfTestHandler(m_BroadPhase->m_ActiveLeaves, m_Callbacks, 0);
+        GetSelfOverlaps(m_BroadPhase->m_ActiveTree, selfTestHandler);
+        IntertreeOverlapHandler intertreeHandler(m_BroadPhase->m_ActiveLeaves, m_BroadPhase->m_StaticLeaves, m_Callbacks, 0);
+        GetOverlaps(m_BroadPhase->m_ActiveTree, m_BroadPhase->m_StaticTree, intertreeHandler);
+      }
     }
 
     BroadPhase* m_BroadPhase = nullptr;
+    TNarrowPhaseCallbacks* m_Callbacks = nullptr;
 
+  private:
+    MultithreadedSelfTest<SelfOverlapHandler> m_SelfTestContext;
+    MultithreadedIntertreeTest<IntertreeOverlapHandler> m_IntertreeTestContext;
+    std::vector<SelfOverlapHandler> m_SelfHandlers;
+    std::vector<IntertreeOverlapHandler> m_IntertreeHandlers;
   };
-}
\ No newline at end of file
+}
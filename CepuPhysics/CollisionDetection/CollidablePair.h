@@ -0,0 +1,28 @@
+#pragma once
+#include "Collidables/CollidableReference.h"
+
+namespace CepuPhysics
+{
+  //Unordered pair of collidables. The constructor sorts the references so that (a, b) and (b, a) produce the same pair.
+  struct CollidablePair
+  {
+    CollidablePair() = default;
+    CollidablePair(CollidableReference a, CollidableReference b)
+    {
+      if (a.m_Packed <= b.m_Packed) {
+        A = a;
+        B = b;
+      }
+      else {
+        A = b;
+        B = a;
+      }
+    }
+
+    uint64_t GetKey() const { return ((uint64_t)A.m_Packed << 32) | B.m_Packed; }
+    bool operator==(const CollidablePair& other) const { return A.m_Packed == other.A.m_Packed && B.m_Packed == other.B.m_Packed; }
+
+    CollidableReference A;
+    CollidableReference B;
+  };
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include "BoxPairTester.h"
+#include "Collidables/Shapes.h"
+#include "Collidables/TypedIndex.h"
+#include "Memory/QuickList.h"
+
+namespace CepuPhysics
+{
+  struct ConvexPairInstance
+  {
+    int32_t m_ShapeIndexA;
+    int32_t m_ShapeIndexB;
+    glm::vec3 m_OffsetB;
+    glm::quat m_OrientationA;
+    glm::quat m_OrientationB;
+    float m_SpeculativeMargin;
+    int32_t m_PairId;
+    //Set when the pair was added with its shapes in the opposite order of the registered tester; the manifold is flipped back before it's reported.
+    bool m_Flipped;
+  };
+
+  //Collects convex pairs by shape type pair and runs each type pair's wide tester over them Vector::COUNT pairs at a time.
+  //Completed manifolds are reported as callbacks->OnPairCompleted(int32_t pairId, const ConvexContactManifold& manifold), in no particular order.
+  //Pairs whose type pair has no registered tester are dropped without a report.
+  //Like BoundingBoxBatcher, batching keeps the type dispatch out of the per pair path and lets each tester work through contiguous bundles.
+  //Not thread safe; multithreaded narrow phases give each worker its own batcher.
+  template<typename TCallbacks>
+  class CollisionBatcher
+  {
+  public:
+    //Number of pairs accumulated per type pair before they're tested. A multiple of every Vector::COUNT so full flushes leave no partial bundles.
+    static const int32_t PAIRS_PER_FLUSH = 32;
+    static_assert(PAIRS_PER_FLUSH % CepuUtil::Vector::COUNT == 0, "Flushes should consist of whole bundles.");
+    static const int32_t TYPE_PAIR_COUNT = Shapes::MAX_SHAPE_BATCHES * Shapes::MAX_SHAPE_BATCHES;
+
+    CollisionBatcher(Shapes* shapes, CepuUtil::BufferPool* pool, TCallbacks* callbacks)
+      : m_Shapes(shapes), m_Pool(pool), m_Callbacks(callbacks)
+    {
+      pool->Take(TYPE_PAIR_COUNT, m_Batches);
+      //We rely on the span being unallocated to begin with for lazy initialization.
+      m_Batches.Clear(0, TYPE_PAIR_COUNT);
+      for (int32_t i = 0; i < TYPE_PAIR_COUNT; ++i)
+        m_Testers[i] = nullptr;
+      RegisterConvexTester<Box, Box, BoxPairTester>();
+    }
+
+    //Registers the wide tester for a type pair. TPairTester::Test takes (const TShapeA::Wide&, const TShapeB::Wide&, const Vector& speculativeMargin,
+    //const Vector3Wide& offsetB, const QuaternionWide& orientationA, const QuaternionWide& orientationB, Convex4ContactManifoldWide&).
+    //Pairs added in the opposite order are flipped to match.
+    template<typename TShapeA, typename TShapeB, typename TPairTester>
+    void RegisterConvexTester()
+    {
+      auto typeA = TShapeA().GetTypeId();
+      auto typeB = TShapeB().GetTypeId();
+      assert(typeA <= typeB && "Testers are looked up with the lower type id first.");
+      m_Testers[typeA * Shapes::MAX_SHAPE_BATCHES + typeB] = &CollisionBatcher::ExecuteConvexBatch<TShapeA, TShapeB, TPairTester>;
+    }
+
+    //Queues a pair of convex shapes. offsetB is the offset from A's position to B's.
+    void Add(TypedIndex shapeA, TypedIndex shapeB, const glm::vec3& offsetB, const glm::quat& orientationA, const glm::quat& orientationB, float speculativeMargin, int32_t pairId)
+    {
+      auto typeA = shapeA.GetType();
+      auto typeB = shapeB.GetType();
+      auto flipped = typeA > typeB;
+      auto typePairIndex = flipped ? typeB * Shapes::MAX_SHAPE_BATCHES + typeA : typeA * Shapes::MAX_SHAPE_BATCHES + typeB;
+      if (m_Testers[typePairIndex] == nullptr)
+        return;
+      auto& batch = m_Batches[typePairIndex];
+      if (!batch.m_Span.IsAllocated())
+        batch = CepuUtil::QuickList<ConvexPairInstance>(PAIRS_PER_FLUSH, m_Pool);
+      auto& pair = batch.AllocateUnsafely();
+      if (flipped) {
+        pair.m_ShapeIndexA = shapeB.GetIndex();
+        pair.m_ShapeIndexB = shapeA.GetIndex();
+        pair.m_OffsetB = -offsetB;
+        pair.m_OrientationA = orientationB;
+        pair.m_OrientationB = orientationA;
+      }
+      else {
+        pair.m_ShapeIndexA = shapeA.GetIndex();
+        pair.m_ShapeIndexB = shapeB.GetIndex();
+        pair.m_OffsetB = offsetB;
+        pair.m_OrientationA = orientationA;
+        pair.m_OrientationB = orientationB;
+      }
+      pair.m_SpeculativeMargin = speculativeMargin;
+      pair.m_PairId = pairId;
+      pair.m_Flipped = flipped;
+      if (batch.m_Count == PAIRS_PER_FLUSH) {
+        (this->*m_Testers[typePairIndex])(batch);
+        batch.m_Count = 0;
+      }
+    }
+
+    //Tests every queued pair and returns the batcher's memory to the pool. The batcher can't be used afterwards.
+    void Flush()
+    {
+      for (int32_t i = 0; i < TYPE_PAIR_COUNT; ++i) {
+        auto& batch = m_Batches[i];
+        if (!batch.m_Span.IsAllocated())
+          continue;
+        if (batch.m_Count > 0)
+          (this->*m_Testers[i])(batch);
+        batch.Dispose(m_Pool);
+      }
+      m_Pool->Return(m_Batches);
+    }
+
+  private:
+    using BatchTester = void (CollisionBatcher::*)(const CepuUtil::QuickList<ConvexPairInstance>& pairs);
+
+    template<typename TShapeA, typename TShapeB, typename TPairTester>
+    void ExecuteConvexBatch(const CepuUtil::QuickList<ConvexPairInstance>& pairs)
+    {
+      auto& shapesA = static_cast<ShapeBatchT<TShapeA>&>(*m_Shapes->GetBatch(TShapeA().GetTypeId()));
+      auto& shapesB = static_cast<ShapeBatchT<TShapeB>&>(*m_Shapes->GetBatch(TShapeB().GetTypeId()));
+      typename TShapeA::Wide a;
+      typename TShapeB::Wide b;
+      CepuUtil::Vector speculativeMargins;
+      CepuUtil::Vector3Wide offsetsB;
+      CepuUtil::QuaternionWide orientationsA, orientationsB;
+      Convex4ContactManifoldWide manifoldsWide;
+      ConvexContactManifold manifold;
+      for (int32_t bundleStart = 0; bundleStart < pairs.m_Count; bundleStart += CepuUtil::Vector::COUNT) {
+        auto countInBundle = glm::min(CepuUtil::Vector::COUNT, pairs.m_Count - bundleStart);
+        for (int32_t i = 0; i < countInBundle; ++i) {
+          auto& pair = pairs[bundleStart + i];
+          a.WriteSlot(i, shapesA[pair.m_ShapeIndexA]);
+          b.WriteSlot(i, shapesB[pair.m_ShapeIndexB]);
+          speculativeMargins[i] = pair.m_SpeculativeMargin;
+          offsetsB.WriteSlot(i, pair.m_OffsetB);
+          orientationsA.WriteSlot(i, pair.m_OrientationA);
+          orientationsB.WriteSlot(i, pair.m_OrientationB);
+        }
+        TPairTester::Test(a, b, speculativeMargins, offsetsB, orientationsA, orientationsB, manifoldsWide);
+        for (int32_t i = 0; i < countInBundle; ++i) {
+          auto& pair = pairs[bundleStart + i];
+          manifoldsWide.ReadSlot(i, pair.m_OffsetB, manifold);
+          if (pair.m_Flipped) {
+            //The tester saw B first, so the stored offset is the negated original. Move the contacts back to be relative to A and point the normal from B to A again.
+            for (int32_t j = 0; j < manifold.m_Count; ++j)
+              manifold.m_Contacts[j].m_Offset -= pair.m_OffsetB;
+            manifold.m_OffsetB = -pair.m_OffsetB;
+            manifold.m_Normal = -manifold.m_Normal;
+          }
+          m_Callbacks->OnPairCompleted(pair.m_PairId, manifold);
+        }
+      }
+    }
+
+    Shapes* m_Shapes = nullptr;
+    CepuUtil::BufferPool* m_Pool = nullptr;
+    TCallbacks* m_Callbacks = nullptr;
+
+    //One list per type pair, indexed by lowerType * MAX_SHAPE_BATCHES + higherType and lazily allocated on first use.
+    CepuUtil::Buffer<CepuUtil::QuickList<ConvexPairInstance>> m_Batches;
+    BatchTester m_Testers[TYPE_PAIR_COUNT];
+  };
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "Math/Vector3Wide.h"
+
+namespace CepuPhysics
+{
+  struct ConvexContact
+  {
+    //Location of the contact relative to collidable A's position.
+    glm::vec3 m_Offset;
+    //Penetration depth along the manifold normal. Negative for speculative contacts between separated shapes.
+    float m_Depth;
+    //Identifies the pair of features that produced the contact, so contacts can be matched up with last frame's for warm starting.
+    int32_t m_FeatureId;
+  };
+
+  //Up to 4 contacts sharing one normal, as generated between two convex shapes.
+  struct ConvexContactManifold
+  {
+    static const int32_t MAX_CONTACT_COUNT = 4;
+
+    //Offset from collidable A's position to collidable B's.
+    glm::vec3 m_OffsetB;
+    //Points from B to A, so pushing A along the normal and B against it separates them.
+    glm::vec3 m_Normal;
+    int32_t m_Count;
+    ConvexContact m_Contacts[MAX_CONTACT_COUNT];
+  };
+
+  //Vector.COUNT convex manifolds of up to 4 contacts each, stored component-wise as produced by wide pair testers.
+  //Contact slots aren't compacted; m_ContactExists holds a lane mask per slot. Feature ids are small integers carried in float lanes, which is exact for anything below 2^24.
+  struct Convex4ContactManifoldWide
+  {
+    //Gathers the contacts that exist in the given lane into a scalar manifold.
+    void ReadSlot(int32_t slotIndex, const glm::vec3& offsetB, ConvexContactManifold& o_manifold) const
+    {
+      o_manifold.m_OffsetB = offsetB;
+      o_manifold.m_Normal = m_Normal.ReadSlot(slotIndex);
+      o_manifold.m_Count = 0;
+      for (int32_t i = 0; i < ConvexContactManifold::MAX_CONTACT_COUNT; ++i) {
+        if ((CepuUtil::GetMask(m_ContactExists[i]) & (1 << slotIndex)) == 0)
+          continue;
+        auto& contact = o_manifold.m_Contacts[o_manifold.m_Count++];
+        contact.m_Offset = m_OffsetA[i].ReadSlot(slotIndex);
+        contact.m_Depth = m_Depth[i][slotIndex];
+        contact.m_FeatureId = (int32_t)m_FeatureId[i][slotIndex];
+      }
+    }
+
+    CepuUtil::Vector3Wide m_OffsetA[ConvexContactManifold::MAX_CONTACT_COUNT];
+    CepuUtil::Vector m_Depth[ConvexContactManifold::MAX_CONTACT_COUNT];
+    CepuUtil::Vector m_FeatureId[ConvexContactManifold::MAX_CONTACT_COUNT];
+    CepuUtil::Vector m_ContactExists[ConvexContactManifold::MAX_CONTACT_COUNT];
+    CepuUtil::Vector3Wide m_Normal;
+  };
+}
@@ -0,0 +1,93 @@
+#include "CepuPhysicsPCH.h"
+#include "PairCache.h"
+#include "Threading/IThreadDispatcher.h"
+
+using namespace CepuUtil;
+
+namespace CepuPhysics
+{
+  PairCache::PairCache(BufferPool& pool, int32_t initialPairCapacity, int32_t minimumPendingSize, int32_t minimumPerTypeCapacity)
+    : m_Pool(&pool), m_MinimumPendingSize(minimumPendingSize), m_MinimumPerTypeCapacity(minimumPerTypeCapacity),
+      m_Mapping(initialPairCapacity, &pool)
+  {
+    PrepareFreshness();
+  }
+
+  void PairCache::Dispose()
+  {
+    assert(m_NextWorkerCount == 0 && "This frame's caches should be flushed before disposing the pair cache.");
+    for (int32_t i = 0; i < m_WorkerCount; ++i)
+      m_WorkerCaches[i].Dispose();
+    if (m_WorkerCaches.IsAllocated())
+      m_Pool->Return(m_WorkerCaches);
+    m_WorkerCount = 0;
+    m_Mapping.Dispose(m_Pool);
+    m_Pool->Return(m_PairFreshness);
+  }
+
+  void PairCache::Prepare(IThreadDispatcher* threadDispatcher)
+  {
+    assert(m_NextWorkerCount == 0 && "The previous frame's caches were never flushed.");
+    //Size this frame's caches after the largest per-type usage of any worker last frame.
+    WorkerPairCache::PreallocationSizes minimumSizesPerConstraintType[MAX_PAIR_CACHE_TYPES] = {};
+    WorkerPairCache::PreallocationSizes minimumSizesPerCollisionType[MAX_PAIR_CACHE_TYPES] = {};
+    int32_t pendingCapacity = m_MinimumPendingSize;
+    for (int32_t i = 0; i < m_WorkerCount; ++i) {
+      auto& workerCache = m_WorkerCaches[i];
+      workerCache.AccumulateMinimumSizes(minimumSizesPerConstraintType, minimumSizesPerCollisionType);
+      pendingCapacity = glm::max(pendingCapacity, workerCache.m_PendingAdds.m_Count);
+    }
+    m_NextWorkerCount = threadDispatcher != nullptr ? threadDispatcher->GetThreadCount() : 1;
+    m_Pool->Take(m_NextWorkerCount, m_NextWorkerCaches);
+    for (int32_t i = 0; i < m_NextWorkerCount; ++i) {
+      auto pool = threadDispatcher != nullptr ? threadDispatcher->GetThreadMemoryPool(i) : m_Pool;
+      m_NextWorkerCaches[i] = WorkerPairCache(i, pool, minimumSizesPerConstraintType, minimumSizesPerCollisionType, pendingCapacity, m_MinimumPerTypeCapacity);
+    }
+  }
+
+  void PairCache::Flush()
+  {
+    struct NoStalePairHandler
+    {
+      void PairRemoved(const CollidablePair&, const CollidablePairPointers&) {}
+    };
+    NoStalePairHandler handler;
+    Flush(handler);
+  }
+
+  void PairCache::PrepareFreshness()
+  {
+    //Freshness is indexed like the mapping's dense arrays, so it tracks their capacity.
+    if (m_PairFreshness.GetLength() != m_Mapping.m_Keys.GetLength()) {
+      if (m_PairFreshness.IsAllocated())
+        m_Pool->Return(m_PairFreshness);
+      m_Pool->Take(m_Mapping.m_Keys.GetLength(), m_PairFreshness);
+    }
+    m_PairFreshness.Clear(0, m_PairFreshness.GetLength());
+  }
+
+  void PairCache::CompleteFlush(int32_t pendingAddCount)
+  {
+    //Resize once up front instead of letting individual adds grow the mapping.
+    m_Mapping.EnsureCapacity(m_Mapping.m_Count + pendingAddCount, m_Pool);
+    for (int32_t workerIndex = 0; workerIndex < m_NextWorkerCount; ++workerIndex) {
+      auto& pendingAdds = m_NextWorkerCaches[workerIndex].m_PendingAdds;
+      for (int32_t i = 0; i < pendingAdds.m_Count; ++i) {
+        auto& pendingAdd = pendingAdds[i];
+        auto added = m_Mapping.Add(pendingAdd.Pair, pendingAdd.Pointers, m_Pool);
+        assert(added && "A pair should only be added once per frame, and only if it wasn't in the mapping already.");
+      }
+    }
+    PrepareFreshness();
+
+    //Every surviving pair now points into this frame's caches, so last frame's can go.
+    for (int32_t i = 0; i < m_WorkerCount; ++i)
+      m_WorkerCaches[i].Dispose();
+    if (m_WorkerCaches.IsAllocated())
+      m_Pool->Return(m_WorkerCaches);
+    m_WorkerCaches = m_NextWorkerCaches;
+    m_WorkerCount = m_NextWorkerCount;
+    m_NextWorkerCaches = Buffer<WorkerPairCache>();
+    m_NextWorkerCount = 0;
+  }
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include "WorkerPairCache.h"
+#include "Memory/QuickDictionary.h"
+
+namespace CepuUtil
+{
+  class IThreadDispatcher;
+}
+
+namespace CepuPhysics
+{
+  struct CollidablePairComparer
+  {
+    static int32_t Hash(const CollidablePair& pair) { return (int32_t)(pair.A.m_Packed ^ (pair.B.m_Packed * 0x9E3779B9u)); }
+    static bool Equals(const CollidablePair& a, const CollidablePair& b) { return a == b; }
+  };
+
+  //Persistent per-pair storage for the narrow phase: maps every collidable pair with contacts to its constraint and collision detection caches.
+  //Usage per frame:
+  //  Prepare(threadDispatcher) creates one worker cache per thread for this frame, preallocated from what last frame's workers used.
+  //  During the narrow phase, each worker:
+  //    looks the pair up with IndexOf, and for existing pairs reads last frame's caches through GetPointers/GetConstraintCache/GetCollisionCache,
+  //    writes this frame's caches with GetWorkerCache(workerIndex).AddConstraintCache/AddCollisionCache,
+  //    and records them with Update(pairIndex, pointers) for existing pairs or Add(workerIndex, pair, pointers) for new ones.
+  //    Workers only touch their own worker cache and the mapping entries of the pairs they handle, so none of this needs synchronization.
+  //  Flush(handler) runs on the main thread: pairs that weren't updated are removed (reported as handler.PairRemoved(CollidablePair, CollidablePairPointers) first,
+  //  while their caches are still readable), staged adds are merged into the mapping, and last frame's worker caches are released.
+  //All caches live in the worker threads' pools and are returned every frame, so once the pools have seen the peak load, frames don't allocate.
+  class PairCache
+  {
+  public:
+    PairCache(CepuUtil::BufferPool& pool, int32_t initialPairCapacity = 1024, int32_t minimumPendingSize = 128, int32_t minimumPerTypeCapacity = 128);
+    void Dispose();
+
+    //With a null dispatcher (or a single thread) all caches are written through worker 0 using the pair cache's own pool.
+    void Prepare(CepuUtil::IThreadDispatcher* threadDispatcher = nullptr);
+
+    //Index of the pair in the mapping, or -1 if it had no caches last frame.
+    int32_t IndexOf(const CollidablePair& pair) const { return m_Mapping.IndexOf(pair); }
+    int32_t GetPairCount() const { return m_Mapping.m_Count; }
+    const CollidablePair& GetPair(int32_t pairIndex) const { return m_Mapping.m_Keys[pairIndex]; }
+    const CollidablePairPointers& GetPointers(int32_t pairIndex) const { return m_Mapping.m_Values[pairIndex]; }
+
+    //Last frame's caches. Valid until the next Flush.
+    template<typename TCache>
+    TCache& GetConstraintCache(PairCacheIndex index) { return m_WorkerCaches[index.GetWorker()].GetConstraintCache<TCache>(index); }
+    template<typename TCache>
+    TCache& GetCollisionCache(PairCacheIndex index) { return m_WorkerCaches[index.GetWorker()].GetCollisionCache<TCache>(index); }
+
+    //This frame's cache for the given worker.
+    WorkerPairCache& GetWorkerCache(int32_t workerIndex) { assert(workerIndex >= 0 && workerIndex < m_NextWorkerCount); return m_NextWorkerCaches[workerIndex]; }
+
+    //Points an existing pair at the caches written for it this frame and keeps it alive through the next Flush.
+    void Update(int32_t pairIndex, const CollidablePairPointers& pointers)
+    {
+      assert(pairIndex >= 0 && pairIndex < m_Mapping.m_Count);
+      m_Mapping.m_Values[pairIndex] = pointers;
+      m_PairFreshness[pairIndex] = 1;
+    }
+    //Stages a pair that isn't in the mapping yet; it becomes visible after the next Flush.
+    void Add(int32_t workerIndex, const CollidablePair& pair, const CollidablePairPointers& pointers) { GetWorkerCache(workerIndex).StageAdd(pair, pointers); }
+
+    template<typename TStalePairHandler>
+    void Flush(TStalePairHandler& handler);
+    void Flush();
+
+  private:
+    void PrepareFreshness();
+    void CompleteFlush(int32_t pendingAddCount);
+
+    CepuUtil::BufferPool* m_Pool;
+    int32_t m_MinimumPendingSize;
+    int32_t m_MinimumPerTypeCapacity;
+
+    CepuUtil::QuickDictionary<CollidablePair, CollidablePairPointers, CollidablePairComparer> m_Mapping;
+    //One byte per mapping slot, set when the pair was updated this frame. Workers write distinct bytes, so no atomics are needed.
+    CepuUtil::Buffer<uint8_t> m_PairFreshness;
+
+    //Caches written last frame; the mapping's pointers refer to these until Flush.
+    CepuUtil::Buffer<WorkerPairCache> m_WorkerCaches;
+    int32_t m_WorkerCount = 0;
+    //Caches being written this frame.
+    CepuUtil::Buffer<WorkerPairCache> m_NextWorkerCaches;
+    int32_t m_NextWorkerCount = 0;
+  };
+
+  template<typename TStalePairHandler>
+  void PairCache::Flush(TStalePairHandler& handler)
+  {
+    int32_t pendingAddCount = 0;
+    for (int32_t i = 0; i < m_NextWorkerCount; ++i)
+      pendingAddCount += m_NextWorkerCaches[i].m_PendingAdds.m_Count;
+    //Removal moves the last pair into the removed slot, so walking backwards visits every pair exactly once.
+    for (int32_t i = m_Mapping.m_Count - 1; i >= 0; --i) {
+      if (m_PairFreshness[i] == 0) {
+        handler.PairRemoved(m_Mapping.m_Keys[i], m_Mapping.m_Values[i]);
+        m_Mapping.FastRemoveAt(i);
+      }
+    }
+    CompleteFlush(pendingAddCount);
+  }
+}
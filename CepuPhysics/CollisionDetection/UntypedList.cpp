@@ -43,4 +43,12 @@ namespace CepuPhysics
     return byteIndex;
   }
 
+  void UntypedList::Dispose(CepuUtil::BufferPool* pool)
+  {
+    if (m_Buffer.IsAllocated())
+      pool->Return(m_Buffer);
+    m_Count = 0;
+    m_ByteCount = 0;
+    m_ElementSizeInBytes = 0;
+  }
 }
@@ -5,8 +5,12 @@ namespace CepuPhysics
   class UntypedList
   {
   public:
+    //A zeroed list is a valid, unallocated one; the first Allocate takes its buffer.
+    UntypedList() = default;
     UntypedList(int32_t elementSizeInBytes, int32_t initialCapacityInElements, CepuUtil::BufferPool* pool);
     int32_t Allocate(int32_t elementSizeInBytes, int32_t minimumElementCount, CepuUtil::BufferPool* pool);
+    //Returns the buffer to the pool, if one was ever taken, and leaves the list zeroed.
+    void Dispose(CepuUtil::BufferPool* pool);
 
     bool Validate() const { return m_ElementSizeInBytes > 0; }
 
@@ -0,0 +1,50 @@
+#include "CepuPhysicsPCH.h"
+#include "WorkerPairCache.h"
+
+using namespace CepuUtil;
+
+namespace CepuPhysics
+{
+  WorkerPairCache::WorkerPairCache(int32_t workerIndex, BufferPool* pool, const PreallocationSizes* minimumSizesPerConstraintType, const PreallocationSizes* minimumSizesPerCollisionType,
+    int32_t pendingCapacity, int32_t minimumPerTypeCapacity)
+    : m_Pool(pool), m_MinimumPerTypeCapactiy(minimumPerTypeCapacity), m_WorkerIndex(workerIndex)
+  {
+    pool->Take(MAX_PAIR_CACHE_TYPES, m_ConstraintCaches);
+    pool->Take(MAX_PAIR_CACHE_TYPES, m_CollisionCaches);
+    //A zeroed UntypedList is an unallocated one.
+    m_ConstraintCaches.Clear(0, MAX_PAIR_CACHE_TYPES);
+    m_CollisionCaches.Clear(0, MAX_PAIR_CACHE_TYPES);
+    for (int32_t i = 0; i < MAX_PAIR_CACHE_TYPES; ++i) {
+      auto& constraintSizes = minimumSizesPerConstraintType[i];
+      if (constraintSizes.m_ElementCount > 0)
+        m_ConstraintCaches[i] = UntypedList(constraintSizes.m_ElementSizeInBytes, glm::max(constraintSizes.m_ElementCount, minimumPerTypeCapacity), pool);
+      auto& collisionSizes = minimumSizesPerCollisionType[i];
+      if (collisionSizes.m_ElementCount > 0)
+        m_CollisionCaches[i] = UntypedList(collisionSizes.m_ElementSizeInBytes, glm::max(collisionSizes.m_ElementCount, minimumPerTypeCapacity), pool);
+    }
+    m_PendingAdds = QuickList<PendingAdd>(pendingCapacity, pool);
+  }
+
+  void WorkerPairCache::Dispose()
+  {
+    for (int32_t i = 0; i < MAX_PAIR_CACHE_TYPES; ++i) {
+      m_ConstraintCaches[i].Dispose(m_Pool);
+      m_CollisionCaches[i].Dispose(m_Pool);
+    }
+    m_Pool->Return(m_ConstraintCaches);
+    m_Pool->Return(m_CollisionCaches);
+    m_PendingAdds.Dispose(m_Pool);
+  }
+
+  void WorkerPairCache::AccumulateMinimumSizes(PreallocationSizes* minimumSizesPerConstraintType, PreallocationSizes* minimumSizesPerCollisionType) const
+  {
+    for (int32_t i = 0; i < MAX_PAIR_CACHE_TYPES; ++i) {
+      auto& constraintCache = m_ConstraintCaches[i];
+      if (constraintCache.m_Count > minimumSizesPerConstraintType[i].m_ElementCount)
+        minimumSizesPerConstraintType[i] = { constraintCache.m_Count, constraintCache.m_ElementSizeInBytes };
+      auto& collisionCache = m_CollisionCaches[i];
+      if (collisionCache.m_Count > minimumSizesPerCollisionType[i].m_ElementCount)
+        minimumSizesPerCollisionType[i] = { collisionCache.m_Count, collisionCache.m_ElementSizeInBytes };
+    }
+  }
+}
@@ -1,7 +1,47 @@
 #pragma once
+#include "CollidablePair.h"
+#include "UntypedList.h"
+#include "Memory/QuickList.h"
 
 namespace CepuPhysics
 {
+  //Upper bound on the number of distinct constraint cache and collision cache types. Cache type indices must be below this.
+  constexpr const int32_t MAX_PAIR_CACHE_TYPES = 16;
+
+  //Locates a cache within the per-type lists of a worker pair cache.
+  //Packed as: bit 63 set if the cache exists, bits 48-62 worker index, bits 40-47 cache type index, bits 0-39 byte index into the type's list.
+  //A zeroed index refers to nothing, so pairs without a cache of some kind just leave it default constructed.
+  struct PairCacheIndex
+  {
+    PairCacheIndex() = default;
+    PairCacheIndex(int32_t workerIndex, int32_t typeIndex, int32_t byteIndex)
+    {
+      assert(workerIndex >= 0 && workerIndex < (1 << 15));
+      assert(typeIndex >= 0 && typeIndex < MAX_PAIR_CACHE_TYPES);
+      assert(byteIndex >= 0);
+      m_Packed = (1ull << 63) | ((uint64_t)workerIndex << 48) | ((uint64_t)typeIndex << 40) | (uint64_t)byteIndex;
+    }
+
+    bool    Exists  () const { return (m_Packed & (1ull << 63)) != 0; }
+    int32_t GetWorker() const { return (int32_t)((m_Packed >> 48) & 0x7FFF); }
+    int32_t GetType () const { return (int32_t)((m_Packed >> 40) & 0xFF); }
+    int32_t GetIndex() const { return (int32_t)(m_Packed & 0xFFFFFFFFFFull); }
+
+    uint64_t m_Packed = 0;
+  };
+
+  //Where the caches of one collidable pair live.
+  //The constraint cache holds what the contact constraint needs carried across frames (feature ids of the previous contacts, the constraint's handle),
+  //the collision detection cache whatever the pair's collision tester wants to remember (e.g. a separating axis).
+  struct CollidablePairPointers
+  {
+    PairCacheIndex ConstraintCache;
+    PairCacheIndex CollisionDetectionCache;
+  };
+
+  //Caches written by one worker during one frame.
+  //Caches are stored by value in one UntypedList per cache type, so adding a cache is a bump allocation in the worker's own pool and needs no synchronization.
+  //Pairs that didn't exist in the mapping yet are staged in m_PendingAdds and merged by PairCache::Flush on the main thread.
   class WorkerPairCache
   {
   public:
@@ -11,6 +51,33 @@ namespace CepuPhysics
       int32_t m_ElementSizeInBytes;
     };
 
+    struct PendingAdd
+    {
+      CollidablePair Pair;
+      CollidablePairPointers Pointers;
+    };
+
+    WorkerPairCache() = default;
+    //The size arrays hold MAX_PAIR_CACHE_TYPES entries each, typically accumulated from the previous frame's caches. Types with a count of 0 are left unallocated until first used.
+    WorkerPairCache(int32_t workerIndex, CepuUtil::BufferPool* pool, const PreallocationSizes* minimumSizesPerConstraintType, const PreallocationSizes* minimumSizesPerCollisionType,
+      int32_t pendingCapacity, int32_t minimumPerTypeCapacity = 128);
+    void Dispose();
+
+    template<typename TCache>
+    PairCacheIndex AddConstraintCache(int32_t typeIndex, const TCache& cache) { return Add(m_ConstraintCaches, typeIndex, cache); }
+    template<typename TCache>
+    PairCacheIndex AddCollisionCache(int32_t typeIndex, const TCache& cache) { return Add(m_CollisionCaches, typeIndex, cache); }
+
+    template<typename TCache>
+    TCache& GetConstraintCache(PairCacheIndex index) { return Get<TCache>(m_ConstraintCaches, index); }
+    template<typename TCache>
+    TCache& GetCollisionCache(PairCacheIndex index) { return Get<TCache>(m_CollisionCaches, index); }
+
+    void StageAdd(const CollidablePair& pair, const CollidablePairPointers& pointers) { m_PendingAdds.Add({ pair, pointers }, m_Pool); }
+
+    //Raises each entry of the size arrays to at least what this worker used, so the next frame's worker caches can be preallocated to fit.
+    void AccumulateMinimumSizes(PreallocationSizes* minimumSizesPerConstraintType, PreallocationSizes* minimumSizesPerCollisionType) const;
+
     //@TODO (alektron) We do not really have this issue in C++ so we can probably replace this in the future. For now we will stick to the original
     //ORIGINAL COMMENT: note that this reference makes the entire worker pair cache nonblittable. That's why the pair cache uses managed arrays to store the worker caches.
     CepuUtil::BufferPool* m_Pool = nullptr;
@@ -19,7 +86,29 @@ namespace CepuPhysics
 
     //Note that the per-type batches are untyped.
     //The caller will have the necessary type knowledge to interpret the buffer.
-    internal Buffer<UntypedList> constraintCaches;
-    internal Buffer<UntypedList> collisionCaches;
+    CepuUtil::Buffer<UntypedList> m_ConstraintCaches;
+    CepuUtil::Buffer<UntypedList> m_CollisionCaches;
+
+    CepuUtil::QuickList<PendingAdd> m_PendingAdds;
+
+  private:
+    template<typename TCache>
+    PairCacheIndex Add(CepuUtil::Buffer<UntypedList>& caches, int32_t typeIndex, const TCache& cache)
+    {
+      assert(typeIndex >= 0 && typeIndex < MAX_PAIR_CACHE_TYPES);
+      auto& list = caches[typeIndex];
+      auto byteIndex = list.Allocate<TCache>(m_MinimumPerTypeCapactiy, m_Pool);
+      list.GetFromBytes<TCache>(byteIndex) = cache;
+      return PairCacheIndex(m_WorkerIndex, typeIndex, byteIndex);
+    }
+
+    template<typename TCache>
+    TCache& Get(CepuUtil::Buffer<UntypedList>& caches, PairCacheIndex index)
+    {
+      assert(index.Exists() && index.GetWorker() == m_WorkerIndex && "The index must point into this worker's caches.");
+      auto& list = caches[index.GetType()];
+      assert(list.m_ElementSizeInBytes == sizeof(TCache) && "The cache type doesn't match the type stored at this index.");
+      return list.GetFromBytes<TCache>(index.GetIndex());
+    }
   };
-}
\ No newline at end of file
+}
@@ -0,0 +1,10 @@
+#include "CepuPhysicsPCH.h"
+#include "CompressedTree.h"
+
+namespace CepuPhysics
+{
+  //Nothing in the library keeps a compressed tree around yet, so instantiate both widths here; the non templated members get compiled and checked
+  //with the library instead of waiting for their first user.
+  template class CompressedTree<uint16_t>;
+  template class CompressedTree<uint8_t>;
+}
@@ -0,0 +1,402 @@
+#pragma once
+#include "Tree.h"
+#include "Tree_IntertreeQueries.h"
+#include "Tree_RayCast.h"
+#include "Memory/BufferPool.h"
+#include "BoundingBox.h"
+
+namespace CepuPhysics
+{
+  //Binary node with quantized child bounds. Child bounds are stored relative to the bounds of the node holding them: mins count up from the node's min,
+  //maxes count down from the node's max, both in steps of (max - min) / MAXIMUM_QUANTIZED. A quantized 0 reproduces the node's bounds exactly.
+  //A and B use the same encoding as NodeChild::Index. Leaf counts aren't stored; nothing on the query side needs them.
+  //With 16 bit values a node takes 32 bytes instead of 64, with 8 bit values 20.
+  template<typename TQuantized>
+  struct CompressedNode
+  {
+    TQuantized AMin[3];
+    TQuantized AMax[3];
+    TQuantized BMin[3];
+    TQuantized BMax[3];
+    int32_t A;
+    int32_t B;
+  };
+
+  //Frozen, read only copy of a Tree with quantized bounds, meant for large trees that rarely change, like the static tree.
+  //Decoded bounds are always conservative: they contain the original bounds, but may be slightly larger, so queries can report a few extra near misses.
+  //Queries decode child bounds on the way down from the parent's decoded bounds; only the root's bounds are stored at full precision.
+  //Edits go through the mutable format: Decompress into a Tree, change it, and Compress again.
+  template<typename TQuantized>
+  class CompressedTree
+  {
+  public:
+    static_assert(std::is_unsigned<TQuantized>::value && sizeof(TQuantized) <= 2, "Child bounds are quantized to 8 or 16 bit unsigned integers.");
+    static constexpr float MAXIMUM_QUANTIZED = (float)std::numeric_limits<TQuantized>::max();
+
+    //Replaces the contents with a compressed copy of tree. Nodes are written in depth first order regardless of the source tree's layout; leaf indices are kept.
+    void Compress(const Tree& tree, CepuUtil::BufferPool& pool);
+    //Replaces the contents of tree with the compressed topology and the decoded, conservative bounds. Leaf indices match the compressed tree's.
+    void Decompress(Tree& tree, CepuUtil::BufferPool& pool) const;
+    void Dispose(CepuUtil::BufferPool& pool);
+
+    //Reports the index of every leaf whose decoded bounds overlap the query bounds. Handlers implement Handle(int32_t leafIndex).
+    template<typename TLeafHandler>
+    void GetOverlaps(const glm::vec3& min, const glm::vec3& max, TLeafHandler& results) const;
+    //Reports every overlapping pair between the leaves of a mutable tree and this one. Handlers receive (leaf index in treeA, leaf index in this tree).
+    template<typename TOverlapHandler>
+    void GetOverlaps(const Tree& treeA, TOverlapHandler& results) const;
+    //Casts a ray against every leaf's decoded bounds, nearest first. Same leaf tester protocol and io_maximumT behavior as the binary tree's RayCast (Tree_RayCast.h).
+    template<typename TRayLeafTester>
+    void RayCast(const glm::vec3& origin, const glm::vec3& direction, float& io_maximumT, TRayLeafTester& leafTester, int32_t id = 0) const;
+
+    CepuUtil::Buffer<CompressedNode<TQuantized>> m_Nodes;
+    CepuUtil::BoundingBox m_Bounds;
+    int32_t m_NodeCount = 0;
+    int32_t m_LeafCount = 0;
+
+  private:
+    static glm::vec3 GetScale(const glm::vec3& min, const glm::vec3& max) { return (max - min) * (1.f / MAXIMUM_QUANTIZED); }
+    //Both compression and queries decode through this, so the bounds compression verified are exactly the bounds queries see.
+    static void Decode(const TQuantized* quantizedMin, const TQuantized* quantizedMax, const glm::vec3& nodeMin, const glm::vec3& nodeMax, const glm::vec3& scale,
+      glm::vec3& o_min, glm::vec3& o_max)
+    {
+      o_min = nodeMin + glm::vec3(quantizedMin[0], quantizedMin[1], quantizedMin[2]) * scale;
+      o_max = nodeMax - glm::vec3(quantizedMax[0], quantizedMax[1], quantizedMax[2]) * scale;
+    }
+    static void Quantize(const NodeChild& child, const glm::vec3& nodeMin, const glm::vec3& nodeMax, const glm::vec3& scale,
+      TQuantized* o_min, TQuantized* o_max, glm::vec3& o_decodedMin, glm::vec3& o_decodedMax);
+    void CompressNode(const Tree& tree, const Node& source, int32_t targetIndex, const glm::vec3& nodeMin, const glm::vec3& nodeMax);
+    int32_t DecompressNode(Tree& tree, int32_t nodeIndex, const glm::vec3& nodeMin, const glm::vec3& nodeMax) const;
+    template<typename TLeafHandler>
+    void GetOverlaps(int32_t nodeIndex, const glm::vec3& nodeMin, const glm::vec3& nodeMax, const glm::vec3& min, const glm::vec3& max, TLeafHandler& results) const;
+    template<typename TOverlapHandler>
+    void DispatchTestForNodes(const Tree& treeA, const NodeChild& a, int32_t bIndex, const glm::vec3& bMin, const glm::vec3& bMax, TOverlapHandler& results) const;
+    template<typename TRayLeafTester>
+    void RayCastFrom(int32_t nodeIndex, float nodeT, const glm::vec3& nodeMin, const glm::vec3& nodeMax, TreeRay& treeRay, const RayData& ray,
+      TRayLeafTester& leafTester) const;
+  };
+
+  using CompressedTree16 = CompressedTree<uint16_t>;
+  using CompressedTree8  = CompressedTree<uint8_t>;
+
+  template<typename TQuantized>
+  void CompressedTree<TQuantized>::Quantize(const NodeChild& child, const glm::vec3& nodeMin, const glm::vec3& nodeMax, const glm::vec3& scale,
+    TQuantized* o_min, TQuantized* o_max, glm::vec3& o_decodedMin, glm::vec3& o_decodedMax)
+  {
+    for (int32_t axis = 0; axis < 3; ++axis) {
+      float quantizedMin = 0, quantizedMax = 0;
+      if (scale[axis] > 0) {
+        quantizedMin = glm::clamp(glm::floor((child.Min[axis] - nodeMin[axis]) / scale[axis]), 0.f, MAXIMUM_QUANTIZED);
+        quantizedMax = glm::clamp(glm::floor((nodeMax[axis] - child.Max[axis]) / scale[axis]), 0.f, MAXIMUM_QUANTIZED);
+      }
+      o_min[axis] = (TQuantized)quantizedMin;
+      o_max[axis] = (TQuantized)quantizedMax;
+    }
+    //Rounding in the division or the decode can leave a decoded bound a hair inside the child. Step outward until it's covered; 0 always covers it.
+    while (true) {
+      Decode(o_min, o_max, nodeMin, nodeMax, scale, o_decodedMin, o_decodedMax);
+      bool covered = true;
+      for (int32_t axis = 0; axis < 3; ++axis) {
+        if (o_decodedMin[axis] > child.Min[axis]) {
+          assert(o_min[axis] > 0 && "Children must be contained in their parent's bounds.");
+          --o_min[axis];
+          covered = false;
+        }
+        if (o_decodedMax[axis] < child.Max[axis]) {
+          assert(o_max[axis] > 0 && "Children must be contained in their parent's bounds.");
+          --o_max[axis];
+          covered = false;
+        }
+      }
+      if (covered)
+        return;
+    }
+  }
+
+  template<typename TQuantized>
+  void CompressedTree<TQuantized>::Compress(const Tree& tree, CepuUtil::BufferPool& pool)
+  {
+    m_LeafCount = tree.m_LeafCount;
+    m_NodeCount = tree.m_NodeCount;
+    if (m_Nodes.GetLength() < m_NodeCount) {
+      if (m_Nodes.IsAllocated())
+        pool.Return(m_Nodes);
+      pool.TakeAtLeast(m_NodeCount, m_Nodes);
+    }
+    auto& root = tree.m_Nodes[0];
+    auto& compressedRoot = m_Nodes[0];
+    compressedRoot = CompressedNode<TQuantized>();
+    if (m_LeafCount == 0) {
+      m_Bounds = CepuUtil::BoundingBox();
+      return;
+    }
+    if (m_LeafCount == 1) {
+      //The root's only child is a leaf whose bounds are the root's bounds, so it's stored exactly.
+      m_Bounds = CepuUtil::BoundingBox(root.A.Min, root.A.Max);
+      compressedRoot.A = root.A.Index;
+      return;
+    }
+    CepuUtil::BoundingBox::CreateMerged(root.A.Min, root.A.Max, root.B.Min, root.B.Max, m_Bounds.m_Min, m_Bounds.m_Max);
+    CompressNode(tree, root, 0, m_Bounds.m_Min, m_Bounds.m_Max);
+  }
+
+  template<typename TQuantized>
+  void CompressedTree<TQuantized>::CompressNode(const Tree& tree, const Node& source, int32_t targetIndex, const glm::vec3& nodeMin, const glm::vec3& nodeMax)
+  {
+    auto& target = m_Nodes[targetIndex];
+    auto scale = GetScale(nodeMin, nodeMax);
+    glm::vec3 decodedMin[2], decodedMax[2];
+    Quantize(source.A, nodeMin, nodeMax, scale, target.AMin, target.AMax, decodedMin[0], decodedMax[0]);
+    Quantize(source.B, nodeMin, nodeMax, scale, target.BMin, target.BMax, decodedMin[1], decodedMax[1]);
+    //Same depth first layout as Tree::CacheOptimize.
+    int32_t childTargetIndices[2] = { targetIndex + 1, targetIndex + source.A.LeafCount };
+    for (int32_t i = 0; i < 2; ++i) {
+      auto& child = (&source.A)[i];
+      auto& targetChild = i == 0 ? target.A : target.B;
+      if (child.Index >= 0) {
+        targetChild = childTargetIndices[i];
+        //Children are quantized against the decoded bounds; those are what queries will have on hand.
+        CompressNode(tree, tree.m_Nodes[child.Index], childTargetIndices[i], decodedMin[i], decodedMax[i]);
+      }
+      else {
+        targetChild = child.Index;
+      }
+    }
+  }
+
+  template<typename TQuantized>
+  void CompressedTree<TQuantized>::Decompress(Tree& tree, CepuUtil::BufferPool& pool) const
+  {
+    tree.Clear();
+    if (tree.m_Leaves.GetLength() < m_LeafCount)
+      tree.Resize(pool, m_LeafCount);
+    tree.m_LeafCount = m_LeafCount;
+    if (m_LeafCount == 0)
+      return;
+    if (m_LeafCount == 1) {
+      tree.InitializeSingleLeafRoot(m_Bounds);
+      return;
+    }
+    tree.m_NodeCount = m_NodeCount;
+    auto& rootMetanode = tree.m_Metanodes[0];
+    rootMetanode.RefineFlag = 0;
+    rootMetanode.LocalCostChange = 0;
+    DecompressNode(tree, 0, m_Bounds.m_Min, m_Bounds.m_Max);
+  }
+
+  template<typename TQuantized>
+  int32_t CompressedTree<TQuantized>::DecompressNode(Tree& tree, int32_t nodeIndex, const glm::vec3& nodeMin, const glm::vec3& nodeMax) const
+  {
+    auto& source = m_Nodes[nodeIndex];
+    auto& node = tree.m_Nodes[nodeIndex];
+    auto scale = GetScale(nodeMin, nodeMax);
+    Decode(source.AMin, source.AMax, nodeMin, nodeMax, scale, node.A.Min, node.A.Max);
+    Decode(source.BMin, source.BMax, nodeMin, nodeMax, scale, node.B.Min, node.B.Max);
+    node.A.Index = source.A;
+    node.B.Index = source.B;
+    for (int32_t i = 0; i < 2; ++i) {
+      auto& child = (&node.A)[i];
+      if (child.Index >= 0) {
+        auto& metanode = tree.m_Metanodes[child.Index];
+        metanode.Parent = nodeIndex;
+        metanode.IndexInParent = i;
+        metanode.RefineFlag = 0;
+        metanode.LocalCostChange = 0;
+        child.LeafCount = DecompressNode(tree, child.Index, child.Min, child.Max);
+      }
+      else {
+        tree.m_Leaves[Tree::Encode(child.Index)] = Leaf(nodeIndex, i);
+        child.LeafCount = 1;
+      }
+    }
+    return node.A.LeafCount + node.B.LeafCount;
+  }
+
+  template<typename TQuantized>
+  void CompressedTree<TQuantized>::Dispose(CepuUtil::BufferPool& pool)
+  {
+    if (m_Nodes.IsAllocated())
+      pool.Return(m_Nodes);
+    m_NodeCount = 0;
+    m_LeafCount = 0;
+  }
+
+  template<typename TQuantized>
+  template<typename TLeafHandler>
+  void CompressedTree<TQuantized>::GetOverlaps(const glm::vec3& min, const glm::vec3& max, TLeafHandler& results) const
+  {
+    if (m_LeafCount == 0 || !CepuUtil::BoundingBox::Intersects(min, max, m_Bounds.m_Min, m_Bounds.m_Max))
+      return;
+    if (m_LeafCount == 1) {
+      results.Handle(Tree::Encode(m_Nodes[0].A));
+      return;
+    }
+    GetOverlaps(0, m_Bounds.m_Min, m_Bounds.m_Max, min, max, results);
+  }
+
+  template<typename TQuantized>
+  template<typename TLeafHandler>
+  void CompressedTree<TQuantized>::GetOverlaps(int32_t nodeIndex, const glm::vec3& nodeMin, const glm::vec3& nodeMax, const glm::vec3& min, const glm::vec3& max,
+    TLeafHandler& results) const
+  {
+    auto& node = m_Nodes[nodeIndex];
+    auto scale = GetScale(nodeMin, nodeMax);
+    glm::vec3 aMin, aMax, bMin, bMax;
+    Decode(node.AMin, node.AMax, nodeMin, nodeMax, scale, aMin, aMax);
+    Decode(node.BMin, node.BMax, nodeMin, nodeMax, scale, bMin, bMax);
+    auto bIndex = node.B;
+    if (CepuUtil::BoundingBox::Intersects(min, max, aMin, aMax)) {
+      if (node.A >= 0)
+        GetOverlaps(node.A, aMin, aMax, min, max, results);
+      else
+        results.Handle(Tree::Encode(node.A));
+    }
+    if (CepuUtil::BoundingBox::Intersects(min, max, bMin, bMax)) {
+      if (bIndex >= 0)
+        GetOverlaps(bIndex, bMin, bMax, min, max, results);
+      else
+        results.Handle(Tree::Encode(bIndex));
+    }
+  }
+
+  //Pairs a fixed leaf from the mutable tree with the leaves a box query finds in the compressed tree.
+  template<typename TOverlapHandler>
+  struct CompressedLeafOverlapHandler
+  {
+    TOverlapHandler& m_Inner;
+    int32_t m_LeafIndexA;
+    void Handle(int32_t leafIndexB) { m_Inner.Handle(m_LeafIndexA, leafIndexB); }
+  };
+
+  template<typename TQuantized>
+  template<typename TOverlapHandler>
+  void CompressedTree<TQuantized>::DispatchTestForNodes(const Tree& treeA, const NodeChild& a, int32_t bIndex, const glm::vec3& bMin, const glm::vec3& bMax,
+    TOverlapHandler& results) const
+  {
+    if (a.Index >= 0) {
+      if (bIndex >= 0) {
+        auto& nodeA = treeA.m_Nodes[a.Index];
+        auto& nodeB = m_Nodes[bIndex];
+        auto scale = GetScale(bMin, bMax);
+        glm::vec3 childMinsB[2], childMaxesB[2];
+        Decode(nodeB.AMin, nodeB.AMax, bMin, bMax, scale, childMinsB[0], childMaxesB[0]);
+        Decode(nodeB.BMin, nodeB.BMax, bMin, bMax, scale, childMinsB[1], childMaxesB[1]);
+        int32_t childIndicesB[2] = { nodeB.A, nodeB.B };
+        for (int32_t i = 0; i < 2; ++i) {
+          auto& childA = (&nodeA.A)[i];
+          for (int32_t j = 0; j < 2; ++j) {
+            if (CepuUtil::BoundingBox::Intersects(childA.Min, childA.Max, childMinsB[j], childMaxesB[j]))
+              DispatchTestForNodes(treeA, childA, childIndicesB[j], childMinsB[j], childMaxesB[j], results);
+          }
+        }
+      }
+      else {
+        //Leaf B versus node A. The leaf belongs to this tree, so the reported pairs have to be flipped back into (A, B) order.
+        FlippedOverlapHandler<TOverlapHandler> flippedResults{ results };
+        TestLeafAgainstNode(treeA, Tree::Encode(bIndex), bMin, bMax, a.Index, flippedResults);
+      }
+    }
+    else if (bIndex >= 0) {
+      CompressedLeafOverlapHandler<TOverlapHandler> leafResults{ results, Tree::Encode(a.Index) };
+      GetOverlaps(bIndex, bMin, bMax, a.Min, a.Max, leafResults);
+    }
+    else {
+      results.Handle(Tree::Encode(a.Index), Tree::Encode(bIndex));
+    }
+  }
+
+  template<typename TQuantized>
+  template<typename TOverlapHandler>
+  void CompressedTree<TQuantized>::GetOverlaps(const Tree& treeA, TOverlapHandler& results) const
+  {
+    if (treeA.m_LeafCount == 0 || m_LeafCount == 0)
+      return;
+    //The compressed root is dispatched as a single child covering the whole tree, which handles single leaf roots on both sides without special cases.
+    auto& rootA = treeA.m_Nodes[0];
+    auto rootIndexB = m_LeafCount == 1 ? m_Nodes[0].A : 0;
+    for (int32_t i = 0; i < glm::min(treeA.m_LeafCount, 2); ++i) {
+      auto& childA = (&rootA.A)[i];
+      if (CepuUtil::BoundingBox::Intersects(childA.Min, childA.Max, m_Bounds.m_Min, m_Bounds.m_Max))
+        DispatchTestForNodes(treeA, childA, rootIndexB, m_Bounds.m_Min, m_Bounds.m_Max, results);
+    }
+  }
+
+  template<typename TQuantized>
+  template<typename TRayLeafTester>
+  void CompressedTree<TQuantized>::RayCastFrom(int32_t nodeIndex, float nodeT, const glm::vec3& nodeMin, const glm::vec3& nodeMax, TreeRay& treeRay,
+    const RayData& ray, TRayLeafTester& leafTester) const
+  {
+    //Same traversal as the binary tree's RayCastFrom, except that child bounds only exist once decoded, so each entry carries its node's decoded bounds.
+    struct StackEntry
+    {
+      int32_t Index;
+      float T;
+      glm::vec3 Min;
+      glm::vec3 Max;
+    };
+    StackEntry stack[RAY_TRAVERSAL_STACK_CAPACITY];
+    int32_t stackCount = 1;
+    stack[0] = { nodeIndex, nodeT, nodeMin, nodeMax };
+    while (stackCount > 0) {
+      auto entry = stack[--stackCount];
+      //The maximum may have shrunk since this entry was pushed.
+      if (entry.T > treeRay.MaximumT)
+        continue;
+      if (entry.Index < 0) {
+        leafTester.TestLeaf(Tree::Encode(entry.Index), ray, treeRay.MaximumT);
+        continue;
+      }
+      auto& node = m_Nodes[entry.Index];
+      auto scale = GetScale(entry.Min, entry.Max);
+      StackEntry a, b;
+      a.Index = node.A;
+      b.Index = node.B;
+      Decode(node.AMin, node.AMax, entry.Min, entry.Max, scale, a.Min, a.Max);
+      Decode(node.BMin, node.BMax, entry.Min, entry.Max, scale, b.Min, b.Max);
+      auto aIntersected = treeRay.Intersects(a.Min, a.Max, a.T);
+      auto bIntersected = treeRay.Intersects(b.Min, b.Max, b.T);
+      //Push the farther child first so the nearer one is visited first; hits in the nearer one can then cull the farther one.
+      StackEntry children[2];
+      int32_t childCount = 0;
+      if (aIntersected && bIntersected) {
+        auto aFirst = a.T <= b.T;
+        children[0] = aFirst ? b : a;
+        children[1] = aFirst ? a : b;
+        childCount = 2;
+      }
+      else if (aIntersected) {
+        children[childCount++] = a;
+      }
+      else if (bIntersected) {
+        children[childCount++] = b;
+      }
+      for (int32_t i = 0; i < childCount; ++i) {
+        if (stackCount < RAY_TRAVERSAL_STACK_CAPACITY)
+          stack[stackCount++] = children[i];
+        else
+          RayCastFrom(children[i].Index, children[i].T, children[i].Min, children[i].Max, treeRay, ray, leafTester);
+      }
+    }
+  }
+
+  template<typename TQuantized>
+  template<typename TRayLeafTester>
+  void CompressedTree<TQuantized>::RayCast(const glm::vec3& origin, const glm::vec3& direction, float& io_maximumT, TRayLeafTester& leafTester, int32_t id) const
+  {
+    if (m_LeafCount == 0)
+      return;
+    TreeRay treeRay;
+    TreeRay::CreateFrom(origin, direction, io_maximumT, treeRay);
+    RayData ray;
+    ray.Origin = origin;
+    ray.Id = id;
+    ray.Direction = direction;
+    float t;
+    if (treeRay.Intersects(m_Bounds.m_Min, m_Bounds.m_Max, t)) {
+      //A single leaf is stored as the root's child A, with the root bounds as its exact bounds.
+      auto rootIndex = m_LeafCount == 1 ? m_Nodes[0].A : 0;
+      RayCastFrom(rootIndex, t, m_Bounds.m_Min, m_Bounds.m_Max, treeRay, ray, leafTester);
+    }
+    io_maximumT = treeRay.MaximumT;
+  }
+}
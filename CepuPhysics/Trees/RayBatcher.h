@@ -0,0 +1,237 @@
+#pragma once
+#include "Tree_RayCast.h"
+#include "Memory/BufferPool.h"
+#include "Math/Vector.h"
+
+namespace CepuPhysics
+{
+  //Collects rays and traverses a tree with all of them at once. Each node is loaded once per batch instead of once per ray, and the rays that reach it are
+  //slab tested against its children Vector::COUNT at a time. Works best with coherent rays (shared origins, similar directions, like line of sight checks),
+  //since those keep the lists of rays reaching each node long.
+  //Leaf testers have the same contract as for RayCast. Adding a ray to a full batch flushes it first; call Flush once done adding to process the rest.
+  template<typename TRayLeafTester>
+  class RayBatcher
+  {
+  public:
+    RayBatcher(CepuUtil::BufferPool& pool, const Tree& tree, TRayLeafTester& leafTester, int32_t rayCapacity = 2048);
+    void Dispose();
+
+    void Add(const glm::vec3& origin, const glm::vec3& direction, float maximumT, int32_t id);
+    void Flush();
+
+    int32_t GetRayCount() const { return m_RayCount; }
+
+  private:
+    struct StackEntry
+    {
+      int32_t Index;
+      int32_t RayStart;
+      int32_t RayCount;
+    };
+
+    void TestNode(const StackEntry& entry);
+    void Push(int32_t childIndex, int32_t rayStart, int32_t rayCount);
+
+    CepuUtil::BufferPool* m_Pool;
+    const Tree* m_Tree;
+    TRayLeafTester* m_LeafTester;
+
+    //Rays are stored component-wise for gathering into bundles. The maximums are updated in place by leaf testers.
+    CepuUtil::Buffer<RayData> m_Rays;
+    CepuUtil::Buffer<float> m_OriginX, m_OriginY, m_OriginZ;
+    CepuUtil::Buffer<float> m_InverseDirectionX, m_InverseDirectionY, m_InverseDirectionZ;
+    CepuUtil::Buffer<float> m_MaximumT;
+    int32_t m_RayCount = 0;
+
+    //Every stack entry owns a contiguous region of m_RayIndices. Regions are stacked in the same order as the entries, so the entry on top always owns the last region.
+    CepuUtil::Buffer<StackEntry> m_Stack;
+    int32_t m_StackCount = 0;
+    CepuUtil::Buffer<int32_t> m_RayIndices;
+  };
+
+  template<typename TRayLeafTester>
+  RayBatcher<TRayLeafTester>::RayBatcher(CepuUtil::BufferPool& pool, const Tree& tree, TRayLeafTester& leafTester, int32_t rayCapacity)
+    : m_Pool(&pool), m_Tree(&tree), m_LeafTester(&leafTester)
+  {
+    assert(rayCapacity > 0);
+    pool.Take(rayCapacity, m_Rays);
+    pool.Take(rayCapacity, m_OriginX);
+    pool.Take(rayCapacity, m_OriginY);
+    pool.Take(rayCapacity, m_OriginZ);
+    pool.Take(rayCapacity, m_InverseDirectionX);
+    pool.Take(rayCapacity, m_InverseDirectionY);
+    pool.Take(rayCapacity, m_InverseDirectionZ);
+    pool.Take(rayCapacity, m_MaximumT);
+    pool.TakeAtLeast(64, m_Stack);
+    pool.TakeAtLeast(rayCapacity * 4, m_RayIndices);
+  }
+
+  template<typename TRayLeafTester>
+  void RayBatcher<TRayLeafTester>::Dispose()
+  {
+    m_Pool->Return(m_Rays);
+    m_Pool->Return(m_OriginX);
+    m_Pool->Return(m_OriginY);
+    m_Pool->Return(m_OriginZ);
+    m_Pool->Return(m_InverseDirectionX);
+    m_Pool->Return(m_InverseDirectionY);
+    m_Pool->Return(m_InverseDirectionZ);
+    m_Pool->Return(m_MaximumT);
+    m_Pool->Return(m_Stack);
+    m_Pool->Return(m_RayIndices);
+  }
+
+  template<typename TRayLeafTester>
+  void RayBatcher<TRayLeafTester>::Add(const glm::vec3& origin, const glm::vec3& direction, float maximumT, int32_t id)
+  {
+    if (m_RayCount == m_Rays.GetLength())
+      Flush();
+    auto& ray = m_Rays[m_RayCount];
+    ray.Origin = origin;
+    ray.Id = id;
+    ray.Direction = direction;
+    auto inverseDirection = TreeRay::ComputeInverseDirection(direction);
+    m_OriginX[m_RayCount] = origin.x;
+    m_OriginY[m_RayCount] = origin.y;
+    m_OriginZ[m_RayCount] = origin.z;
+    m_InverseDirectionX[m_RayCount] = inverseDirection.x;
+    m_InverseDirectionY[m_RayCount] = inverseDirection.y;
+    m_InverseDirectionZ[m_RayCount] = inverseDirection.z;
+    m_MaximumT[m_RayCount] = maximumT;
+    ++m_RayCount;
+  }
+
+  template<typename TRayLeafTester>
+  void RayBatcher<TRayLeafTester>::Flush()
+  {
+    auto& tree = *m_Tree;
+    if (m_RayCount == 0 || tree.m_LeafCount == 0) {
+      m_RayCount = 0;
+      return;
+    }
+    if (tree.m_LeafCount == 1) {
+      //The root's only leaf lives in child A; there's no node to share between the rays.
+      auto& root = tree.m_Nodes[0];
+      for (int32_t i = 0; i < m_RayCount; ++i) {
+        float t;
+        glm::vec3 origin(m_OriginX[i], m_OriginY[i], m_OriginZ[i]);
+        glm::vec3 inverseDirection(m_InverseDirectionX[i], m_InverseDirectionY[i], m_InverseDirectionZ[i]);
+        if (TreeRay::Intersects(origin, inverseDirection, m_MaximumT[i], root.A.Min, root.A.Max, t))
+          m_LeafTester->TestLeaf(Tree::Encode(root.A.Index), m_Rays[i], m_MaximumT[i]);
+      }
+      m_RayCount = 0;
+      return;
+    }
+
+    for (int32_t i = 0; i < m_RayCount; ++i)
+      m_RayIndices[i] = i;
+    m_Stack[0] = { 0, 0, m_RayCount };
+    m_StackCount = 1;
+    while (m_StackCount > 0) {
+      auto entry = m_Stack[--m_StackCount];
+      if (entry.Index < 0) {
+        auto leafIndex = Tree::Encode(entry.Index);
+        for (int32_t i = 0; i < entry.RayCount; ++i) {
+          auto rayIndex = m_RayIndices[entry.RayStart + i];
+          m_LeafTester->TestLeaf(leafIndex, m_Rays[rayIndex], m_MaximumT[rayIndex]);
+        }
+      }
+      else {
+        TestNode(entry);
+      }
+    }
+    m_RayCount = 0;
+  }
+
+  template<typename TRayLeafTester>
+  void RayBatcher<TRayLeafTester>::Push(int32_t childIndex, int32_t rayStart, int32_t rayCount)
+  {
+    if (m_StackCount == m_Stack.GetLength())
+      m_Pool->ResizeToAtLeast(m_Stack, m_StackCount * 2, m_StackCount);
+    m_Stack[m_StackCount++] = { childIndex, rayStart, rayCount };
+  }
+
+  template<typename TRayLeafTester>
+  void RayBatcher<TRayLeafTester>::TestNode(const StackEntry& entry)
+  {
+    using CepuUtil::Vector;
+    //The child lists are written past the end of the entry's region first, then moved down over it once the entry's own list has been consumed.
+    auto scratchStart = entry.RayStart + entry.RayCount;
+    if (m_RayIndices.GetLength() < scratchStart + 2 * entry.RayCount)
+      m_Pool->ResizeToAtLeast(m_RayIndices, scratchStart + 2 * entry.RayCount, scratchStart);
+    auto rayIndices = m_RayIndices.m_Memory;
+    auto listA = rayIndices + scratchStart;
+    auto listB = listA + entry.RayCount;
+    int32_t countA = 0, countB = 0;
+    //Counts the rays hitting both children that enter A no later than B; the majority decides which child the whole batch visits first.
+    int32_t aFirstCount = 0, bothCount = 0;
+
+    auto& node = m_Tree->m_Nodes[entry.Index];
+    Vector aMinX(node.A.Min.x), aMinY(node.A.Min.y), aMinZ(node.A.Min.z);
+    Vector aMaxX(node.A.Max.x), aMaxY(node.A.Max.y), aMaxZ(node.A.Max.z);
+    Vector bMinX(node.B.Min.x), bMinY(node.B.Min.y), bMinZ(node.B.Min.z);
+    Vector bMaxX(node.B.Max.x), bMaxY(node.B.Max.y), bMaxZ(node.B.Max.z);
+    Vector zero(0.f);
+    for (int32_t bundleStart = 0; bundleStart < entry.RayCount; bundleStart += Vector::COUNT) {
+      auto laneCount = glm::min(Vector::COUNT, entry.RayCount - bundleStart);
+      auto bundleIndices = rayIndices + entry.RayStart + bundleStart;
+      Vector originX, originY, originZ, inverseX, inverseY, inverseZ, maximumT;
+      for (int32_t i = 0; i < laneCount; ++i) {
+        auto rayIndex = bundleIndices[i];
+        originX[i] = m_OriginX[rayIndex];
+        originY[i] = m_OriginY[rayIndex];
+        originZ[i] = m_OriginZ[rayIndex];
+        inverseX[i] = m_InverseDirectionX[rayIndex];
+        inverseY[i] = m_InverseDirectionY[rayIndex];
+        inverseZ[i] = m_InverseDirectionZ[rayIndex];
+        maximumT[i] = m_MaximumT[rayIndex];
+      }
+      auto laneMask = (1 << laneCount) - 1;
+
+      auto t0X = (aMinX - originX) * inverseX, t1X = (aMaxX - originX) * inverseX;
+      auto t0Y = (aMinY - originY) * inverseY, t1Y = (aMaxY - originY) * inverseY;
+      auto t0Z = (aMinZ - originZ) * inverseZ, t1Z = (aMaxZ - originZ) * inverseZ;
+      auto entryA = Max(Max(Min(t0X, t1X), Min(t0Y, t1Y)), Min(t0Z, t1Z));
+      auto exitA = Min(Min(Max(t0X, t1X), Max(t0Y, t1Y)), Max(t0Z, t1Z));
+      auto hitA = laneMask & LessThanOrEqualMask(entryA, exitA) & LessThanOrEqualMask(zero, exitA) & LessThanOrEqualMask(entryA, maximumT);
+
+      t0X = (bMinX - originX) * inverseX; t1X = (bMaxX - originX) * inverseX;
+      t0Y = (bMinY - originY) * inverseY; t1Y = (bMaxY - originY) * inverseY;
+      t0Z = (bMinZ - originZ) * inverseZ; t1Z = (bMaxZ - originZ) * inverseZ;
+      auto entryB = Max(Max(Min(t0X, t1X), Min(t0Y, t1Y)), Min(t0Z, t1Z));
+      auto exitB = Min(Min(Max(t0X, t1X), Max(t0Y, t1Y)), Max(t0Z, t1Z));
+      auto hitB = laneMask & LessThanOrEqualMask(entryB, exitB) & LessThanOrEqualMask(zero, exitB) & LessThanOrEqualMask(entryB, maximumT);
+
+      auto both = hitA & hitB;
+      auto aFirst = both & LessThanOrEqualMask(entryA, entryB);
+      for (int32_t i = 0; i < laneCount; ++i) {
+        auto bit = 1 << i;
+        if (hitA & bit)
+          listA[countA++] = bundleIndices[i];
+        if (hitB & bit)
+          listB[countB++] = bundleIndices[i];
+        bothCount += (both & bit) != 0;
+        aFirstCount += (aFirst & bit) != 0;
+      }
+    }
+
+    //The entry was popped, so its region is free. Regions have to stay stacked in push order: the child visited second takes the lower part and the child visited first goes on top.
+    auto visitAFirst = aFirstCount * 2 >= bothCount;
+    int32_t firstIndex = visitAFirst ? node.A.Index : node.B.Index;
+    int32_t secondIndex = visitAFirst ? node.B.Index : node.A.Index;
+    auto firstList = visitAFirst ? listA : listB;
+    auto secondList = visitAFirst ? listB : listA;
+    auto firstCount = visitAFirst ? countA : countB;
+    auto secondCount = visitAFirst ? countB : countA;
+    auto regionStart = entry.RayStart;
+    if (secondCount > 0) {
+      memmove(rayIndices + regionStart, secondList, sizeof(int32_t) * secondCount);
+      Push(secondIndex, regionStart, secondCount);
+      regionStart += secondCount;
+    }
+    if (firstCount > 0) {
+      memmove(rayIndices + regionStart, firstList, sizeof(int32_t) * firstCount);
+      Push(firstIndex, regionStart, firstCount);
+    }
+  }
+}
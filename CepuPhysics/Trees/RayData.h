@@ -0,0 +1,48 @@
+#pragma once
+
+namespace CepuPhysics
+{
+  //A ray as handed to leaf testers. Id is whatever the caller passed in when the ray was cast; it lets batched ray tests tell their results apart.
+  struct RayData
+  {
+    glm::vec3 Origin;
+    int32_t Id = 0;
+    glm::vec3 Direction;
+  };
+
+  //Precomputed form of a ray for testing against bounding boxes during tree traversal.
+  struct TreeRay
+  {
+    glm::vec3 Origin;
+    float MaximumT = 0;
+    glm::vec3 InverseDirection;
+
+    static void CreateFrom(const glm::vec3& origin, const glm::vec3& direction, float maximumT, TreeRay& o_treeRay)
+    {
+      o_treeRay.Origin = origin;
+      o_treeRay.MaximumT = maximumT;
+      o_treeRay.InverseDirection = ComputeInverseDirection(direction);
+    }
+
+    //Zero direction components are clamped to a tiny magnitude instead of dividing by zero. The resulting huge but finite slab distances keep
+    //the slab test free of infinity * 0 NaNs for rays that run exactly along a box face.
+    static glm::vec3 ComputeInverseDirection(const glm::vec3& direction)
+    {
+      return glm::vec3(direction.x < 0 ? -1.f : 1.f, direction.y < 0 ? -1.f : 1.f, direction.z < 0 ? -1.f : 1.f) / glm::max(glm::vec3(1e-15f), glm::abs(direction));
+    }
+
+    //Slab test against the given bounds. o_t is the parameter at which the ray enters the box, which is negative if the origin is inside.
+    static bool Intersects(const glm::vec3& origin, const glm::vec3& inverseDirection, float maximumT, const glm::vec3& min, const glm::vec3& max, float& o_t)
+    {
+      auto t0 = (min - origin) * inverseDirection;
+      auto t1 = (max - origin) * inverseDirection;
+      auto tEntry = glm::min(t0, t1);
+      auto tExit = glm::max(t0, t1);
+      o_t = glm::max(tEntry.x, glm::max(tEntry.y, tEntry.z));
+      auto exit = glm::min(tExit.x, glm::min(tExit.y, tExit.z));
+      return o_t <= exit && exit >= 0 && o_t <= maximumT;
+    }
+
+    bool Intersects(const glm::vec3& min, const glm::vec3& max, float& o_t) const { return Intersects(Origin, InverseDirection, MaximumT, min, max, o_t); }
+  };
+}
@@ -59,6 +59,19 @@ namespace CepuPhysics
       InitializeRoot();
   }
 
+  void Tree::InitializeSingleLeafRoot(const CepuUtil::BoundingBox& bounds)
+  {
+    assert(m_LeafCount == 1 && m_NodeCount == 1);
+    //Only the root is allowed to have an empty child slot.
+    auto& root = m_Nodes[0];
+    root.A.Min = bounds.m_Min;
+    root.A.Max = bounds.m_Max;
+    root.A.Index = Encode(0);
+    root.A.LeafCount = 1;
+    root.B = NodeChild();
+    m_Leaves[0] = Leaf(0, 0);
+  }
+
   void Tree::Clear()
   {
     m_LeafCount = 0;
@@ -133,6 +146,125 @@ namespace CepuPhysics
     }
   }
 
+  int32_t Tree::AddRange(const CepuUtil::Buffer<CepuUtil::BoundingBox>& bounds, CepuUtil::BufferPool& pool, CepuUtil::IThreadDispatcher* threadDispatcher)
+  {
+    auto count = bounds.GetLength();
+    auto firstLeafIndex = m_LeafCount;
+    if (count == 0)
+      return firstLeafIndex;
+    if (m_LeafCount == 0) {
+      BuildFrom(bounds, pool, threadDispatcher);
+      return 0;
+    }
+    if (count == 1)
+      return Add(bounds[0], pool);
+
+    //Reserve everything up front; n leaves never need more than n - 1 nodes, so this covers the grafted nodes too.
+    if (m_Leaves.GetLength() < m_LeafCount + count)
+      Resize(pool, m_LeafCount + count);
+
+    Tree subtree(pool, count);
+    subtree.BuildFrom(bounds, pool, threadDispatcher);
+
+    //Append the subtree's nodes and leaves to the end of this tree's buffers, offsetting every reference.
+    auto nodeOffset = m_NodeCount;
+    for (int32_t i = 0; i < subtree.m_NodeCount; ++i) {
+      auto& node = m_Nodes[nodeOffset + i];
+      node = subtree.m_Nodes[i];
+      for (int32_t childIndex = 0; childIndex < 2; ++childIndex) {
+        auto& child = (&node.A)[childIndex];
+        child.Index = child.Index >= 0 ? child.Index + nodeOffset : Encode(Encode(child.Index) + firstLeafIndex);
+      }
+      auto& metanode = m_Metanodes[nodeOffset + i];
+      metanode = subtree.m_Metanodes[i];
+      metanode.Parent += nodeOffset;
+    }
+    for (int32_t i = 0; i < count; ++i) {
+      auto leaf = subtree.m_Leaves[i];
+      m_Leaves[firstLeafIndex + i] = Leaf(leaf.GetNodeIndex() + nodeOffset, leaf.GetChildIndex());
+    }
+    auto& subtreeRootNode = subtree.m_Nodes[0];
+    NodeChild subtreeRoot;
+    subtreeRoot.Min = glm::min(subtreeRootNode.A.Min, subtreeRootNode.B.Min);
+    subtreeRoot.Max = glm::max(subtreeRootNode.A.Max, subtreeRootNode.B.Max);
+    subtreeRoot.Index = nodeOffset;
+    subtreeRoot.LeafCount = count;
+    m_NodeCount += subtree.m_NodeCount;
+    m_LeafCount += count;
+    subtree.Dispose(pool);
+
+    if (firstLeafIndex == 1) {
+      //The root still has an empty slot.
+      m_Nodes[0].B = subtreeRoot;
+      m_Metanodes[nodeOffset].Parent = 0;
+      m_Metanodes[nodeOffset].IndexInParent = 1;
+      return firstLeafIndex;
+    }
+
+    //Same descent as Add, except that a subtree may also be paired with an internal node instead of traversing into it.
+    //That matters for large batches: pushing a big subtree deep into the tree would expand every node on the way down.
+    BoundingBox subtreeBounds(subtreeRoot.Min, subtreeRoot.Max);
+    auto subtreeCost = ComputeBoundsMetric(subtreeBounds);
+    int32_t nodeIndex = 0;
+    while (true) {
+      auto& node = m_Nodes[nodeIndex];
+      BoundingBox merged[2];
+      float costChanges[2];
+      bool traverse[2];
+      for (int32_t childIndex = 0; childIndex < 2; ++childIndex) {
+        auto choice = ComputeBestInsertionChoice(subtreeBounds, subtreeCost, (&node.A)[childIndex], merged[childIndex], costChanges[childIndex]);
+        auto graftCost = ComputeBoundsMetric(merged[childIndex]);
+        traverse[childIndex] = choice == InsertionChoice::TRAVERSE && costChanges[childIndex] < graftCost;
+        if (!traverse[childIndex])
+          costChanges[childIndex] = graftCost;
+      }
+      auto bestChildIndex = costChanges[0] <= costChanges[1] ? 0 : 1;
+      if (!traverse[bestChildIndex]) {
+        GraftSubtree(subtreeRoot, nodeIndex, bestChildIndex, merged[bestChildIndex]);
+        return firstLeafIndex;
+      }
+      auto& child = (&node.A)[bestChildIndex];
+      child.Min = merged[bestChildIndex].m_Min;
+      child.Max = merged[bestChildIndex].m_Max;
+      child.LeafCount += count;
+      nodeIndex = child.Index;
+    }
+  }
+
+  void Tree::GraftSubtree(const NodeChild& subtreeRoot, int32_t parentIndex, int32_t indexInParent, const CepuUtil::BoundingBox& merged)
+  {
+    //The existing child and the subtree become siblings under a new internal node.
+    auto newNodeIndex = AllocateNode();
+    auto& newNode     = m_Nodes    [newNodeIndex];
+    auto& newMetanode = m_Metanodes[newNodeIndex];
+    newMetanode.Parent = parentIndex;
+    newMetanode.IndexInParent = indexInParent;
+    newMetanode.RefineFlag = 0;
+    newMetanode.LocalCostChange = 0;
+    auto& childInParent = (&m_Nodes[parentIndex].A)[indexInParent];
+    newNode.A = childInParent;
+    newNode.B = subtreeRoot;
+    if (newNode.A.Index >= 0) {
+      m_Metanodes[newNode.A.Index].Parent = newNodeIndex;
+      m_Metanodes[newNode.A.Index].IndexInParent = 0;
+    }
+    else {
+      m_Leaves[Encode(newNode.A.Index)] = Leaf(newNodeIndex, 0);
+    }
+    if (subtreeRoot.Index >= 0) {
+      m_Metanodes[subtreeRoot.Index].Parent = newNodeIndex;
+      m_Metanodes[subtreeRoot.Index].IndexInParent = 1;
+    }
+    else {
+      m_Leaves[Encode(subtreeRoot.Index)] = Leaf(newNodeIndex, 1);
+    }
+
+    childInParent.Index = newNodeIndex;
+    childInParent.Min = merged.m_Min;
+    childInParent.Max = merged.m_Max;
+    childInParent.LeafCount += subtreeRoot.LeafCount;
+  }
+
   int32_t Tree::MergeLeafNodes(const CepuUtil::BoundingBox& newLeafBounds, int32_t parentIndex, int32_t indexInParent, const CepuUtil::BoundingBox& merged)
   {
     //It's a leaf node.
@@ -203,21 +335,6 @@ namespace CepuPhysics
     o_merged.m_Max = glm::max(maxA, maxB);
   }
 
-  //@TODO Use intrinsic for leading zeroes
-  //@TODO Put this somewhere else (original Bepu had a SpanHelper class)
-  int32_t GetContainingPowerOf2(int32_t x)
-  {
-    int n = 32;
-    unsigned y;
-
-    y = x >>16; if (y != 0) { n = n -16; x = y; }
-    y = x >> 8; if (y != 0) { n = n - 8; x = y; }
-    y = x >> 4; if (y != 0) { n = n - 4; x = y; }
-    y = x >> 2; if (y != 0) { n = n - 2; x = y; }
-    y = x >> 1; if (y != 0) return n - 2;
-    return n - x;
-  }
-
   InsertionChoice Tree::ComputeBestInsertionChoice(const CepuUtil::BoundingBox& bounds, float newLeafCost, const NodeChild& child, CepuUtil::BoundingBox& o_mergedCandidate, float& o_costChange)
   {
     CreateMerged(child.Min, child.Max, bounds.m_Min, bounds.m_Max, o_mergedCandidate);
@@ -228,7 +345,7 @@ namespace CepuPhysics
       //We're assuming that the remaining tree is balanced and that each level will expand by at least SAH(newLeafBounds). 
       //This might not be anywhere close to correct, but it's not a bad estimate.
       o_costChange = newCost - ComputeBoundsMetric(child.Min, child.Max);
-      o_costChange += GetContainingPowerOf2(child.LeafCount) * glm::max(newLeafCost, o_costChange);
+      o_costChange += SpanHelper::GetContainingPowerOf2(child.LeafCount) * glm::max(newLeafCost, o_costChange);
       return InsertionChoice::TRAVERSE;
     }
     else
@@ -5,12 +5,16 @@
 namespace CepuUtil
 {
   class BufferPool;
+  class FrameArena;
+  class IThreadDispatcher;
   struct BoundingBox;
+  template<typename> struct QuickList;
 }
 
 namespace CepuPhysics
 {
   struct BinnedResources;
+  struct BinnedBuildJob;
   struct SubtreeHeapEntry;
 
   enum class InsertionChoice
@@ -22,46 +26,76 @@ namespace CepuPhysics
   class Tree
   {
   public:
+    //Leaves the tree without any memory. Only meant as a placeholder for trees embedded in other types (like Mesh) until a real one is assigned.
+    Tree() = default;
     Tree(CepuUtil::BufferPool& pool, int32_t initialLeafCapacity = 4096);
     void Dispose(CepuUtil::BufferPool& pool);
 
     void InitializeRoot();
+    //Used by the bulk builders; sets up the root of a tree with exactly one leaf.
+    void InitializeSingleLeafRoot(const CepuUtil::BoundingBox& bounds);
     void Resize(CepuUtil::BufferPool& pool, int32_t targetLeafSlotCount);
     void Clear();
 
     int32_t Add(const CepuUtil::BoundingBox& bounds, CepuUtil::BufferPool& pool);
+    //Adds one leaf per element of bounds and returns the index of the first; bounds[i] ends up in leaf firstIndex + i.
+    //Capacity is reserved once, the new leaves are built into a subtree of their own with BuildFrom, and that subtree is grafted in wherever it's cheapest by SAH.
+    //Much faster than repeated Add calls for large batches, and the grafted subtree keeps the quality of a full build.
+    int32_t AddRange(const CepuUtil::Buffer<CepuUtil::BoundingBox>& bounds, CepuUtil::BufferPool& pool, CepuUtil::IThreadDispatcher* threadDispatcher = nullptr);
+    void GraftSubtree(const NodeChild& subtreeRoot, int32_t parentIndex, int32_t indexInParent, const CepuUtil::BoundingBox& merged);
+    //Replaces the contents of the tree with one leaf per element of leafBounds; leaf i gets leafBounds[i].
+    //The tree is built top-down in one pass by binned SAH partitioning, so it's ready for queries without any refinement.
+    //With a thread dispatcher, the top levels are split on the calling thread and the subtrees below them are built by the workers.
+    void BuildFrom(const CepuUtil::Buffer<CepuUtil::BoundingBox>& leafBounds, CepuUtil::BufferPool& pool, CepuUtil::IThreadDispatcher* threadDispatcher = nullptr);
+    //Same contract as BuildFrom, but builds a linear BVH from the Morton order of the leaf centroids instead.
+    //Much cheaper than the binned build and almost entirely parallel, at the cost of tree quality. Meant for rebuilding when most leaves moved arbitrarily far;
+    //subsequent RefitAndRefine calls refine the result incrementally.
+    void BuildLinearFrom(const CepuUtil::Buffer<CepuUtil::BoundingBox>& leafBounds, CepuUtil::BufferPool& pool, CepuUtil::IThreadDispatcher* threadDispatcher = nullptr);
+    void BinnedBuildNode(const BinnedResources& resources, int32_t nodeIndex, int32_t parentIndex, int32_t indexInParent, int32_t start, int32_t count,
+      CepuUtil::QuickList<BinnedBuildJob>* jobs, int32_t jobLeafCountThreshold, CepuUtil::BufferPool* pool);
     int32_t MergeLeafNodes(const CepuUtil::BoundingBox& newLeafBounds, int32_t parentIndex, int32_t indexInParent, const CepuUtil::BoundingBox& merged);
     int32_t InsertLeafIntoEmptySlot(const CepuUtil::BoundingBox& leafBox, int32_t nodeIndex, int32_t childIndex, Node& node);
 
     void RemoveNodeAt   (int32_t nodeIndex);
     void RefitForRemoval(int32_t nodeIndex);
     int32_t RemoveAt(int32_t leafIndex);
+    //Removes every leaf in leafIndices at once. Emptied nodes are collapsed in one bottom-up pass, then the surviving nodes are rewritten depth first into fresh buffers
+    //and the surviving leaves are compacted in their original order. o_leafIndexRemap is taken from the pool and maps every pre-removal leaf index to its new index,
+    //or -1 if it was removed; the caller returns it. Out of range or repeated indices throw before the tree is modified, and no remap is handed out then.
+    void RemoveRange(const CepuUtil::Buffer<int32_t>& leafIndices, CepuUtil::BufferPool& pool, CepuUtil::Buffer<int32_t>& o_leafIndexRemap);
+    void RefitForRangeRemoval(NodeChild& child, const CepuUtil::Buffer<int32_t>& leafIndexRemap);
+    const NodeChild& FindRangeRemovalSurvivor(const NodeChild& child) const;
+    void CompactForRangeRemoval(const NodeChild& child, int32_t parentIndex, int32_t indexInParent, Node* nodes, MetaNode* metanodes, int32_t& io_nodeCount,
+      const CepuUtil::Buffer<int32_t>& leafIndexRemap);
 
     void RefitForNodeBoundsChange(int32_t nodeIndex);
     float RefitAndMeasure(NodeChild& child);
-    float RefitAndMark(int32_t leafCountThreshold, std::vector<int32_t>& refinementCandidates, CepuUtil::BufferPool* pool); //@QUICKLIST (alektron)
-    float RefitAndMark(NodeChild& child, int32_t leafCountThreshold, std::vector<int32_t>& refinementCandidates, CepuUtil::BufferPool* pool); //@QUICKLIST (alektron)
-    void RefitAndRefine(CepuUtil::BufferPool* pool, int32_t frameIndex, float refineAggressivenessScale = 1, float chacheOptimizeAggressivenessScale = 1);
+    float RefitAndMark(int32_t leafCountThreshold, CepuUtil::QuickList<int32_t>& refinementCandidates, CepuUtil::FrameArena* arena);
+    float RefitAndMark(NodeChild& child, int32_t leafCountThreshold, CepuUtil::QuickList<int32_t>& refinementCandidates, CepuUtil::FrameArena* arena);
+    //All temporaries are taken from the arena and released before returning, so a warmed up arena makes this free of heap allocations.
+    void RefitAndRefine(CepuUtil::FrameArena* arena, int32_t frameIndex, float refineAggressivenessScale = 1, float chacheOptimizeAggressivenessScale = 1);
+    //Multithreaded variant; see RefitAndRefineMultithreadedContext. Workers allocate their temporaries from the dispatcher's thread memory pools.
+    void RefitAndRefine(CepuUtil::FrameArena* arena, CepuUtil::IThreadDispatcher* threadDispatcher, int32_t frameIndex, float refineAggressivenessScale = 1, float cacheOptimizeAggressivenessScale = 1);
 
     void GetRefitAndMarkTuning(int32_t& o_maximumSubtrees, int32_t& o_estimatedRefinementChandidateCount, int32_t& o_refinementLeafCountThreshold) const;
     void GetRefineTuning(int32_t frameIndex, int32_t refinementCndidatesCount, float refineAggressivenessScale, float costChange,
       int32_t& o_targetRefinementCount, int32_t& o_refinementPeriod, int32_t& o_refinementOffset) const;
 
-    void CollectSubtrees(int32_t nodeIndex, int32_t maximumSubtrees, SubtreeHeapEntry* entries, std::vector<int32_t>& subtrees, std::vector<int32_t>& internalNodes, float& o_treeletCost);
+    void CollectSubtrees(int32_t nodeIndex, int32_t maximumSubtrees, SubtreeHeapEntry* entries, CepuUtil::QuickList<int32_t>& subtrees, CepuUtil::QuickList<int32_t>& internalNodes, float& o_treeletCost);
     void ValidateStaging(Node* stagingNodes, int32_t stagingNodeIndex,
-      std::vector<int32_t>& subtreeNodePointers, std::vector<int32_t>& collectedSubtreeReferences, 
-      std::vector<int32_t>& internalReferences, CepuUtil::BufferPool* pool, int32_t& foundSubtrees, int32_t& foundLeafCount);
+      CepuUtil::QuickList<int32_t>& subtreeNodePointers, CepuUtil::QuickList<int32_t>& collectedSubtreeReferences, 
+      CepuUtil::QuickList<int32_t>& internalReferences, CepuUtil::FrameArena* arena, int32_t& foundSubtrees, int32_t& foundLeafCount);
 
-    static void CreateBinnedResources(CepuUtil::BufferPool* pool, int32_t maximumSubtreeCount, CepuUtil::Buffer<uint8_t>& o_buffer, BinnedResources& o_resources);
+    static void CreateBinnedResources(CepuUtil::FrameArena* arena, int32_t maximumSubtreeCount, CepuUtil::Buffer<uint8_t>& o_buffer, BinnedResources& o_resources);
     int32_t CreateStagingNodeBinned(BinnedResources& resources, int32_t start, int32_t count, int32_t& io_stagingNodeCount, float& io_childTreeletsCost) const;
-      void BinnedRefine(int32_t nodeIndex, std::vector<int32_t>& subtreeReferences, int32_t maximumSubtrees, std::vector<int32_t>& treeletInternalNodes,
-      BinnedResources& resources, CepuUtil::BufferPool* pool);
+    void BinnedRefine(int32_t nodeIndex, CepuUtil::QuickList<int32_t>& subtreeReferences, int32_t maximumSubtrees, CepuUtil::QuickList<int32_t>& treeletInternalNodes,
+      BinnedResources& resources);
     void ReifyStagingNodes(int treeletRootIndex, Node* stagingNodes,
-      std::vector<int32_t>& subtrees, std::vector<int32_t>& treeletInternalNodes, int32_t& io_nextInternalNodeIndexToUse);
-    void ReifyChildren(int32_t internalNodeIndex, Node* stagingNodes, std::vector<int32_t>& subtrees, std::vector<int32_t>& treeletInternalNodes,
+      CepuUtil::QuickList<int32_t>& subtrees, CepuUtil::QuickList<int32_t>& treeletInternalNodes, int32_t& io_nextInternalNodeIndexToUse);
+    void ReifyChildren(int32_t internalNodeIndex, Node* stagingNodes, CepuUtil::QuickList<int32_t>& subtrees, CepuUtil::QuickList<int32_t>& treeletInternalNodes,
       int32_t& nextInternalNodeIndexToUse);
     int32_t ReifyStagingNode(int32_t parent, int32_t indexInParent, Node* stagingNodes, int32_t stagingNodeIndex,
-      std::vector<int>& subtrees, std::vector<int>& treeletInternalNodes,
+      CepuUtil::QuickList<int32_t>& subtrees, CepuUtil::QuickList<int32_t>& treeletInternalNodes,
       int32_t& io_nextInternalNodeIndexToUse);
     void SplitSubtreesIntoChildrenBinned(BinnedResources& resources, int32_t start, int32_t count,
       int32_t stagingNodeIndex, int32_t& stagingNodesCount, float& o_childrenTreeletsCost) const;
@@ -70,6 +104,16 @@ namespace CepuPhysics
     int32_t GetCacheOptimizeTuning(int32_t maximumSubtrees, float costChange, float cacheOptimizeAggressivenessScale);
 
     void IncrementalCacheOptimize(int32_t nodeIndex);
+    //Rewrites every node into depth first order in one pass: a node's A child directly follows it and its B child follows A's subtree.
+    //That's the order IncrementalCacheOptimize converges toward, so this is useful after bulk changes that scramble the layout.
+    //Only nodes move; leaf indices are unchanged, so anything indexed by leaf (like the broad phase's collidable references) stays valid.
+    void CacheOptimize(CepuUtil::BufferPool& pool);
+    void CacheOptimizeNode(int32_t sourceIndex, int32_t targetIndex, Node* nodes, MetaNode* metanodes);
+    //Same as IncrementalCacheOptimize, but safe to run on multiple threads at once. Nodes are locked through their RefineFlag, so all flags must be 0 when it runs.
+    //If any lock can't be taken, the swap is skipped; incremental optimization only relies on eventual progress.
+    void IncrementalCacheOptimizeThreadSafe(int32_t nodeIndex);
+    bool TryLock(int32_t nodeIndex);
+    void Unlock (int32_t nodeIndex);
     void SwapNodes(int32_t indexA, int32_t indexB);
 
     static float ComputeBoundsMetric(const CepuUtil::BoundingBox& bounds);
@@ -0,0 +1,179 @@
+#include "CepuPhysicsPCH.h"
+#include "Tree.h"
+#include "Tree_BinnedRefine.h"
+#include "Memory/QuickList.h"
+#include "Threading/IThreadDispatcher.h"
+
+using namespace CepuUtil;
+
+namespace CepuPhysics
+{
+  //The bin space resources are small and rewritten by every partition, so each thread building subtrees needs its own set.
+  static void TakeBinResources(BufferPool* pool, Buffer<uint8_t>& o_buffer, BinnedResources& io_resources)
+  {
+    int32_t bytesRequired =
+      16 * (6 + 11) + sizeof(BoundingBox) * MAXIMUM_BIN_COUNT * 6 + sizeof(int32_t) * MAXIMUM_BIN_COUNT * 11;
+    pool->TakeAtLeast(bytesRequired, o_buffer);
+    auto memory = o_buffer.m_Memory;
+    int32_t memoryAllocated = 0;
+
+    io_resources.ALeafCountsX = (int*)Suballocate(memory, memoryAllocated, sizeof(int) * MAXIMUM_BIN_COUNT);
+    io_resources.ALeafCountsY = (int*)Suballocate(memory, memoryAllocated, sizeof(int) * MAXIMUM_BIN_COUNT);
+    io_resources.ALeafCountsZ = (int*)Suballocate(memory, memoryAllocated, sizeof(int) * MAXIMUM_BIN_COUNT);
+    io_resources.AMergedX = (BoundingBox*)Suballocate(memory, memoryAllocated, sizeof(BoundingBox) * MAXIMUM_BIN_COUNT);
+    io_resources.AMergedY = (BoundingBox*)Suballocate(memory, memoryAllocated, sizeof(BoundingBox) * MAXIMUM_BIN_COUNT);
+    io_resources.AMergedZ = (BoundingBox*)Suballocate(memory, memoryAllocated, sizeof(BoundingBox) * MAXIMUM_BIN_COUNT);
+
+    io_resources.BinBoundingBoxesX = (BoundingBox*)Suballocate(memory, memoryAllocated, sizeof(BoundingBox) * MAXIMUM_BIN_COUNT);
+    io_resources.BinBoundingBoxesY = (BoundingBox*)Suballocate(memory, memoryAllocated, sizeof(BoundingBox) * MAXIMUM_BIN_COUNT);
+    io_resources.BinBoundingBoxesZ = (BoundingBox*)Suballocate(memory, memoryAllocated, sizeof(BoundingBox) * MAXIMUM_BIN_COUNT);
+    io_resources.BinLeafCountsX = (int*)Suballocate(memory, memoryAllocated, sizeof(int) * MAXIMUM_BIN_COUNT);
+    io_resources.BinLeafCountsY = (int*)Suballocate(memory, memoryAllocated, sizeof(int) * MAXIMUM_BIN_COUNT);
+    io_resources.BinLeafCountsZ = (int*)Suballocate(memory, memoryAllocated, sizeof(int) * MAXIMUM_BIN_COUNT);
+    io_resources.BinSubtreeCountsX = (int*)Suballocate(memory, memoryAllocated, sizeof(int) * MAXIMUM_BIN_COUNT);
+    io_resources.BinSubtreeCountsY = (int*)Suballocate(memory, memoryAllocated, sizeof(int) * MAXIMUM_BIN_COUNT);
+    io_resources.BinSubtreeCountsZ = (int*)Suballocate(memory, memoryAllocated, sizeof(int) * MAXIMUM_BIN_COUNT);
+    io_resources.BinStartIndices = (int*)Suballocate(memory, memoryAllocated, sizeof(int) * MAXIMUM_BIN_COUNT);
+    io_resources.BinSubtreeCountsSecondPass = (int*)Suballocate(memory, memoryAllocated, sizeof(int) * MAXIMUM_BIN_COUNT);
+
+    assert(memoryAllocated <= o_buffer.GetLength() && "The allocated buffer should be large enough for all the suballocations.");
+  }
+
+  void Tree::BuildFrom(const Buffer<BoundingBox>& leafBounds, BufferPool& pool, IThreadDispatcher* threadDispatcher)
+  {
+    auto leafCount = leafBounds.GetLength();
+    Clear();
+    if (m_Leaves.GetLength() < leafCount)
+      Resize(pool, leafCount);
+    if (leafCount == 0)
+      return;
+
+    m_LeafCount = leafCount;
+    if (leafCount == 1) {
+      InitializeSingleLeafRoot(leafBounds[0]);
+      return;
+    }
+    //A binary tree with n leaves has n - 1 internal nodes.
+    m_NodeCount = leafCount - 1;
+
+    //Every leaf is treated as a single leaf subtree, which lets the build share the binned partitioning used by refinement.
+    //The per subtree arrays cover all leaves; partitions only ever touch the slots of the range they're working on.
+    BinnedResources resources = {};
+    resources.BoundingBoxes = leafBounds.m_Memory;
+    Buffer<uint8_t> leafResourcesBuffer;
+    int32_t leafResourcesBytesRequired = 16 * 7 + (sizeof(int) * 6 + sizeof(glm::vec3)) * leafCount;
+    pool.TakeAtLeast(leafResourcesBytesRequired, leafResourcesBuffer);
+    auto memory = leafResourcesBuffer.m_Memory;
+    int32_t memoryAllocated = 0;
+    resources.LeafCounts         = (int*      )Suballocate(memory, memoryAllocated, sizeof(int)       * leafCount);
+    resources.IndexMap           = (int*      )Suballocate(memory, memoryAllocated, sizeof(int)       * leafCount);
+    resources.Centroids          = (glm::vec3*)Suballocate(memory, memoryAllocated, sizeof(glm::vec3) * leafCount);
+    resources.SubtreeBinIndicesX = (int*      )Suballocate(memory, memoryAllocated, sizeof(int)       * leafCount);
+    resources.SubtreeBinIndicesY = (int*      )Suballocate(memory, memoryAllocated, sizeof(int)       * leafCount);
+    resources.SubtreeBinIndicesZ = (int*      )Suballocate(memory, memoryAllocated, sizeof(int)       * leafCount);
+    resources.TempIndexMap       = (int*      )Suballocate(memory, memoryAllocated, sizeof(int)       * leafCount);
+    assert(memoryAllocated <= leafResourcesBuffer.GetLength());
+    for (int32_t i = 0; i < leafCount; ++i) {
+      resources.LeafCounts[i] = 1;
+      resources.IndexMap[i] = i;
+      resources.Centroids[i] = leafBounds[i].m_Min + leafBounds[i].m_Max;
+    }
+
+    Buffer<uint8_t> binResourcesBuffer;
+    TakeBinResources(&pool, binResourcesBuffer, resources);
+    //Below this many leaves, handing the subtrees out to workers costs more than it saves.
+    const int32_t MINIMUM_MULTITHREADED_LEAF_COUNT = 4096;
+    if (threadDispatcher == nullptr || threadDispatcher->GetThreadCount() <= 1 || leafCount < MINIMUM_MULTITHREADED_LEAF_COUNT) {
+      BinnedBuildNode(resources, 0, -1, -1, 0, leafCount, nullptr, 0, nullptr);
+    }
+    else {
+      //Split the top of the tree on this thread until the remaining subtrees are small enough that there are several per worker to balance the load.
+      auto threadCount = threadDispatcher->GetThreadCount();
+      auto jobLeafCountThreshold = leafCount / (threadCount * 4);
+      QuickList<BinnedBuildJob> jobs(threadCount * 8, &pool);
+      BinnedBuildNode(resources, 0, -1, -1, 0, leafCount, &jobs, jobLeafCountThreshold, &pool);
+
+      Buffer<BinnedResources> workerResources;
+      Buffer<Buffer<uint8_t>> workerBinResourcesBuffers;
+      pool.Take(threadCount, workerResources);
+      pool.Take(threadCount, workerBinResourcesBuffers);
+      for (int32_t i = 0; i < threadCount; ++i) {
+        workerResources[i] = resources;
+        TakeBinResources(threadDispatcher->GetThreadMemoryPool(i), workerBinResourcesBuffers[i], workerResources[i]);
+      }
+
+      threadDispatcher->DispatchTasks(jobs.m_Count, [&](int32_t jobIndex, int32_t workerIndex) {
+        auto& job = jobs[jobIndex];
+        //Partitions index their per subtree scratch from zero. Jobs own disjoint leaf ranges, so offsetting the scratch to the job's start keeps workers apart.
+        auto jobResources = workerResources[workerIndex];
+        jobResources.SubtreeBinIndicesX += job.Start;
+        jobResources.SubtreeBinIndicesY += job.Start;
+        jobResources.SubtreeBinIndicesZ += job.Start;
+        jobResources.TempIndexMap       += job.Start;
+        BinnedBuildNode(jobResources, job.NodeIndex, job.Parent, job.IndexInParent, job.Start, job.Count, nullptr, 0, nullptr);
+      });
+
+      for (int32_t i = 0; i < threadCount; ++i)
+        threadDispatcher->GetThreadMemoryPool(i)->Return(workerBinResourcesBuffers[i]);
+      pool.Return(workerBinResourcesBuffers);
+      pool.Return(workerResources);
+      jobs.Dispose(&pool);
+    }
+    pool.Return(binResourcesBuffer);
+    pool.Return(leafResourcesBuffer);
+  }
+
+  void Tree::BinnedBuildNode(const BinnedResources& resources, int32_t nodeIndex, int32_t parentIndex, int32_t indexInParent, int32_t start, int32_t count,
+    QuickList<BinnedBuildJob>* jobs, int32_t jobLeafCountThreshold, BufferPool* pool)
+  {
+    assert(count >= 2 && "Only the root may have fewer than two leaves, and the build handles that case on its own.");
+    auto& metanode = m_Metanodes[nodeIndex];
+    metanode.Parent = parentIndex;
+    metanode.IndexInParent = indexInParent;
+    metanode.RefineFlag = 0;
+    metanode.LocalCostChange = 0;
+    auto& node = m_Nodes[nodeIndex];
+
+    int32_t childStarts[2];
+    int32_t childCounts[2];
+    BoundingBox childBounds[2];
+    if (count == 2) {
+      childStarts[0] = start;
+      childStarts[1] = start + 1;
+      childCounts[0] = childCounts[1] = 1;
+      childBounds[0] = resources.BoundingBoxes[resources.IndexMap[start]];
+      childBounds[1] = resources.BoundingBoxes[resources.IndexMap[start + 1]];
+    }
+    else {
+      int32_t splitIndex, leafCountA, leafCountB;
+      FindPartitionBinned(resources, start, count, splitIndex, childBounds[0], childBounds[1], leafCountA, leafCountB);
+      childStarts[0] = start;
+      childStarts[1] = splitIndex;
+      childCounts[0] = splitIndex - start;
+      childCounts[1] = start + count - splitIndex;
+    }
+
+    //Nodes are laid out depth first: A's subtree directly follows this node and B's subtree follows A's.
+    //A subtree with n leaves takes n - 1 nodes, so every child's node index is known up front and jobs never allocate.
+    int32_t childNodeIndices[2] = { nodeIndex + 1, nodeIndex + childCounts[0] };
+    for (int32_t i = 0; i < 2; ++i) {
+      assert(childCounts[i] > 0 && "Binned partitioning should never produce an empty side.");
+      auto& child = (&node.A)[i];
+      child.Min = childBounds[i].m_Min;
+      child.Max = childBounds[i].m_Max;
+      child.LeafCount = childCounts[i];
+      if (childCounts[i] == 1) {
+        auto leafIndex = resources.IndexMap[childStarts[i]];
+        child.Index = Encode(leafIndex);
+        m_Leaves[leafIndex] = Leaf(nodeIndex, i);
+      }
+      else {
+        child.Index = childNodeIndices[i];
+        if (jobs != nullptr && childCounts[i] <= jobLeafCountThreshold)
+          jobs->Allocate(pool) = { childNodeIndices[i], nodeIndex, i, childStarts[i], childCounts[i] };
+        else
+          BinnedBuildNode(resources, childNodeIndices[i], nodeIndex, i, childStarts[i], childCounts[i], jobs, jobLeafCountThreshold, pool);
+      }
+    }
+  }
+}
@@ -2,17 +2,17 @@
 #include "Tree.h"
 #include "Tree_BinnedRefine.h"
 #include "Tree_RefineCommon.h"
+#include "Memory/QuickList.h"
+#include "Memory/FrameArena.h"
 
 using namespace CepuUtil;
 
 namespace CepuPhysics
 {
-  constexpr const int MAXIMUM_BIN_COUNT = 64;
-
-  void Tree::ReifyChildren(int32_t internalNodeIndex, Node* stagingNodes, std::vector<int32_t>& subtrees, std::vector<int32_t>& treeletInternalNodes,
+  void Tree::ReifyChildren(int32_t internalNodeIndex, Node* stagingNodes, QuickList<int32_t>& subtrees, QuickList<int32_t>& treeletInternalNodes,
     int32_t& nextInternalNodeIndexToUse)
   {
-    assert(subtrees.size() > 1);
+    assert(subtrees.m_Count > 1);
     auto& internalNode = m_Nodes[internalNodeIndex];
     for (int i = 0; i < 2; ++i)
     {
@@ -48,11 +48,11 @@ namespace CepuPhysics
   }
 
   int32_t Tree::ReifyStagingNode(int32_t parent, int32_t indexInParent, Node* stagingNodes, int32_t stagingNodeIndex,
-    std::vector<int>& subtrees, std::vector<int>& treeletInternalNodes,
+    QuickList<int32_t>& subtrees, QuickList<int32_t>& treeletInternalNodes,
     int32_t& io_nextInternalNodeIndexToUse)
   {
     int32_t internalNodeIndex;
-    assert(io_nextInternalNodeIndexToUse < treeletInternalNodes.size() &&
+    assert(io_nextInternalNodeIndexToUse < treeletInternalNodes.m_Count &&
       "Binary trees should never run out of available internal nodes when reifying staging nodes; no nodes are created or destroyed during the process.");
 
     //There is an internal node that we can use.
@@ -78,7 +78,7 @@ namespace CepuPhysics
   }
 
   void Tree::ReifyStagingNodes(int treeletRootIndex, Node* stagingNodes,
-    std::vector<int32_t>& subtrees, std::vector<int32_t>& treeletInternalNodes, int32_t& io_nextInternalNodeIndexToUse)
+    QuickList<int32_t>& subtrees, QuickList<int32_t>& treeletInternalNodes, int32_t& io_nextInternalNodeIndexToUse)
   {
     //We take the staging node's child bounds, child indices, leaf counts, and child count.
     //The parent and index in parent of the treelet root CANNOT BE TOUCHED.
@@ -443,25 +443,25 @@ namespace CepuPhysics
 
   }
 
-  void Tree::BinnedRefine(int32_t nodeIndex, std::vector<int32_t>& subtreeReferences, int32_t maximumSubtrees, std::vector<int32_t>& treeletInternalNodes,
-    BinnedResources& resources, CepuUtil::BufferPool* pool)
+  void Tree::BinnedRefine(int32_t nodeIndex, QuickList<int32_t>& subtreeReferences, int32_t maximumSubtrees, QuickList<int32_t>& treeletInternalNodes,
+    BinnedResources& resources)
   {
     float originalTreeletCost = 0;
-    assert(subtreeReferences.size() == 0 && "The subtree references list should be empty since it's about to get filled.");
-    assert(subtreeReferences.capacity() >= maximumSubtrees && "Subtree references list should have o_a backing array large enough to hold all possible subtrees.");
-    assert(treeletInternalNodes.size() == 0 && "The treelet internal nodes list should be empty since it's about to get filled.");
-    assert(treeletInternalNodes.capacity() >= maximumSubtrees - 1 && "Internal nodes queue should have a backing array large enough to hold all possible treelet internal nodes.");
+    assert(subtreeReferences.m_Count == 0 && "The subtree references list should be empty since it's about to get filled.");
+    assert(subtreeReferences.m_Span.GetLength() >= maximumSubtrees && "Subtree references list should have o_a backing array large enough to hold all possible subtrees.");
+    assert(treeletInternalNodes.m_Count == 0 && "The treelet internal nodes list should be empty since it's about to get filled.");
+    assert(treeletInternalNodes.m_Span.GetLength() >= maximumSubtrees - 1 && "Internal nodes queue should have a backing array large enough to hold all possible treelet internal nodes.");
     CollectSubtrees(nodeIndex, maximumSubtrees, resources.SubtreeHeapEntries, subtreeReferences, treeletInternalNodes, originalTreeletCost);
-    assert(treeletInternalNodes.size() == subtreeReferences.size() - 2 &&
+    assert(treeletInternalNodes.m_Count == subtreeReferences.m_Count - 2 &&
       "Given that this is o_a binary tree, the number of subtree references found must match the internal nodes traversed to reach them. Note that the treelet root is excluded.");
-    assert(subtreeReferences.size() <= maximumSubtrees);
+    assert(subtreeReferences.m_Count <= maximumSubtrees);
 
     //TODO: There's no reason to use a priority queue based node selection process for MOST treelets. It's only useful for the root node treelet.
     //For the others, we can use a much cheaper collection scheme.
     //CollectSubtreesDirect(nodeIndex, maximumSubtrees,  subtreeReferences,  treeletInternalNodes, out originalTreeletCost);
 
     //Gather necessary information from nodes.
-    for (int i = 0; i < subtreeReferences.size(); ++i)
+    for (int i = 0; i < subtreeReferences.m_Count; ++i)
     {
       resources.IndexMap[i] = i;
       if (subtreeReferences[i] >= 0)
@@ -495,7 +495,7 @@ namespace CepuPhysics
     int stagingNodeCount = 0;
 
     float newTreeletCost = 0;
-    CreateStagingNodeBinned(resources, 0, (int32_t)subtreeReferences.size(), stagingNodeCount, newTreeletCost);
+    CreateStagingNodeBinned(resources, 0, subtreeReferences.m_Count, stagingNodeCount, newTreeletCost);
     //Copy the refine flag over from the treelet root so that it persists.
     resources.RefineFlags[0] = m_Metanodes[nodeIndex].RefineFlag;
 
@@ -511,7 +511,8 @@ namespace CepuPhysics
       ReifyStagingNodes(nodeIndex, resources.StagingNodes, subtreeReferences, treeletInternalNodes, nextInternalNodeIndexToUse);
     }
 
-    ValidateBounds(nodeIndex);
+    //Note that the treelet root's bounds aren't validated here. When refining on multiple threads, another worker may be rewriting
+    //the root's parent pointers; callers validate once all refinements are done.
   }
 
   uint8_t* Suballocate(uint8_t* Memory, int32_t& memoryAllocated, int32_t byteCount)
@@ -529,7 +530,7 @@ namespace CepuPhysics
 
   }
 
-  void Tree::CreateBinnedResources(BufferPool* pool, int32_t maximumSubtreeCount, Buffer<uint8_t>& o_buffer, BinnedResources& o_resources)
+  void Tree::CreateBinnedResources(FrameArena* arena, int32_t maximumSubtreeCount, Buffer<uint8_t>& o_buffer, BinnedResources& o_resources)
   {
     //TODO: This is a holdover from the pre-BufferPool tree design. It's pretty ugly. While some preallocation is useful (there's no reason to suffer the overhead of 
     //pulling things out of the BufferPool over and over and over again), the degree to which this preallocates has a negative impact on L1 cache for subtree refines.
@@ -542,7 +543,7 @@ namespace CepuPhysics
       16 * (1) + sizeof(Node) * nodeCount +
       16 * (1) + sizeof(int) * nodeCount;
 
-    pool->TakeAtLeast(bytesRequired, o_buffer);
+    arena->TakeAtLeast(bytesRequired, o_buffer);
     memset(o_buffer.m_Memory, 0, bytesRequired);
     auto memory = o_buffer.m_Memory;
     int memoryAllocated = 0;
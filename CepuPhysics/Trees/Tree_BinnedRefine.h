@@ -4,6 +4,8 @@ namespace CepuPhysics
 {
   struct SubtreeHeapEntry;
 
+  constexpr const int MAXIMUM_BIN_COUNT = 64;
+
   //TODO: This type was built on assumptions which are no longer valid today; could avoid this complexity with virtually zero overhead now.
   //This will likely be revisited during the larger tree refinement revamp.
   struct BinnedResources
@@ -55,4 +57,17 @@ namespace CepuPhysics
     int32_t* BinStartIndices;
     int32_t* BinSubtreeCountsSecondPass;
   };
+
+  //A subtree of a binned build whose construction was deferred so that it can be built on another thread.
+  struct BinnedBuildJob
+  {
+    int32_t NodeIndex;
+    int32_t Parent;
+    int32_t IndexInParent;
+    int32_t Start;
+    int32_t Count;
+  };
+
+  //Carves byteCount bytes (rounded up to 16) out of memory, starting at memoryAllocated.
+  uint8_t* Suballocate(uint8_t* memory, int32_t& memoryAllocated, int32_t byteCount);
 }
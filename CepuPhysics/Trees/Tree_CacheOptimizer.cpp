@@ -1,5 +1,7 @@
 #include "CepuPhysicsPCH.h"
 #include "Tree.h"
+#include "Threading/Interlocked.h"
+#include "Memory/BufferPool.h"
 
 namespace CepuPhysics
 {
@@ -30,10 +32,11 @@ namespace CepuPhysics
 
 
     //Update the parent pointers of the children.
-    auto& children = a.A;
+    //Note that this has to be a pointer; reassigning a reference to b.A below would copy b's children over a's.
+    auto children = &a.A;
     for (int i = 0; i < 2; ++i)
     {
-      auto& child = (&children)[i];
+      auto& child = children[i];
       if (child.Index >= 0)
       {
         m_Metanodes[child.Index].Parent = indexA;
@@ -44,10 +47,10 @@ namespace CepuPhysics
         m_Leaves[leafIndex] = Leaf(indexA, i);
       }
     }
-    children = b.A;
+    children = &b.A;
     for (int i = 0; i < 2; ++i)
     {
-      auto& child = (&children)[i];
+      auto& child = children[i];
       if (child.Index >= 0)
       {
         m_Metanodes[child.Index].Parent = indexB;
@@ -103,4 +106,114 @@ namespace CepuPhysics
       }
     }
   }
+
+  void Tree::CacheOptimize(CepuUtil::BufferPool& pool)
+  {
+    //With two leaves or fewer only the root exists.
+    if (m_LeafCount <= 2)
+      return;
+    CepuUtil::Buffer<Node> newNodes;
+    CepuUtil::Buffer<MetaNode> newMetanodes;
+    pool.Take(m_Nodes.GetLength(), newNodes);
+    pool.Take(m_Metanodes.GetLength(), newMetanodes);
+    newMetanodes[0] = m_Metanodes[0];
+    CacheOptimizeNode(0, 0, newNodes.m_Memory, newMetanodes.m_Memory);
+    newMetanodes.Clear(m_NodeCount, newMetanodes.GetLength() - m_NodeCount);
+    pool.Return(m_Nodes);
+    pool.Return(m_Metanodes);
+    m_Nodes = newNodes;
+    m_Metanodes = newMetanodes;
+  }
+
+  void Tree::CacheOptimizeNode(int32_t sourceIndex, int32_t targetIndex, Node* nodes, MetaNode* metanodes)
+  {
+    auto& node = nodes[targetIndex];
+    node = m_Nodes[sourceIndex];
+    //A subtree with n leaves holds n - 1 nodes, so the B child's position is known without visiting A's subtree.
+    int32_t childTargetIndices[2] = { targetIndex + 1, targetIndex + node.A.LeafCount };
+    for (int32_t i = 0; i < 2; ++i)
+    {
+      auto& child = (&node.A)[i];
+      if (child.Index >= 0)
+      {
+        auto& metanode = metanodes[childTargetIndices[i]];
+        metanode = m_Metanodes[child.Index];
+        metanode.Parent = targetIndex;
+        metanode.IndexInParent = i;
+        auto childSourceIndex = child.Index;
+        child.Index = childTargetIndices[i];
+        CacheOptimizeNode(childSourceIndex, childTargetIndices[i], nodes, metanodes);
+      }
+      else
+      {
+        m_Leaves[Encode(child.Index)] = Leaf(targetIndex, i);
+      }
+    }
+  }
+
+  bool Tree::TryLock(int32_t nodeIndex)
+  {
+    return CepuUtil::Interlocked::CompareExchange(m_Metanodes[nodeIndex].RefineFlag, 1, 0) == 0;
+  }
+
+  void Tree::Unlock(int32_t nodeIndex)
+  {
+    CepuUtil::Interlocked::Write(m_Metanodes[nodeIndex].RefineFlag, 0);
+  }
+
+  void Tree::IncrementalCacheOptimizeThreadSafe(int32_t nodeIndex)
+  {
+    if (m_LeafCount <= 2)
+      return;
+
+    //A swap touches the two swapped nodes, the parents pointing at them and the parent pointers of their children.
+    //We hold locks on the swapped nodes and both parents. The children don't need locks: any other worker that wants to move one of them
+    //has to lock its parent first, which is one of the swapped nodes.
+    //Note that the lock on nodeIndex also keeps its own children stable for the duration.
+    if (!TryLock(nodeIndex))
+      return;
+
+    auto& node = m_Nodes[nodeIndex];
+    auto& children = node.A;
+    auto targetIndex = nodeIndex + 1;
+
+    for (int i = 0; i < 2; ++i)
+    {
+      if (targetIndex >= m_NodeCount)
+        break;
+      auto& child = (&children)[i];
+      if (child.Index >= 0)
+      {
+        auto childIndex = child.Index;
+        if (childIndex != targetIndex && TryLock(childIndex))
+        {
+          if (TryLock(targetIndex))
+          {
+            //The target's parent can move until we hold its lock (whoever swaps it rewrites our target's parent pointer), so check again after locking.
+            auto targetParent = CepuUtil::Interlocked::Read(m_Metanodes[targetIndex].Parent);
+            bool parentAlreadyHeld = targetParent == nodeIndex || targetParent == childIndex;
+            bool parentLocked = parentAlreadyHeld;
+            if (!parentAlreadyHeld && TryLock(targetParent))
+            {
+              if (CepuUtil::Interlocked::Read(m_Metanodes[targetIndex].Parent) == targetParent)
+                parentLocked = true;
+              else
+                Unlock(targetParent);
+            }
+            if (parentLocked)
+            {
+              //SwapNodes moves the metanodes wholesale, so the lock flags on both indices survive the swap.
+              SwapNodes(childIndex, targetIndex);
+              if (!parentAlreadyHeld)
+                Unlock(targetParent);
+            }
+            Unlock(targetIndex);
+          }
+          Unlock(childIndex);
+        }
+        targetIndex += child.LeafCount - 1;
+      }
+    }
+    Unlock(nodeIndex);
+  }
 }
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+#include "Tree_SelfQueries.h"
+
+namespace CepuPhysics
+{
+  //Reports overlaps with the indices swapped. Used when a leaf from tree B is tested against a node in tree A, so that handlers always see (leaf in A, leaf in B).
+  template<typename TOverlapHandler>
+  struct FlippedOverlapHandler
+  {
+    TOverlapHandler& m_Inner;
+    void Handle(int32_t indexA, int32_t indexB) { m_Inner.Handle(indexB, indexA); }
+  };
+
+  template<typename TOverlapHandler>
+  void DispatchTestForNodes(const Tree&, const NodeChild&, const Tree&, const NodeChild&, TOverlapHandler&);
+
+  template<typename TOverlapHandler>
+  void GetOverlapsBetweenDifferentNodes(const Tree& treeA, const Node& a, const Tree& treeB, const Node& b, TOverlapHandler& results)
+  {
+    //There are no shared children, so test them all.
+    auto& aa = a.A;
+    auto& ab = a.B;
+    auto& ba = b.A;
+    auto& bb = b.B;
+    auto aaIntersects = Intersects(aa, ba);
+    auto abIntersects = Intersects(aa, bb);
+    auto baIntersects = Intersects(ab, ba);
+    auto bbIntersects = Intersects(ab, bb);
+
+    if (aaIntersects)
+    {
+      DispatchTestForNodes(treeA, aa, treeB, ba, results);
+    }
+    if (abIntersects)
+    {
+      DispatchTestForNodes(treeA, aa, treeB, bb, results);
+    }
+    if (baIntersects)
+    {
+      DispatchTestForNodes(treeA, ab, treeB, ba, results);
+    }
+    if (bbIntersects)
+    {
+      DispatchTestForNodes(treeA, ab, treeB, bb, results);
+    }
+  }
+
+  template<typename TOverlapHandler>
+  void DispatchTestForNodes(const Tree& treeA, const NodeChild& a, const Tree& treeB, const NodeChild& b, TOverlapHandler& results)
+  {
+    if (a.Index >= 0)
+    {
+      if (b.Index >= 0)
+      {
+        GetOverlapsBetweenDifferentNodes(treeA, treeA.m_Nodes[a.Index], treeB, treeB.m_Nodes[b.Index], results);
+      }
+      else
+      {
+        //leaf B versus node A. The leaf belongs to tree B, so the reported pairs have to be flipped back into (A, B) order.
+        FlippedOverlapHandler<TOverlapHandler> flippedResults{ results };
+        TestLeafAgainstNode(treeA, Tree::Encode(b.Index), b.Min, b.Max, a.Index, flippedResults);
+      }
+    }
+    else if (b.Index >= 0)
+    {
+      //leaf A versus node B.
+      TestLeafAgainstNode(treeB, Tree::Encode(a.Index), a.Min, a.Max, b.Index, results);
+    }
+    else
+    {
+      //Two leaves.
+      results.Handle(Tree::Encode(a.Index), Tree::Encode(b.Index));
+    }
+  }
+
+  //Reports every overlapping pair of leaves between two different trees. Handlers receive (leaf index in treeA, leaf index in treeB).
+  template<typename TOverlapHandler>
+  void GetOverlaps(const Tree& treeA, const Tree& treeB, TOverlapHandler& results)
+  {
+    if (treeA.m_LeafCount == 0 || treeB.m_LeafCount == 0)
+      return;
+
+    auto& a = treeA.m_Nodes[0];
+    auto& b = treeB.m_Nodes[0];
+    if (treeA.m_LeafCount >= 2 && treeB.m_LeafCount >= 2)
+    {
+      //Both trees have complete nodes; we can use the general case.
+      GetOverlapsBetweenDifferentNodes(treeA, a, treeB, b, results);
+    }
+    else
+    {
+      //At least one root only has a single child. Only the occupied children can be tested.
+      auto aChildCount = glm::min(treeA.m_LeafCount, 2);
+      auto bChildCount = glm::min(treeB.m_LeafCount, 2);
+      for (int32_t i = 0; i < aChildCount; ++i)
+      {
+        auto& aChild = (&a.A)[i];
+        for (int32_t j = 0; j < bChildCount; ++j)
+        {
+          auto& bChild = (&b.A)[j];
+          if (Intersects(aChild, bChild))
+            DispatchTestForNodes(treeA, aChild, treeB, bChild, results);
+        }
+      }
+    }
+  }
+}
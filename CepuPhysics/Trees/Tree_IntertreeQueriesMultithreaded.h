@@ -0,0 +1,215 @@
+#pragma once
+#include "Tree.h"
+#include "Node.h"
+#include "Tree_IntertreeQueries.h"
+#include "Memory/QuickList.h"
+#include "Threading/IThreadDispatcher.h"
+
+namespace CepuPhysics
+{
+  //Multithreaded variant of GetOverlaps(treeA, treeB).
+  //Works like MultithreadedSelfTest: the tops of both trees are walked together on the calling thread, node pairs below a leaf count threshold become jobs,
+  //and the jobs are executed across a thread dispatcher with one handler per worker. Handlers receive (leaf index in treeA, leaf index in treeB).
+  //Usage is PrepareJobs -> PairTest on every worker (or ExecuteJob for every job index) -> CompleteTest; Test wraps all three.
+  template<typename TOverlapHandler>
+  class MultithreadedIntertreeTest
+  {
+  public:
+    static constexpr float JOB_MULTIPLIER = 1.5f;
+
+    //Collects the jobs for an intertree test. overlapHandlers must hold at least threadCount handlers; handler 0 receives any overlaps found during collection.
+    //Neither tree may be modified until CompleteTest is called.
+    void PrepareJobs(const Tree& treeA, const Tree& treeB, TOverlapHandler* overlapHandlers, int32_t threadCount, CepuUtil::BufferPool* pool)
+    {
+      m_Jobs.m_Count = 0;
+      if (treeA.m_LeafCount == 0 || treeB.m_LeafCount == 0)
+        return;
+      assert(threadCount > 0);
+      auto targetJobCount = glm::max(1.f, JOB_MULTIPLIER * threadCount);
+      //Job size is measured in the leaves of both trees combined. A huge static tree against a handful of active leaves will mostly produce leaf-versus-node jobs.
+      m_LeafThreshold = (int32_t)((treeA.m_LeafCount + treeB.m_LeafCount) / targetJobCount);
+      m_Jobs = CepuUtil::QuickList<Job>((int32_t)(targetJobCount * 2), pool);
+      m_Pool = pool;
+      m_NextJobIndex = -1;
+      m_TreeA = &treeA;
+      m_TreeB = &treeB;
+      m_OverlapHandlers = overlapHandlers;
+
+      auto& results = overlapHandlers[0];
+      auto& a = treeA.m_Nodes[0];
+      auto& b = treeB.m_Nodes[0];
+      if (treeA.m_LeafCount >= 2 && treeB.m_LeafCount >= 2) {
+        CollectJobsBetweenDifferentNodes(a, b, results);
+      }
+      else {
+        //At least one root only has a single child. Only the occupied children can be tested.
+        auto aChildCount = glm::min(treeA.m_LeafCount, 2);
+        auto bChildCount = glm::min(treeB.m_LeafCount, 2);
+        for (int32_t i = 0; i < aChildCount; ++i) {
+          auto& aChild = (&a.A)[i];
+          for (int32_t j = 0; j < bChildCount; ++j) {
+            auto& bChild = (&b.A)[j];
+            if (Intersects(aChild, bChild))
+              CollectJobsForNodes(aChild, bChild, results);
+          }
+        }
+      }
+    }
+
+    //Releases the job list. Note that an empty tree on either side means no jobs were allocated.
+    void CompleteTest()
+    {
+      if (m_Jobs.m_Span.IsAllocated())
+        m_Jobs.Dispose(m_Pool);
+      m_TreeA = nullptr;
+      m_TreeB = nullptr;
+      m_OverlapHandlers = nullptr;
+    }
+
+    //Executes jobs until none are left. Meant to be called from every worker of a DispatchWorkers call; jobs are claimed from a shared counter.
+    void PairTest(int32_t workerIndex)
+    {
+      int32_t jobIndex;
+      while ((jobIndex = CepuUtil::Interlocked::Increment(m_NextJobIndex)) < m_Jobs.m_Count)
+        ExecuteJob(jobIndex, workerIndex);
+    }
+
+    void ExecuteJob(int32_t jobIndex, int32_t workerIndex)
+    {
+      auto& job = m_Jobs[jobIndex];
+      auto& results = m_OverlapHandlers[workerIndex];
+      if (job.A >= 0) {
+        if (job.B >= 0) {
+          //Two internal nodes.
+          GetOverlapsBetweenDifferentNodes(*m_TreeA, m_TreeA->m_Nodes[job.A], *m_TreeB, m_TreeB->m_Nodes[job.B], results);
+        }
+        else {
+          //Leaf from tree B versus a node in tree A.
+          auto leafIndex = Tree::Encode(job.B);
+          auto& leafChild = GetChildOwningLeaf(*m_TreeB, leafIndex);
+          FlippedOverlapHandler<TOverlapHandler> flippedResults{ results };
+          TestLeafAgainstNode(*m_TreeA, leafIndex, leafChild.Min, leafChild.Max, job.A, flippedResults);
+        }
+      }
+      else {
+        //Leaf from tree A versus a node in tree B.
+        //Note that two leaves never form a job. The collection handles them directly; a single test isn't worth an atomic increment.
+        auto leafIndex = Tree::Encode(job.A);
+        auto& leafChild = GetChildOwningLeaf(*m_TreeA, leafIndex);
+        TestLeafAgainstNode(*m_TreeB, leafIndex, leafChild.Min, leafChild.Max, job.B, results);
+      }
+    }
+
+    int32_t GetJobCount() const { return m_Jobs.m_Count; }
+
+    //Runs a full intertree test: collects jobs, spreads them over the dispatcher's workers, and releases the jobs.
+    //overlapHandlers must hold one handler per dispatcher thread; handler i only ever receives overlaps from worker i.
+    void Test(const Tree& treeA, const Tree& treeB, TOverlapHandler* overlapHandlers, CepuUtil::IThreadDispatcher* threadDispatcher, CepuUtil::BufferPool* pool)
+    {
+      PrepareJobs(treeA, treeB, overlapHandlers, threadDispatcher->GetThreadCount(), pool);
+      threadDispatcher->DispatchTasks(GetJobCount(), [this](int32_t jobIndex, int32_t workerIndex) { ExecuteJob(jobIndex, workerIndex); });
+      CompleteTest();
+    }
+
+  private:
+    //A node index in tree A and a node index in tree B. An encoded (negative) index is a leaf of the respective tree.
+    struct Job
+    {
+      int32_t A;
+      int32_t B;
+    };
+
+    static const NodeChild& GetChildOwningLeaf(const Tree& tree, int32_t leafIndex)
+    {
+      auto leaf = tree.m_Leaves[leafIndex];
+      return (&tree.m_Nodes[leaf.GetNodeIndex()].A)[leaf.GetChildIndex()];
+    }
+
+    //leafFromTreeB tells which tree the leaf belongs to; the node is always from the other one.
+    void DispatchTestForLeaf(int32_t leafIndex, const NodeChild& leafChild, int32_t nodeIndex, int32_t nodeLeafCount, bool leafFromTreeB, TOverlapHandler& results)
+    {
+      if (nodeIndex < 0) {
+        if (leafFromTreeB)
+          results.Handle(Tree::Encode(nodeIndex), leafIndex);
+        else
+          results.Handle(leafIndex, Tree::Encode(nodeIndex));
+      }
+      else if (nodeLeafCount <= m_LeafThreshold) {
+        if (leafFromTreeB)
+          m_Jobs.Add(Job{ nodeIndex, Tree::Encode(leafIndex) }, m_Pool);
+        else
+          m_Jobs.Add(Job{ Tree::Encode(leafIndex), nodeIndex }, m_Pool);
+      }
+      else {
+        CollectLeafAgainstNode(leafIndex, leafChild, nodeIndex, leafFromTreeB, results);
+      }
+    }
+
+    void CollectLeafAgainstNode(int32_t leafIndex, const NodeChild& leafChild, int32_t nodeIndex, bool leafFromTreeB, TOverlapHandler& results)
+    {
+      auto& node = (leafFromTreeB ? m_TreeA : m_TreeB)->m_Nodes[nodeIndex];
+      auto& a = node.A;
+      auto& b = node.B;
+      auto aIntersects = CepuUtil::BoundingBox::Intersects(leafChild.Min, leafChild.Max, a.Min, a.Max);
+      auto bIntersects = CepuUtil::BoundingBox::Intersects(leafChild.Min, leafChild.Max, b.Min, b.Max);
+      if (aIntersects)
+        DispatchTestForLeaf(leafIndex, leafChild, a.Index, a.LeafCount, leafFromTreeB, results);
+      if (bIntersects)
+        DispatchTestForLeaf(leafIndex, leafChild, b.Index, b.LeafCount, leafFromTreeB, results);
+    }
+
+    //a belongs to tree A, b to tree B.
+    void CollectJobsForNodes(const NodeChild& a, const NodeChild& b, TOverlapHandler& results)
+    {
+      if (a.Index >= 0) {
+        if (b.Index >= 0) {
+          if (a.LeafCount + b.LeafCount <= m_LeafThreshold)
+            m_Jobs.Add(Job{ a.Index, b.Index }, m_Pool);
+          else
+            CollectJobsBetweenDifferentNodes(m_TreeA->m_Nodes[a.Index], m_TreeB->m_Nodes[b.Index], results);
+        }
+        else {
+          //leaf B versus node A.
+          CollectLeafAgainstNode(Tree::Encode(b.Index), b, a.Index, true, results);
+        }
+      }
+      else if (b.Index >= 0) {
+        //leaf A versus node B.
+        CollectLeafAgainstNode(Tree::Encode(a.Index), a, b.Index, false, results);
+      }
+      else {
+        //Two leaves.
+        results.Handle(Tree::Encode(a.Index), Tree::Encode(b.Index));
+      }
+    }
+
+    void CollectJobsBetweenDifferentNodes(const Node& a, const Node& b, TOverlapHandler& results)
+    {
+      auto& aa = a.A;
+      auto& ab = a.B;
+      auto& ba = b.A;
+      auto& bb = b.B;
+      auto aaIntersects = Intersects(aa, ba);
+      auto abIntersects = Intersects(aa, bb);
+      auto baIntersects = Intersects(ab, ba);
+      auto bbIntersects = Intersects(ab, bb);
+
+      if (aaIntersects)
+        CollectJobsForNodes(aa, ba, results);
+      if (abIntersects)
+        CollectJobsForNodes(aa, bb, results);
+      if (baIntersects)
+        CollectJobsForNodes(ab, ba, results);
+      if (bbIntersects)
+        CollectJobsForNodes(ab, bb, results);
+    }
+
+    const Tree* m_TreeA = nullptr;
+    const Tree* m_TreeB = nullptr;
+    TOverlapHandler* m_OverlapHandlers = nullptr;
+    CepuUtil::BufferPool* m_Pool = nullptr;
+    CepuUtil::QuickList<Job> m_Jobs;
+    int32_t m_NextJobIndex = -1;
+    int32_t m_LeafThreshold = 0;
+  };
+}
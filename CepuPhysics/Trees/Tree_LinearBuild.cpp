@@ -0,0 +1,245 @@
+#include "CepuPhysicsPCH.h"
+#include "Tree.h"
+#include "Threading/IThreadDispatcher.h"
+#include "Threading/Interlocked.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace CepuUtil;
+
+namespace CepuPhysics
+{
+  //Spreads the low 21 bits of v out so that there are two zero bits between each of them.
+  static uint64_t SpreadBits(uint64_t v)
+  {
+    v &= 0x1FFFFF;
+    v = (v | v << 32) & 0x1F00000000FFFF;
+    v = (v | v << 16) & 0x1F0000FF0000FF;
+    v = (v | v << 8)  & 0x100F00F00F00F00F;
+    v = (v | v << 4)  & 0x10C30C30C30C30C3;
+    v = (v | v << 2)  & 0x1249249249249249;
+    return v;
+  }
+
+  static int32_t LeadingZeroCount(uint64_t v)
+  {
+    assert(v != 0);
+#ifdef _MSC_VER
+    unsigned long highestSetBit;
+    _BitScanReverse64(&highestSetBit, v);
+    return 63 - (int32_t)highestSetBit;
+#else
+    return __builtin_clzll(v);
+#endif
+  }
+
+  //Length of the common prefix of the keys at sorted positions i and j, or -1 if j is out of range.
+  //Identical keys fall back to comparing positions so that every key is effectively unique.
+  static int32_t CommonPrefixLength(const uint64_t* keys, int32_t leafCount, int32_t i, int32_t j)
+  {
+    if (j < 0 || j >= leafCount)
+      return -1;
+    auto difference = keys[i] ^ keys[j];
+    if (difference == 0)
+      return 64 + LeadingZeroCount((uint64_t)(i ^ j)) - 32;
+    return LeadingZeroCount(difference);
+  }
+
+  //Keys are sorted by RADIX_BITS bits at a time; 6 passes cover the 63 bit keys.
+  static const int32_t RADIX_BITS = 11;
+  static const int32_t RADIX_BUCKET_COUNT = 1 << RADIX_BITS;
+  static const int32_t MORTON_KEY_BITS = 63;
+
+  //Linear BVH build (Karras, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees"):
+  //leaves are sorted along a Morton curve through their centroids, and the sorted keys alone determine every internal node's leaf range and split.
+  //Every stage is a flat loop over leaves or nodes, so it splits into independent blocks for the workers.
+  void Tree::BuildLinearFrom(const Buffer<BoundingBox>& leafBounds, BufferPool& pool, IThreadDispatcher* threadDispatcher)
+  {
+    auto leafCount = leafBounds.GetLength();
+    Clear();
+    if (m_Leaves.GetLength() < leafCount)
+      Resize(pool, leafCount);
+    if (leafCount == 0)
+      return;
+    m_LeafCount = leafCount;
+    if (leafCount == 1) {
+      InitializeSingleLeafRoot(leafBounds[0]);
+      return;
+    }
+    m_NodeCount = leafCount - 1;
+
+    //Workers get contiguous blocks. Below MINIMUM_BLOCK_SIZE elements per block, the dispatch overhead outweighs the work.
+    const int32_t MINIMUM_BLOCK_SIZE = 8192;
+    auto blockCount = threadDispatcher != nullptr ? glm::max(1, glm::min(threadDispatcher->GetThreadCount(), leafCount / MINIMUM_BLOCK_SIZE)) : 1;
+    auto forEachBlock = [&](int32_t elementCount, const std::function<void(int32_t, int32_t, int32_t)>& body) {
+      auto blockSize = (elementCount + blockCount - 1) / blockCount;
+      auto runBlock = [&](int32_t blockIndex, int32_t workerIndex) {
+        auto start = blockIndex * blockSize;
+        body(blockIndex, start, glm::min(start + blockSize, elementCount));
+      };
+      if (blockCount > 1)
+        threadDispatcher->DispatchTasks(blockCount, runBlock);
+      else
+        runBlock(0, 0);
+    };
+
+    //Centroid bounds define the quantization grid. Note that centroids are stored doubled (min + max), like in the binned builders.
+    Buffer<BoundingBox> blockCentroidBounds;
+    pool.Take(blockCount, blockCentroidBounds);
+    forEachBlock(leafCount, [&](int32_t blockIndex, int32_t start, int32_t end) {
+      BoundingBox centroidBounds{ glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest()) };
+      for (int32_t i = start; i < end; ++i) {
+        auto centroid = leafBounds[i].m_Min + leafBounds[i].m_Max;
+        centroidBounds.m_Min = glm::min(centroidBounds.m_Min, centroid);
+        centroidBounds.m_Max = glm::max(centroidBounds.m_Max, centroid);
+      }
+      blockCentroidBounds[blockIndex] = centroidBounds;
+    });
+    auto centroidBounds = blockCentroidBounds[0];
+    for (int32_t i = 1; i < blockCount; ++i)
+      BoundingBox::CreateMerged(centroidBounds, blockCentroidBounds[i], centroidBounds);
+    pool.Return(blockCentroidBounds);
+
+    const float maximumCellIndex = (float)((1 << 21) - 1);
+    auto span = centroidBounds.m_Max - centroidBounds.m_Min;
+    auto scale = glm::vec3(
+      span.x > 0 ? maximumCellIndex / span.x : 0,
+      span.y > 0 ? maximumCellIndex / span.y : 0,
+      span.z > 0 ? maximumCellIndex / span.z : 0);
+
+    Buffer<uint64_t> keys, scratchKeys;
+    Buffer<int32_t> sortedLeaves, scratchLeaves;
+    pool.Take(leafCount, keys);
+    pool.Take(leafCount, scratchKeys);
+    pool.Take(leafCount, sortedLeaves);
+    pool.Take(leafCount, scratchLeaves);
+    forEachBlock(leafCount, [&](int32_t blockIndex, int32_t start, int32_t end) {
+      for (int32_t i = start; i < end; ++i) {
+        auto cell = glm::min((leafBounds[i].m_Min + leafBounds[i].m_Max - centroidBounds.m_Min) * scale, glm::vec3(maximumCellIndex));
+        keys[i] = SpreadBits((uint64_t)cell.x) | SpreadBits((uint64_t)cell.y) << 1 | SpreadBits((uint64_t)cell.z) << 2;
+        sortedLeaves[i] = i;
+      }
+    });
+
+    //LSD radix sort. Each pass histograms every block's digits, turns the histograms into per block output offsets, then scatters stably.
+    Buffer<int32_t> blockBucketOffsets;
+    pool.Take(blockCount * RADIX_BUCKET_COUNT, blockBucketOffsets);
+    for (int32_t shift = 0; shift < MORTON_KEY_BITS; shift += RADIX_BITS) {
+      forEachBlock(leafCount, [&](int32_t blockIndex, int32_t start, int32_t end) {
+        auto counts = &blockBucketOffsets[blockIndex * RADIX_BUCKET_COUNT];
+        memset(counts, 0, sizeof(int32_t) * RADIX_BUCKET_COUNT);
+        for (int32_t i = start; i < end; ++i)
+          ++counts[(keys[i] >> shift) & (RADIX_BUCKET_COUNT - 1)];
+      });
+      int32_t offset = 0;
+      for (int32_t bucketIndex = 0; bucketIndex < RADIX_BUCKET_COUNT; ++bucketIndex) {
+        for (int32_t blockIndex = 0; blockIndex < blockCount; ++blockIndex) {
+          auto& bucket = blockBucketOffsets[blockIndex * RADIX_BUCKET_COUNT + bucketIndex];
+          auto count = bucket;
+          bucket = offset;
+          offset += count;
+        }
+      }
+      forEachBlock(leafCount, [&](int32_t blockIndex, int32_t start, int32_t end) {
+        auto offsets = &blockBucketOffsets[blockIndex * RADIX_BUCKET_COUNT];
+        for (int32_t i = start; i < end; ++i) {
+          auto targetIndex = offsets[(keys[i] >> shift) & (RADIX_BUCKET_COUNT - 1)]++;
+          scratchKeys[targetIndex] = keys[i];
+          scratchLeaves[targetIndex] = sortedLeaves[i];
+        }
+      });
+      std::swap(keys, scratchKeys);
+      std::swap(sortedLeaves, scratchLeaves);
+    }
+    pool.Return(blockBucketOffsets);
+
+    //Internal node i covers a range of sorted leaves that starts or ends at i. The range and its split follow from the common prefix lengths of neighboring keys,
+    //so every node is emitted independently. Node 0 always covers every leaf and becomes the root.
+    m_Metanodes[0].Parent = -1;
+    m_Metanodes[0].IndexInParent = -1;
+    forEachBlock(m_NodeCount, [&](int32_t blockIndex, int32_t start, int32_t end) {
+      for (int32_t i = start; i < end; ++i) {
+        //Find the direction the range extends in, then its other end j by exponential and binary search.
+        auto direction = CommonPrefixLength(keys.m_Memory, leafCount, i, i + 1) - CommonPrefixLength(keys.m_Memory, leafCount, i, i - 1) > 0 ? 1 : -1;
+        auto minimumPrefixLength = CommonPrefixLength(keys.m_Memory, leafCount, i, i - direction);
+        int32_t maximumLength = 2;
+        while (CommonPrefixLength(keys.m_Memory, leafCount, i, i + maximumLength * direction) > minimumPrefixLength)
+          maximumLength *= 2;
+        int32_t length = 0;
+        for (int32_t step = maximumLength / 2; step >= 1; step /= 2) {
+          if (CommonPrefixLength(keys.m_Memory, leafCount, i, i + (length + step) * direction) > minimumPrefixLength)
+            length += step;
+        }
+        auto j = i + length * direction;
+
+        //The split is the last position sharing more than the whole range's common prefix with i.
+        auto nodePrefixLength = CommonPrefixLength(keys.m_Memory, leafCount, i, j);
+        int32_t splitOffset = 0;
+        for (int32_t divisor = 2; ; divisor *= 2) {
+          auto step = (length + divisor - 1) / divisor;
+          if (CommonPrefixLength(keys.m_Memory, leafCount, i, i + (splitOffset + step) * direction) > nodePrefixLength)
+            splitOffset += step;
+          if (step <= 1)
+            break;
+        }
+        auto split = i + splitOffset * direction + glm::min(direction, 0);
+
+        auto rangeStart = glm::min(i, j);
+        auto rangeEnd = glm::max(i, j);
+        auto& node = m_Nodes[i];
+        //The split belongs to A, split + 1 to B. A side covering a single position is a leaf; otherwise the internal node at that position owns it.
+        int32_t childPositions[2] = { split, split + 1 };
+        int32_t childLeafCounts[2] = { split - rangeStart + 1, rangeEnd - split };
+        for (int32_t childIndex = 0; childIndex < 2; ++childIndex) {
+          auto& child = (&node.A)[childIndex];
+          child.LeafCount = childLeafCounts[childIndex];
+          if (childLeafCounts[childIndex] == 1) {
+            auto leafIndex = sortedLeaves[childPositions[childIndex]];
+            child.Index = Encode(leafIndex);
+            m_Leaves[leafIndex] = Leaf(i, childIndex);
+          }
+          else {
+            child.Index = childPositions[childIndex];
+            auto& childMetanode = m_Metanodes[childPositions[childIndex]];
+            childMetanode.Parent = i;
+            childMetanode.IndexInParent = childIndex;
+          }
+        }
+        auto& metanode = m_Metanodes[i];
+        metanode.RefineFlag = 0;
+        metanode.LocalCostChange = 0;
+      }
+    });
+
+    //Bounds go bottom up. Every leaf writes its bounds into its parent and walks up; the first arrival at a node stops there,
+    //the second knows both children are done and carries the merged bounds to the next level. RefineFlag counts the arrivals and ends up back at zero.
+    forEachBlock(leafCount, [&](int32_t blockIndex, int32_t start, int32_t end) {
+      for (int32_t leafIndex = start; leafIndex < end; ++leafIndex) {
+        auto leaf = m_Leaves[leafIndex];
+        auto& leafChild = (&m_Nodes[leaf.GetNodeIndex()].A)[leaf.GetChildIndex()];
+        leafChild.Min = leafBounds[leafIndex].m_Min;
+        leafChild.Max = leafBounds[leafIndex].m_Max;
+        auto nodeIndex = leaf.GetNodeIndex();
+        while (nodeIndex >= 0) {
+          auto& metanode = m_Metanodes[nodeIndex];
+          if (Interlocked::Increment(metanode.RefineFlag) == 1)
+            break;
+          metanode.RefineFlag = 0;
+          if (metanode.Parent < 0)
+            break;
+          auto& node = m_Nodes[nodeIndex];
+          auto& childInParent = (&m_Nodes[metanode.Parent].A)[metanode.IndexInParent];
+          childInParent.Min = glm::min(node.A.Min, node.B.Min);
+          childInParent.Max = glm::max(node.A.Max, node.B.Max);
+          nodeIndex = metanode.Parent;
+        }
+      }
+    });
+
+    pool.Return(keys);
+    pool.Return(scratchKeys);
+    pool.Return(sortedLeaves);
+    pool.Return(scratchLeaves);
+  }
+}
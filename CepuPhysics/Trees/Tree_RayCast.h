@@ -0,0 +1,87 @@
+#pragma once
+#include "Tree.h"
+#include "RayData.h"
+
+namespace CepuPhysics
+{
+  //Leaf testers are invoked as leafTester.TestLeaf(int32_t leafIndex, const RayData& ray, float& maximumT).
+  //A tester that finds a hit at t can lower maximumT to t; every node and leaf farther along the ray than the new maximum is skipped from then on.
+
+  //Traversal stack size of a single RayCastFrom call. Each visited node pops one entry and pushes at most two, so this only overflows for trees deeper than this;
+  //anything that doesn't fit gets a traversal of its own.
+  constexpr const int32_t RAY_TRAVERSAL_STACK_CAPACITY = 256;
+
+  template<typename TRayLeafTester>
+  void RayCastFrom(const Tree& tree, int32_t childIndex, float childT, TreeRay& treeRay, const RayData& ray, TRayLeafTester& leafTester)
+  {
+    struct StackEntry
+    {
+      int32_t Index;
+      float T;
+    };
+    StackEntry stack[RAY_TRAVERSAL_STACK_CAPACITY];
+    int32_t stackCount = 1;
+    stack[0] = { childIndex, childT };
+    while (stackCount > 0) {
+      auto entry = stack[--stackCount];
+      //The maximum may have shrunk since this entry was pushed.
+      if (entry.T > treeRay.MaximumT)
+        continue;
+      if (entry.Index < 0) {
+        leafTester.TestLeaf(Tree::Encode(entry.Index), ray, treeRay.MaximumT);
+        continue;
+      }
+      auto& node = tree.m_Nodes[entry.Index];
+      float tA, tB;
+      auto aIntersected = treeRay.Intersects(node.A.Min, node.A.Max, tA);
+      auto bIntersected = treeRay.Intersects(node.B.Min, node.B.Max, tB);
+      //Push the farther child first so the nearer one is visited first; hits in the nearer one can then cull the farther one.
+      StackEntry children[2];
+      int32_t childCount = 0;
+      if (aIntersected && bIntersected) {
+        auto aFirst = tA <= tB;
+        children[0] = aFirst ? StackEntry{ node.B.Index, tB } : StackEntry{ node.A.Index, tA };
+        children[1] = aFirst ? StackEntry{ node.A.Index, tA } : StackEntry{ node.B.Index, tB };
+        childCount = 2;
+      }
+      else if (aIntersected) {
+        children[childCount++] = { node.A.Index, tA };
+      }
+      else if (bIntersected) {
+        children[childCount++] = { node.B.Index, tB };
+      }
+      for (int32_t i = 0; i < childCount; ++i) {
+        if (stackCount < RAY_TRAVERSAL_STACK_CAPACITY)
+          stack[stackCount++] = children[i];
+        else
+          RayCastFrom(tree, children[i].Index, children[i].T, treeRay, ray, leafTester);
+      }
+    }
+  }
+
+  //Casts a ray against every leaf bounding box in the tree, nearest first, and hands each leaf it hits to the leaf tester.
+  //io_maximumT holds the final maximum on return, so a tester that shrinks it on every hit leaves the closest hit's t there.
+  template<typename TRayLeafTester>
+  void RayCast(const Tree& tree, const glm::vec3& origin, const glm::vec3& direction, float& io_maximumT, TRayLeafTester& leafTester, int32_t id = 0)
+  {
+    if (tree.m_LeafCount == 0)
+      return;
+    TreeRay treeRay;
+    TreeRay::CreateFrom(origin, direction, io_maximumT, treeRay);
+    RayData ray;
+    ray.Origin = origin;
+    ray.Id = id;
+    ray.Direction = direction;
+    if (tree.m_LeafCount == 1) {
+      //The root's only leaf lives in child A; child B is empty.
+      float t;
+      auto& root = tree.m_Nodes[0];
+      if (treeRay.Intersects(root.A.Min, root.A.Max, t))
+        leafTester.TestLeaf(Tree::Encode(root.A.Index), ray, treeRay.MaximumT);
+    }
+    else {
+      RayCastFrom(tree, 0, -std::numeric_limits<float>::max(), treeRay, ray, leafTester);
+    }
+    io_maximumT = treeRay.MaximumT;
+  }
+}
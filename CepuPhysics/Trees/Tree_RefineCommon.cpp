@@ -2,6 +2,8 @@
 #include "Tree_RefineCommon.h"
 #include "Node.h"
 #include "Tree.h"
+#include "Memory/QuickList.h"
+#include "Memory/FrameArena.h"
 
 namespace CepuPhysics
 {
@@ -12,7 +14,7 @@ namespace CepuPhysics
       : m_Entries(entries)
     {}
 
-    void Insert(const Node& node, std::vector<int32_t>& subtrees) //@QUICKLIST (alektron)
+    void Insert(const Node& node, CepuUtil::QuickList<int32_t>& subtrees)
     {
       auto& children = node.A;
       for (int childIndex = 0; childIndex < 2; ++childIndex)
@@ -49,7 +51,7 @@ namespace CepuPhysics
         else
         {
           //Immediately add leaf nodes.
-          subtrees.push_back(child.Index); //@QUICKLIST (alektron) AddUnsafely
+          subtrees.AddUnsafely(child.Index);
         }
       }
     }
@@ -112,7 +114,7 @@ namespace CepuPhysics
       m_Entries[index] = m_Entries[m_Count];
     }
 
-    bool TryPop(const CepuUtil::Buffer<MetaNode>& metanodes, int32_t& io_remainingSubtreeSpace, std::vector<int32_t>& subtrees, int32_t& o_index, float& o_cost)
+    bool TryPop(const CepuUtil::Buffer<MetaNode>& metanodes, int32_t& io_remainingSubtreeSpace, CepuUtil::QuickList<int32_t>& subtrees, int32_t& o_index, float& o_cost)
     {
       while (m_Count > 0)
       {
@@ -141,7 +143,7 @@ namespace CepuPhysics
           //Since we won't be able to find this later, it needs to be added now.
           //We popped the previous entry off the queue, so the remainingSubtreeSpace does not change by re-adding it.
           //(remainingSubtreeSpace = maximumSubtreesCount - (priorityQueue.Count + subtrees.Count))
-          subtrees.push_back(entry.m_Index); //@QUICKLIST (alektron) AddUnsafely
+          subtrees.AddUnsafely(entry.m_Index);
         }
       }
       o_index = -1;
@@ -153,7 +155,7 @@ namespace CepuPhysics
     int32_t m_Count = 0;
   };
 
-  void Tree::CollectSubtrees(int32_t nodeIndex, int32_t maximumSubtrees, SubtreeHeapEntry* entries, std::vector<int32_t>& subtrees, std::vector<int32_t>& internalNodes, float& o_treeletCost)
+  void Tree::CollectSubtrees(int32_t nodeIndex, int32_t maximumSubtrees, SubtreeHeapEntry* entries, CepuUtil::QuickList<int32_t>& subtrees, CepuUtil::QuickList<int32_t>& internalNodes, float& o_treeletCost)
   {
     //Collect subtrees iteratively by choosing the highest cost subtree repeatedly.
     //This collects every child of a given node at once- the set of subtrees must not include only SOME of the children of a node.
@@ -176,13 +178,13 @@ namespace CepuPhysics
     //Note that the treelet root's cost is excluded from the treeletCost.
     //That's because the treelet root cannot change.
     o_treeletCost = 0;
-    int remainingSubtreeSpace = maximumSubtrees - priorityQueue.m_Count - (int32_t)subtrees.size();
+    int remainingSubtreeSpace = maximumSubtrees - priorityQueue.m_Count - subtrees.m_Count;
     int32_t highestIndex;
     float highestCost;
     while (priorityQueue.TryPop(m_Metanodes, remainingSubtreeSpace, subtrees, highestIndex, highestCost))
     {
       o_treeletCost += highestCost;
-      internalNodes.push_back(highestIndex); //@QUICKLIST (alektron) AddUnsafely
+      internalNodes.AddUnsafely(highestIndex);
 
       //Add all the children to the set of subtrees.
       //This is safe because we pre-validated the number of children in the node.
@@ -192,7 +194,7 @@ namespace CepuPhysics
 
     for (int i = 0; i < priorityQueue.m_Count; ++i)
     {
-      subtrees.push_back(priorityQueue.m_Entries[i].m_Index); //@QUICKLIST (alektron) AddUnsafely
+      subtrees.AddUnsafely(priorityQueue.m_Entries[i].m_Index);
     }
 
     //Sort the internal nodes so that the depth first builder will tend to produce less cache-scrambled results.
@@ -204,19 +206,19 @@ namespace CepuPhysics
     //The root builder would write out its nodes into a new block of memory rather than working in place.
     //If the root builder terminates with a set of subtrees of known leaf counts and known positions, then multithreaded refines will execute on contiguous regions.
     //In other words, at no point is a sort of target nodes required, because they're all computed analytically and they are known to be in cache optimal locations.
-    if (internalNodes.size() > 0) //It's possible for there to be no internal nodes if both children of the target node were leaves.
+    if (internalNodes.m_Count > 0) //It's possible for there to be no internal nodes if both children of the target node were leaves.
     {
-      std::qsort(internalNodes.data(), internalNodes.size(), sizeof(std::vector<int32_t>::value_type), [](const void *x, const void *y) {
+      std::qsort(internalNodes.m_Span.m_Memory, internalNodes.m_Count, sizeof(int32_t), [](const void *x, const void *y) {
         const int32_t a = *static_cast<const int32_t*>(x);
         const int32_t b = *static_cast<const int32_t*>(y);
         return a > b ? 1 : a < b ? -1 : 0;
-      }); //@TODO @QUICKLIST @STD @SORT (alektron)
+      }); //@TODO @STD @SORT (alektron)
     }
   }
 
   void Tree::ValidateStaging(Node* stagingNodes, int32_t stagingNodeIndex,
-    std::vector<int32_t>& subtreeNodePointers, std::vector<int32_t>& collectedSubtreeReferences,
-    std::vector<int32_t>& internalReferences, CepuUtil::BufferPool* pool, int32_t& foundSubtrees, int32_t& foundLeafCount)
+    CepuUtil::QuickList<int32_t>& subtreeNodePointers, CepuUtil::QuickList<int32_t>& collectedSubtreeReferences,
+    CepuUtil::QuickList<int32_t>& internalReferences, CepuUtil::FrameArena* arena, int32_t& foundSubtrees, int32_t& foundLeafCount)
   {
     auto stagingNode = stagingNodes + stagingNodeIndex;
     auto children = &stagingNode->A;
@@ -226,11 +228,11 @@ namespace CepuPhysics
       auto& child = children[i];
       if (child.Index >= 0)
       {
-        if (std::find(internalReferences.begin(), internalReferences.end(), child.Index) != internalReferences.end())
+        if (internalReferences.Contains(child.Index))
           throw "A child points to an internal node that was visited. Possible loop, or just general invalid.";
-        internalReferences.push_back(child.Index);
+        internalReferences.Add(child.Index, arena);
         int32_t childFoundSubtrees, childFoundLeafCount;
-        ValidateStaging(stagingNodes, child.Index, subtreeNodePointers, collectedSubtreeReferences, internalReferences, pool, childFoundSubtrees, childFoundLeafCount);
+        ValidateStaging(stagingNodes, child.Index, subtreeNodePointers, collectedSubtreeReferences, internalReferences, arena, childFoundSubtrees, childFoundLeafCount);
 
         if (childFoundLeafCount != child.LeafCount)
           throw "Bad leaf count.";
@@ -263,7 +265,7 @@ namespace CepuPhysics
           foundLeafCount += 1;
         }
         ++foundSubtrees;
-        collectedSubtreeReferences.push_back(subtreeNodePointer);
+        collectedSubtreeReferences.Add(subtreeNodePointer, arena);
       }
     }
   }
@@ -1,6 +1,8 @@
 #include "CepuPhysicsPCH.h"
 #include "Tree.h"
 #include "Memory/BufferPool.h"
+#include "Memory/QuickList.h"
+#include "Memory/FrameArena.h"
 #include "BoundingBox.h"
 #include "Tree_BinnedRefine.h"
 
@@ -32,7 +34,7 @@ namespace CepuPhysics
   }
 
 
-  float Tree::RefitAndMark(NodeChild& child, int32_t leafCountThreshold, std::vector<int32_t>& refinementCandidates, CepuUtil::BufferPool* pool) //@QUICKLIST (alektron)
+  float Tree::RefitAndMark(NodeChild& child, int32_t leafCountThreshold, QuickList<int32_t>& refinementCandidates, FrameArena* arena)
   {
     assert(leafCountThreshold > 1);
 
@@ -49,12 +51,12 @@ namespace CepuPhysics
     {
       if (a.LeafCount <= leafCountThreshold)
       {
-        refinementCandidates.push_back(a.Index);
+        refinementCandidates.Add(a.Index, arena);
         childChange += RefitAndMeasure(a);
       }
       else
       {
-        childChange += RefitAndMark(a, leafCountThreshold, refinementCandidates, pool);
+        childChange += RefitAndMark(a, leafCountThreshold, refinementCandidates, arena);
       }
     }
     auto& b = node.B;
@@ -62,12 +64,12 @@ namespace CepuPhysics
     {
       if (b.LeafCount <= leafCountThreshold)
       {
-        refinementCandidates.push_back(b.Index);
+        refinementCandidates.Add(b.Index, arena);
         childChange += RefitAndMeasure(b);
       }
       else
       {
-        childChange += RefitAndMark(b, leafCountThreshold, refinementCandidates, pool);
+        childChange += RefitAndMark(b, leafCountThreshold, refinementCandidates, arena);
       }
     }
 
@@ -79,7 +81,7 @@ namespace CepuPhysics
   }
 
 
-  float Tree::RefitAndMark(int32_t leafCountThreshold, std::vector<int32_t>& refinementCandidates, CepuUtil::BufferPool* pool) //@QUICKLIST (alektron)
+  float Tree::RefitAndMark(int32_t leafCountThreshold, QuickList<int32_t>& refinementCandidates, FrameArena* arena)
   {
     assert(m_LeafCount > 2 && "There's no reason to refit a tree with 2 or less elements. Nothing would happen");
 
@@ -94,11 +96,11 @@ namespace CepuPhysics
         if (child.LeafCount <= leafCountThreshold) {
           //The wavefront of internal nodes is defined by the transition from more than threshold to less than threshold.
           //Since we don't traverse into these children, there is no need to check the parent's leaf count.
-          refinementCandidates.push_back(child.Index); //@QUICKLIST (alektron)
+          refinementCandidates.Add(child.Index, arena);
           childChange += RefitAndMeasure(child);
         }
         else
-          childChange += RefitAndMark(child, leafCountThreshold, refinementCandidates, pool);
+          childChange += RefitAndMark(child, leafCountThreshold, refinementCandidates, arena);
       }
       BoundingBox::CreateMerged(child.Min, child.Max, merged.m_Min, merged.m_Max, merged.m_Min, merged.m_Max);
     }
@@ -157,7 +159,7 @@ namespace CepuPhysics
     return (int)glm::ceil(cacheOptimizePortion * m_NodeCount);
   }
 
-  void Tree::RefitAndRefine(BufferPool* pool, int32_t frameIndex, float refineAggressivenessScale, float cacheOptimizeAggressivenessScale)
+  void Tree::RefitAndRefine(FrameArena* arena, int32_t frameIndex, float refineAggressivenessScale, float cacheOptimizeAggressivenessScale)
   {
     //Don't proceed if the tree has no refitting refinement required. This also guarantees that any nodes that do exist have two children
     if (m_LeafCount <= 2)
@@ -165,28 +167,27 @@ namespace CepuPhysics
 
     int32_t maximumSubtrees, estimatedRefinementCandidateCount, leafCountThreshold;
     GetRefitAndMarkTuning(maximumSubtrees, estimatedRefinementCandidateCount, leafCountThreshold);
-    std::vector<int32_t> refinementCandidates; //@QUICKLIST (alektron)
-    refinementCandidates.reserve(estimatedRefinementCandidateCount);
+    //Everything taken from the arena below is released at once when we rewind to this mark.
+    auto arenaMark = arena->GetMark();
+    QuickList<int32_t> refinementCandidates(estimatedRefinementCandidateCount, arena);
 
     //Collect the refinement candidates
-    auto costChange = RefitAndMark(leafCountThreshold, refinementCandidates, pool);
+    auto costChange = RefitAndMark(leafCountThreshold, refinementCandidates, arena);
     int32_t targetRefinementCount, period, offset;
-    GetRefineTuning(frameIndex, (int32_t)refinementCandidates.size(), refineAggressivenessScale, costChange, targetRefinementCount, period, offset);
+    GetRefineTuning(frameIndex, refinementCandidates.m_Count, refineAggressivenessScale, costChange, targetRefinementCount, period, offset);
 
-    std::vector<int32_t> refinementTargets; //@QUICKLIST (alektron)
-    refinementTargets.reserve(targetRefinementCount);
+    QuickList<int32_t> refinementTargets(targetRefinementCount, arena);
     int32_t index = offset;
     for (int32_t i = 0; i < targetRefinementCount - 1; ++i) {
       index += period;
-      if (index >= (int32_t)refinementCandidates.size())
-        index -= (int32_t)refinementCandidates.size();
-      refinementTargets.push_back(refinementCandidates[index]); //@TODO (alektron) AddUnsafely
+      if (index >= refinementCandidates.m_Count)
+        index -= refinementCandidates.m_Count;
+      refinementTargets.AddUnsafely(refinementCandidates[index]);
       assert(m_Metanodes[refinementCandidates[index]].RefineFlag == 0 && "Refinement target seach shouldn't run into the same node twice");
       m_Metanodes[refinementCandidates[index]].RefineFlag = 1;
     }
-    //refinementCandidates.Dispose @TODO (alektron)
     if (m_Metanodes[0].RefineFlag == 0) {
-      refinementTargets.push_back(0); //@TODO (alektron) AddUnsafely
+      refinementTargets.AddUnsafely(0);
       m_Metanodes[0].RefineFlag = 1;
     }
 
@@ -194,21 +195,19 @@ namespace CepuPhysics
 
     //Refine all marked targets.
 
-    std::vector<int32_t> subtreeReferences   ; //@QUICKLIST (alektron)
-    std::vector<int32_t> treeletInternalNodes; //@QUICKLIST (alektron)
-    subtreeReferences   .reserve(maximumSubtrees); 
-    treeletInternalNodes.reserve(maximumSubtrees); 
+    QuickList<int32_t> subtreeReferences   (maximumSubtrees, arena);
+    QuickList<int32_t> treeletInternalNodes(maximumSubtrees, arena);
 
     BinnedResources resources;
     Buffer<uint8_t> buffer;
-    CreateBinnedResources(pool, maximumSubtrees, buffer, resources);
+    CreateBinnedResources(arena, maximumSubtrees, buffer, resources);
 
-    for (size_t i = 0; i < refinementTargets.size(); ++i)
+    for (int32_t i = 0; i < refinementTargets.m_Count; ++i)
     {
 
-      subtreeReferences.resize(0);
-      treeletInternalNodes.resize(0);
-      BinnedRefine(refinementTargets[i], subtreeReferences, maximumSubtrees, treeletInternalNodes, resources, pool);
+      subtreeReferences.Clear();
+      treeletInternalNodes.Clear();
+      BinnedRefine(refinementTargets[i], subtreeReferences, maximumSubtrees, treeletInternalNodes, resources);
       //TODO: Should this be moved into a post-loop? It could permit some double work, but that's not terrible.
       //It's not invalid from a multithreading perspective, either- setting the refine flag to zero is essentially an unlock.
       //If other threads don't see it updated due to cache issues, it doesn't really matter- it's not a signal or anything like that.
@@ -221,10 +220,8 @@ namespace CepuPhysics
       ValidateBounds(i);
     }
 
-    pool->Return(buffer);
-    //subtreeReferences.Dispose(pool);    //@TODO (alektron)
-    //treeletInternalNodes.Dispose(pool); //@TODO (alektron)
-    //refinementTargets.Dispose(pool);    //@TODO (alektron)
+    //Releases the candidates, targets, subtree lists and binned resources in one go.
+    arena->Rewind(arenaMark);
 
     auto cacheOptimizeCount = GetCacheOptimizeTuning(maximumSubtrees, costChange, cacheOptimizeAggressivenessScale);
 
@@ -234,7 +231,7 @@ namespace CepuPhysics
     auto end = glm::min(m_NodeCount, startIndex + cacheOptimizeCount);
     for (int i = startIndex; i < end; ++i)
     {
-      //IncrementalCacheOptimize(i);
+      IncrementalCacheOptimize(i);
     }
   }
 }
\ No newline at end of file
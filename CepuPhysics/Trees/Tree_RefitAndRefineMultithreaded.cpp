@@ -0,0 +1,251 @@
+#include "CepuPhysicsPCH.h"
+#include "Tree_RefitAndRefineMultithreaded.h"
+#include "Tree.h"
+#include "Tree_BinnedRefine.h"
+#include "Memory/FrameArena.h"
+#include "Threading/IThreadDispatcher.h"
+#include "Threading/Interlocked.h"
+
+#include <new>
+
+using namespace CepuUtil;
+
+namespace CepuPhysics
+{
+  void Tree::RefitAndRefine(FrameArena* arena, IThreadDispatcher* threadDispatcher, int32_t frameIndex, float refineAggressivenessScale, float cacheOptimizeAggressivenessScale)
+  {
+    RefitAndRefineMultithreadedContext context;
+    context.RefitAndRefine(*this, arena, threadDispatcher, frameIndex, refineAggressivenessScale, cacheOptimizeAggressivenessScale);
+  }
+
+  void RefitAndRefineMultithreadedContext::RefitAndRefine(Tree& tree, FrameArena* arena, IThreadDispatcher* threadDispatcher, int32_t frameIndex,
+    float refineAggressivenessScale, float cacheOptimizeAggressivenessScale)
+  {
+    if (tree.m_LeafCount <= 2)
+    {
+      //If there are 2 or less leaves, then refit/refine/cache optimize doesn't do anything at all.
+      //(The root node has no parent, so it does not have a bounding box, and the SAH won't change no matter how we swap the children of the root.)
+      //Avoiding this case also gives the other codepath a guarantee that it will be working with nodes with two children.
+      return;
+    }
+    m_Tree = &tree;
+    auto threadCount = threadDispatcher->GetThreadCount();
+    auto arenaMark = arena->GetMark();
+
+    arena->Take(threadCount, m_WorkerArenas);
+    for (int32_t i = 0; i < threadCount; ++i)
+      new (&m_WorkerArenas[i]) FrameArena(threadDispatcher->GetThreadMemoryPool(i));
+
+    //Note that we create per-thread refinement candidates. That's because candidates are found during the multithreaded refit and mark phase, and
+    //we don't want to spend the time doing sync work. The candidates are then pruned down to a single target set for the refine pass.
+    arena->Take(threadCount, m_RefinementCandidates);
+    int32_t estimatedRefinementCandidateCount;
+    tree.GetRefitAndMarkTuning(m_MaximumSubtrees, estimatedRefinementCandidateCount, m_RefinementLeafCountThreshold);
+    //Note that the number of refit nodes is not necessarily bound by MaximumSubtrees. It is just a heuristic estimate. Resizing has to be supported.
+    m_RefitNodes = QuickList<int32_t>(m_MaximumSubtrees, arena);
+    //We haven't rigorously guaranteed a refinement count maximum, so the workers may need to resize their candidate lists. That's why they live in the worker arenas.
+    for (int32_t i = 0; i < threadCount; ++i)
+      m_RefinementCandidates[i] = QuickList<int32_t>(estimatedRefinementCandidateCount, &m_WorkerArenas[i]);
+
+    auto multithreadingLeafCountThreshold = glm::max(tree.m_LeafCount / (threadCount * 2), m_RefinementLeafCountThreshold);
+    CollectNodesForMultithreadedRefit(0, multithreadingLeafCountThreshold, m_RefitNodes, m_RefinementLeafCountThreshold, m_RefinementCandidates[0], arena, &m_WorkerArenas[0]);
+
+    m_RefitNodeIndex = -1;
+    threadDispatcher->DispatchWorkers([this](int32_t workerIndex) { RefitAndMarkForWorker(workerIndex); }, m_RefitNodes.m_Count);
+
+    //Condense the set of candidates into a set of targets.
+    int32_t refinementCandidatesCount = 0;
+    for (int32_t i = 0; i < threadCount; ++i)
+      refinementCandidatesCount += m_RefinementCandidates[i].m_Count;
+    int32_t targetRefinementCount, period, offset;
+    tree.GetRefineTuning(frameIndex, refinementCandidatesCount, refineAggressivenessScale, m_RefitCostChange, targetRefinementCount, period, offset);
+    m_RefinementTargets = QuickList<int32_t>(targetRefinementCount, arena);
+
+    //Note that only a subset of all refinement *candidates* will become refinement *targets*.
+    //We start at a semirandom offset and then skip through the set to accumulate targets.
+    //The number of candidates that become targets is based on the refinement aggressiveness,
+    //tuned by both user input (the scale) and on the volume change induced by the refit.
+    int32_t currentCandidatesIndex = 0;
+    int32_t index = offset;
+    for (int32_t i = 0; i < targetRefinementCount - 1; ++i) {
+      index += period;
+      //Wrap around if the index doesn't fit.
+      while (index >= m_RefinementCandidates[currentCandidatesIndex].m_Count) {
+        index -= m_RefinementCandidates[currentCandidatesIndex].m_Count;
+        ++currentCandidatesIndex;
+        if (currentCandidatesIndex >= threadCount)
+          currentCandidatesIndex -= threadCount;
+      }
+      assert(index < m_RefinementCandidates[currentCandidatesIndex].m_Count && index >= 0);
+      auto nodeIndex = m_RefinementCandidates[currentCandidatesIndex][index];
+      assert(tree.m_Metanodes[nodeIndex].RefineFlag == 0 && "Refinement target search shouldn't run into the same node twice");
+      m_RefinementTargets.AddUnsafely(nodeIndex);
+      tree.m_Metanodes[nodeIndex].RefineFlag = 1;
+    }
+    //Note that the root node is only refined if it was not picked as a target earlier.
+    if (tree.m_Metanodes[0].RefineFlag == 0) {
+      m_RefinementTargets.AddUnsafely(0);
+      tree.m_Metanodes[0].RefineFlag = 1;
+    }
+
+    m_RefineIndex = -1;
+    threadDispatcher->DispatchWorkers([this](int32_t workerIndex) { RefineForWorker(workerIndex); }, m_RefinementTargets.m_Count);
+
+    //The refine flags of the targets mark the boundaries between treelets. Releasing them only after every worker is done keeps a worker
+    //from expanding into a treelet that another worker is still rebuilding.
+    for (int32_t i = 0; i < m_RefinementTargets.m_Count; ++i)
+      tree.m_Metanodes[m_RefinementTargets[i]].RefineFlag = 0;
+
+    for (int32_t i = 1; i < tree.m_NodeCount; i++)
+    {
+      tree.ValidateBounds(i);
+    }
+
+    //To multithread this, give each worker a contiguous chunk of nodes. You want to do the biggest chunks possible to chain decent cache behavior as far as possible.
+    //Note that more cache optimization is required with more threads, since spreading it out more slightly lessens its effectiveness.
+    auto cacheOptimizeCount = tree.GetCacheOptimizeTuning(m_MaximumSubtrees, m_RefitCostChange, glm::max(1.0f, threadCount * 0.25f) * cacheOptimizeAggressivenessScale);
+
+    auto cacheOptimizationTasks = threadCount * 2;
+    m_PerWorkerCacheOptimizeCount = cacheOptimizeCount / cacheOptimizationTasks;
+    auto startIndex = (int32_t)(((int64_t)frameIndex * m_PerWorkerCacheOptimizeCount) % tree.m_NodeCount);
+    m_CacheOptimizeStarts = QuickList<int32_t>(cacheOptimizationTasks, arena);
+    m_CacheOptimizeStarts.AddUnsafely(startIndex);
+
+    //Spread the task starts evenly over the whole node range.
+    auto optimizationSpacing = tree.m_NodeCount / cacheOptimizationTasks;
+    auto optimizationSpacingWithExtra = optimizationSpacing + 1;
+    auto optimizationRemainder = tree.m_NodeCount - optimizationSpacing * cacheOptimizationTasks;
+
+    for (int32_t i = 1; i < cacheOptimizationTasks; ++i) {
+      if (optimizationRemainder > 0) {
+        startIndex += optimizationSpacingWithExtra;
+        --optimizationRemainder;
+      }
+      else {
+        startIndex += optimizationSpacing;
+      }
+      if (startIndex >= tree.m_NodeCount)
+        startIndex -= tree.m_NodeCount;
+      assert(startIndex >= 0 && startIndex < tree.m_NodeCount);
+      m_CacheOptimizeStarts.AddUnsafely(startIndex);
+    }
+
+    m_CacheOptimizeIndex = -1;
+    threadDispatcher->DispatchWorkers([this](int32_t workerIndex) { CacheOptimizeForWorker(workerIndex); }, cacheOptimizationTasks);
+
+    for (int32_t i = 0; i < threadCount; ++i)
+      m_WorkerArenas[i].~FrameArena();
+    //Releases the worker arena storage, the per-worker candidate list headers, the refit nodes, targets and cache optimization starts.
+    arena->Rewind(arenaMark);
+    m_Tree = nullptr;
+  }
+
+  void RefitAndRefineMultithreadedContext::CollectNodesForMultithreadedRefit(int32_t nodeIndex, int32_t multithreadingLeafCountThreshold, QuickList<int32_t>& refitAndMarkTargets,
+    int32_t refinementLeafCountThreshold, QuickList<int32_t>& refinementCandidates, FrameArena* arena, FrameArena* workerArena)
+  {
+    auto& node = m_Tree->m_Nodes[nodeIndex];
+    auto& metanode = m_Tree->m_Metanodes[nodeIndex];
+    assert(metanode.RefineFlag == 0);
+    assert(m_Tree->m_LeafCount > 2);
+    for (int32_t i = 0; i < 2; ++i) {
+      auto& child = (&node.A)[i];
+      if (child.Index >= 0) {
+        //Each node stores how many children are involved in the multithreaded refit.
+        //This allows the postphase to climb the tree in a thread safe way.
+        //The RefineFlag is used to store that information. We assume that the RefineFlag is 0 at the beginning of the refit.
+        ++metanode.RefineFlag;
+        if (child.LeafCount <= multithreadingLeafCountThreshold) {
+          if (child.LeafCount <= refinementLeafCountThreshold) {
+            //It's possible that a wavefront node is this high in the tree, so it has to be captured here because the postpass won't consider it.
+            refinementCandidates.Add(child.Index, workerArena);
+          }
+          //Smaller than the multithreading threshold, so this will be a target for the multithreaded refit.
+          refitAndMarkTargets.Add(child.Index, arena);
+        }
+        else {
+          CollectNodesForMultithreadedRefit(child.Index, multithreadingLeafCountThreshold, refitAndMarkTargets, refinementLeafCountThreshold, refinementCandidates, arena, workerArena);
+        }
+      }
+    }
+  }
+
+  void RefitAndRefineMultithreadedContext::RefitAndMarkForWorker(int32_t workerIndex)
+  {
+    auto& tree = *m_Tree;
+    auto workerArena = &m_WorkerArenas[workerIndex];
+    auto& refinementCandidates = m_RefinementCandidates[workerIndex];
+    int32_t refitIndex;
+    while ((refitIndex = Interlocked::Increment(m_RefitNodeIndex)) < m_RefitNodes.m_Count) {
+      auto nodeIndex = m_RefitNodes[refitIndex];
+      auto& metanode = tree.m_Metanodes[nodeIndex];
+      assert(metanode.RefineFlag == 0 && "Refit targets sit below the collected nodes, so nothing should have touched their refine flags.");
+      assert(metanode.Parent >= 0 && "The root is never a refit target; it's always handled by the postphase.");
+      auto& childInParent = (&tree.m_Nodes[metanode.Parent].A)[metanode.IndexInParent];
+      if (childInParent.LeafCount <= m_RefinementLeafCountThreshold)
+        metanode.LocalCostChange = tree.RefitAndMeasure(childInParent);
+      else
+        metanode.LocalCostChange = tree.RefitAndMark(childInParent, m_RefinementLeafCountThreshold, refinementCandidates, workerArena);
+
+      //Walk up the tree. The RefineFlag of each collected node counts the children that haven't finished yet;
+      //whichever worker finishes the last child refits the node and keeps climbing. Everyone else stops.
+      //The decrement publishes this worker's bounds and cost change to whoever takes over.
+      auto parentIndex = metanode.Parent;
+      while (Interlocked::Decrement(tree.m_Metanodes[parentIndex].RefineFlag) == 0) {
+        auto& parentMetanode = tree.m_Metanodes[parentIndex];
+        auto& parentNode = tree.m_Nodes[parentIndex];
+        float childChange = 0;
+        if (parentNode.A.Index >= 0)
+          childChange += tree.m_Metanodes[parentNode.A.Index].LocalCostChange;
+        if (parentNode.B.Index >= 0)
+          childChange += tree.m_Metanodes[parentNode.B.Index].LocalCostChange;
+
+        if (parentIndex == 0) {
+          //Same normalization as the single threaded RefitAndMark: the root's own change isn't included, it just normalizes the children's changes.
+          BoundingBox merged;
+          BoundingBox::CreateMerged(parentNode.A.Min, parentNode.A.Max, parentNode.B.Min, parentNode.B.Max, merged.m_Min, merged.m_Max);
+          auto postmetric = Tree::ComputeBoundsMetric(merged);
+          m_RefitCostChange = postmetric >= 1e-10 ? childChange / postmetric : 0;
+          break;
+        }
+        auto& childInGrandparent = (&tree.m_Nodes[parentMetanode.Parent].A)[parentMetanode.IndexInParent];
+        auto premetric = Tree::ComputeBoundsMetric(childInGrandparent.Min, childInGrandparent.Max);
+        BoundingBox::CreateMerged(parentNode.A.Min, parentNode.A.Max, parentNode.B.Min, parentNode.B.Max, childInGrandparent.Min, childInGrandparent.Max);
+        auto postmetric = Tree::ComputeBoundsMetric(childInGrandparent.Min, childInGrandparent.Max);
+        parentMetanode.LocalCostChange = postmetric - premetric + childChange;
+        parentIndex = parentMetanode.Parent;
+      }
+    }
+  }
+
+  void RefitAndRefineMultithreadedContext::RefineForWorker(int32_t workerIndex)
+  {
+    auto workerArena = &m_WorkerArenas[workerIndex];
+    auto workerMark = workerArena->GetMark();
+    QuickList<int32_t> subtreeReferences   (m_MaximumSubtrees, workerArena);
+    QuickList<int32_t> treeletInternalNodes(m_MaximumSubtrees, workerArena);
+    BinnedResources resources;
+    Buffer<uint8_t> buffer;
+    Tree::CreateBinnedResources(workerArena, m_MaximumSubtrees, buffer, resources);
+
+    int32_t refineIndex;
+    while ((refineIndex = Interlocked::Increment(m_RefineIndex)) < m_RefinementTargets.m_Count) {
+      subtreeReferences.Clear();
+      treeletInternalNodes.Clear();
+      //Treelets never expand through another target (its RefineFlag is set), so concurrent refines work on disjoint sets of nodes.
+      m_Tree->BinnedRefine(m_RefinementTargets[refineIndex], subtreeReferences, m_MaximumSubtrees, treeletInternalNodes, resources);
+    }
+    workerArena->Rewind(workerMark);
+  }
+
+  void RefitAndRefineMultithreadedContext::CacheOptimizeForWorker(int32_t workerIndex)
+  {
+    int32_t taskIndex;
+    while ((taskIndex = Interlocked::Increment(m_CacheOptimizeIndex)) < m_CacheOptimizeStarts.m_Count) {
+      auto startIndex = m_CacheOptimizeStarts[taskIndex];
+      //We could wrap around. But we could also not do that because it doesn't really matter!
+      auto end = glm::min(m_Tree->m_NodeCount, startIndex + m_PerWorkerCacheOptimizeCount);
+      for (int32_t i = startIndex; i < end; ++i)
+        m_Tree->IncrementalCacheOptimizeThreadSafe(i);
+    }
+  }
+}
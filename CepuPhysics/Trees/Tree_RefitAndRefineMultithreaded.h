@@ -0,0 +1,47 @@
+#pragma once
+#include "Memory/QuickList.h"
+
+namespace CepuUtil
+{
+  class FrameArena;
+  class IThreadDispatcher;
+}
+
+namespace CepuPhysics
+{
+  class Tree;
+
+  //Runs the refit, refinement and cache optimization phases of Tree::RefitAndRefine across the workers of a thread dispatcher.
+  //Holds the state shared between workers for the duration of one call; it doesn't own anything between calls.
+  class RefitAndRefineMultithreadedContext
+  {
+  public:
+    void RefitAndRefine(Tree& tree, CepuUtil::FrameArena* arena, CepuUtil::IThreadDispatcher* threadDispatcher, int32_t frameIndex,
+      float refineAggressivenessScale = 1, float cacheOptimizeAggressivenessScale = 1);
+
+  private:
+    void CollectNodesForMultithreadedRefit(int32_t nodeIndex, int32_t multithreadingLeafCountThreshold, CepuUtil::QuickList<int32_t>& refitAndMarkTargets,
+      int32_t refinementLeafCountThreshold, CepuUtil::QuickList<int32_t>& refinementCandidates, CepuUtil::FrameArena* arena, CepuUtil::FrameArena* workerArena);
+    void RefitAndMarkForWorker(int32_t workerIndex);
+    void RefineForWorker(int32_t workerIndex);
+    void CacheOptimizeForWorker(int32_t workerIndex);
+
+    Tree* m_Tree = nullptr;
+    //Workers can't share the caller's arena, so each gets its own on top of its thread memory pool.
+    CepuUtil::Buffer<CepuUtil::FrameArena> m_WorkerArenas;
+
+    int32_t m_RefitNodeIndex = 0;
+    CepuUtil::QuickList<int32_t> m_RefitNodes;
+    float m_RefitCostChange = 0;
+    int32_t m_RefinementLeafCountThreshold = 0;
+    CepuUtil::Buffer<CepuUtil::QuickList<int32_t>> m_RefinementCandidates;
+
+    int32_t m_RefineIndex = 0;
+    CepuUtil::QuickList<int32_t> m_RefinementTargets;
+    int32_t m_MaximumSubtrees = 0;
+
+    int32_t m_CacheOptimizeIndex = 0;
+    CepuUtil::QuickList<int32_t> m_CacheOptimizeStarts;
+    int32_t m_PerWorkerCacheOptimizeCount = 0;
+  };
+}
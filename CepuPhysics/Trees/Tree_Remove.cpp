@@ -50,17 +50,18 @@ namespace CepuPhysics
   void Tree::RefitForRemoval(int32_t nodeIndex)
   {
     //Note that no attempt is made to refit the root node. Note that the root node is the only node that can have a number of children less than 2.
-    auto& node =  m_Nodes[nodeIndex];
-    auto& metanode =  m_Metanodes[nodeIndex];
-    while (metanode.Parent >= 0)
+    //These walk up the tree, so they have to be pointers; assigning through references would overwrite the nodes instead.
+    auto node = &m_Nodes[nodeIndex];
+    auto metanode = &m_Metanodes[nodeIndex];
+    while (metanode->Parent >= 0)
     {
       //Compute the new bounding box for this node.
-      auto& parent =  m_Nodes[metanode.Parent];
-      auto& childInParent = *(&parent.A + metanode.IndexInParent);
-      BoundingBox::CreateMerged(node.A.Min, node.A.Max, node.B.Min, node.B.Max, childInParent.Min, childInParent.Max);
+      auto& parent =  m_Nodes[metanode->Parent];
+      auto& childInParent = *(&parent.A + metanode->IndexInParent);
+      BoundingBox::CreateMerged(node->A.Min, node->A.Max, node->B.Min, node->B.Max, childInParent.Min, childInParent.Max);
       --childInParent.LeafCount;
-      node =  parent;
-      metanode =  m_Metanodes[metanode.Parent];
+      node = &parent;
+      metanode = &m_Metanodes[metanode->Parent];
     }
   }
 
@@ -182,4 +183,137 @@ namespace CepuPhysics
     }
     return leafIndex < m_LeafCount ? m_LeafCount : -1;
   }
-}
\ No newline at end of file
+
+  void Tree::RemoveRange(const CepuUtil::Buffer<int32_t>& leafIndices, CepuUtil::BufferPool& pool, CepuUtil::Buffer<int32_t>& o_leafIndexRemap)
+  {
+    auto oldLeafCount = m_LeafCount;
+    pool.Take(glm::max(oldLeafCount, 1), o_leafIndexRemap);
+    //Mark the removed leaves, then number the survivors in their existing order so the leaf array compacts without shuffling.
+    for (int32_t i = 0; i < oldLeafCount; ++i)
+      o_leafIndexRemap[i] = 0;
+    //Nothing but the remap has been touched while the indices are checked, so a bad index list leaves the tree as it was; the remap goes back to the pool
+    //instead of being handed out half written.
+    for (int32_t i = 0; i < leafIndices.GetLength(); ++i) {
+      auto leafIndex = leafIndices[i];
+      if (leafIndex < 0 || leafIndex >= oldLeafCount) {
+        pool.Return(o_leafIndexRemap);
+        throw ("Leaf index must be a valid index in the tree's leaf array.");
+      }
+      if (o_leafIndexRemap[leafIndex] != 0) {
+        pool.Return(o_leafIndexRemap);
+        throw ("Leaves can only be removed once.");
+      }
+      o_leafIndexRemap[leafIndex] = -1;
+    }
+    int32_t newLeafCount = 0;
+    for (int32_t i = 0; i < oldLeafCount; ++i) {
+      if (o_leafIndexRemap[i] == 0)
+        o_leafIndexRemap[i] = newLeafCount++;
+    }
+    if (newLeafCount == oldLeafCount)
+      return;
+    if (newLeafCount == 0) {
+      Clear();
+      return;
+    }
+
+    //Bottom-up: every child slot gets its surviving leaf count and the bounds of its survivors. A slot with no survivors ends up with a LeafCount of 0.
+    auto& root = m_Nodes[0];
+    for (int32_t childIndex = 0; childIndex < glm::min(oldLeafCount, 2); ++childIndex)
+      RefitForRangeRemoval((&root.A)[childIndex], o_leafIndexRemap);
+
+    //Top-down: emit every node that still has two surviving children into new buffers, depth first. Nodes with only one survivor are skipped,
+    //so their surviving child takes the node's slot in its parent. Leaves are rewritten as they're reached; the leaf array itself never moves.
+    Buffer<Node> newNodes;
+    Buffer<MetaNode> newMetanodes;
+    pool.Take(m_Nodes.GetLength(), newNodes);
+    pool.Take(m_Metanodes.GetLength(), newMetanodes);
+    auto& newRoot = newNodes[0];
+    auto& newRootMetanode = newMetanodes[0];
+    newRootMetanode.Parent = -1;
+    newRootMetanode.IndexInParent = -1;
+    newRootMetanode.RefineFlag = 0;
+    newRootMetanode.LocalCostChange = 0;
+    int32_t newNodeCount = 1;
+    const NodeChild* rootChildren = &root.A;
+    if (root.A.LeafCount == 0 || (oldLeafCount > 1 && root.B.LeafCount == 0)) {
+      //Only one side of the root survived. If it's a leaf, it becomes the root's only child; otherwise the first node below it with two survivors becomes the root.
+      auto& survivor = FindRangeRemovalSurvivor(root.A.LeafCount > 0 ? root.A : root.B);
+      rootChildren = survivor.Index >= 0 ? &m_Nodes[survivor.Index].A : &survivor;
+    }
+    m_LeafCount = newLeafCount;
+    for (int32_t childIndex = 0; childIndex < glm::min(newLeafCount, 2); ++childIndex)
+      CompactForRangeRemoval(rootChildren[childIndex], 0, childIndex, newNodes.m_Memory, newMetanodes.m_Memory, newNodeCount, o_leafIndexRemap);
+    if (newLeafCount == 1)
+      newRoot.B = NodeChild();
+    newMetanodes.Clear(newNodeCount, newMetanodes.GetLength() - newNodeCount);
+
+    pool.Return(m_Nodes);
+    pool.Return(m_Metanodes);
+    m_Nodes = newNodes;
+    m_Metanodes = newMetanodes;
+    m_NodeCount = newNodeCount;
+  }
+
+  void Tree::RefitForRangeRemoval(NodeChild& child, const CepuUtil::Buffer<int32_t>& leafIndexRemap)
+  {
+    if (child.Index < 0) {
+      child.LeafCount = leafIndexRemap[Encode(child.Index)] >= 0 ? 1 : 0;
+      return;
+    }
+    auto& node = m_Nodes[child.Index];
+    RefitForRangeRemoval(node.A, leafIndexRemap);
+    RefitForRangeRemoval(node.B, leafIndexRemap);
+    child.LeafCount = node.A.LeafCount + node.B.LeafCount;
+    if (node.A.LeafCount > 0 && node.B.LeafCount > 0) {
+      child.Min = glm::min(node.A.Min, node.B.Min);
+      child.Max = glm::max(node.A.Max, node.B.Max);
+    }
+    else if (child.LeafCount > 0) {
+      auto& survivor = node.A.LeafCount > 0 ? node.A : node.B;
+      child.Min = survivor.Min;
+      child.Max = survivor.Max;
+    }
+  }
+
+  const NodeChild& Tree::FindRangeRemovalSurvivor(const NodeChild& child) const
+  {
+    //Walks down through nodes that lost one side. Stops at a leaf or at a node that still has both sides.
+    assert(child.LeafCount > 0);
+    auto survivor = &child;
+    while (survivor->Index >= 0) {
+      auto& node = m_Nodes[survivor->Index];
+      if (node.A.LeafCount > 0 && node.B.LeafCount > 0)
+        break;
+      survivor = node.A.LeafCount > 0 ? &node.A : &node.B;
+    }
+    return *survivor;
+  }
+
+  void Tree::CompactForRangeRemoval(const NodeChild& child, int32_t parentIndex, int32_t indexInParent, Node* nodes, MetaNode* metanodes, int32_t& io_nodeCount,
+    const CepuUtil::Buffer<int32_t>& leafIndexRemap)
+  {
+    auto& survivor = FindRangeRemovalSurvivor(child);
+    auto& target = (&nodes[parentIndex].A)[indexInParent];
+    //The bounds of a collapsed chain are the bounds of its survivor, so the child's own bounds are already correct.
+    target.Min = child.Min;
+    target.Max = child.Max;
+    target.LeafCount = child.LeafCount;
+    if (survivor.Index < 0) {
+      auto leafIndex = leafIndexRemap[Encode(survivor.Index)];
+      target.Index = Encode(leafIndex);
+      m_Leaves[leafIndex] = Leaf(parentIndex, indexInParent);
+      return;
+    }
+    auto nodeIndex = io_nodeCount++;
+    target.Index = nodeIndex;
+    auto& metanode = metanodes[nodeIndex];
+    metanode.Parent = parentIndex;
+    metanode.IndexInParent = indexInParent;
+    metanode.RefineFlag = 0;
+    metanode.LocalCostChange = 0;
+    auto& node = m_Nodes[survivor.Index];
+    CompactForRangeRemoval(node.A, nodeIndex, 0, nodes, metanodes, io_nodeCount, leafIndexRemap);
+    CompactForRangeRemoval(node.B, nodeIndex, 1, nodes, metanodes, io_nodeCount, leafIndexRemap);
+  }
+}
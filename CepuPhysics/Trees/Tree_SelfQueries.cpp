@@ -10,7 +10,7 @@ namespace CepuPhysics
 {
   bool Intersects(const NodeChild& a, const NodeChild& b)
   {
-    return CepuUtil::BoundingBox::Intersects(a.Max, a.Max, b.Min, b.Max);
+    return CepuUtil::BoundingBox::Intersects(a.Min, a.Max, b.Min, b.Max);
   }
 
 }
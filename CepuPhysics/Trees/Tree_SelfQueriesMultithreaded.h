@@ -0,0 +1,211 @@
+#pragma once
+#include "Tree.h"
+#include "Node.h"
+#include "Tree_SelfQueries.h"
+#include "Memory/QuickList.h"
+#include "Threading/IThreadDispatcher.h"
+
+namespace CepuPhysics
+{
+  //Multithreaded variant of GetSelfOverlaps.
+  //The top of the tree is walked on the calling thread, and node pairs whose combined leaf count drops below a threshold are collected as jobs instead of being descended into.
+  //The jobs are then executed across a thread dispatcher. Every worker reports to its own handler, so results can be gathered without any locking.
+  //Usage is PrepareJobs -> PairTest on every worker (or ExecuteJob for every job index) -> CompleteSelfTest; SelfTest wraps all three.
+  template<typename TOverlapHandler>
+  class MultithreadedSelfTest
+  {
+  public:
+    //Roughly how many jobs per worker the collection aims for. More jobs balance better but spend more time in the single threaded collection phase.
+    static constexpr float JOB_MULTIPLIER = 1.5f;
+
+    //Collects the jobs for a self test. overlapHandlers must hold at least threadCount handlers; handler 0 receives any overlaps found during collection.
+    //The tree must not be modified until CompleteSelfTest is called.
+    void PrepareJobs(const Tree& tree, TOverlapHandler* overlapHandlers, int32_t threadCount, CepuUtil::BufferPool* pool)
+    {
+      //If there are less than two leaves, there can't be any overlap. Clear the jobs anyway; callers may use GetJobCount to decide how to dispatch.
+      //This provides a guarantee that there are at least 2 children in each internal node considered by CollectJobsInNode.
+      m_Jobs.m_Count = 0;
+      if (tree.m_LeafCount < 2)
+        return;
+      assert(threadCount > 0);
+      auto targetJobCount = glm::max(1.f, JOB_MULTIPLIER * threadCount);
+      m_LeafThreshold = (int32_t)(tree.m_LeafCount / targetJobCount);
+      m_Jobs = CepuUtil::QuickList<Job>((int32_t)(targetJobCount * 2), pool);
+      m_Pool = pool;
+      m_NextJobIndex = -1;
+      m_Tree = &tree;
+      m_OverlapHandlers = overlapHandlers;
+      CollectJobsInNode(0, tree.m_LeafCount, overlapHandlers[0]);
+    }
+
+    //Releases the job list. Note that a tree with 0 or 1 leaves won't have allocated any jobs.
+    void CompleteSelfTest()
+    {
+      if (m_Jobs.m_Span.IsAllocated())
+        m_Jobs.Dispose(m_Pool);
+      m_Tree = nullptr;
+      m_OverlapHandlers = nullptr;
+    }
+
+    //Executes jobs until none are left. Meant to be called from every worker of a DispatchWorkers call; jobs are claimed from a shared counter.
+    void PairTest(int32_t workerIndex)
+    {
+      int32_t jobIndex;
+      while ((jobIndex = CepuUtil::Interlocked::Increment(m_NextJobIndex)) < m_Jobs.m_Count)
+        ExecuteJob(jobIndex, workerIndex);
+    }
+
+    void ExecuteJob(int32_t jobIndex, int32_t workerIndex)
+    {
+      auto& job = m_Jobs[jobIndex];
+      auto& results = m_OverlapHandlers[workerIndex];
+      if (job.A >= 0) {
+        if (job.A == job.B) {
+          //Same node.
+          GetOverlapsInNode(*m_Tree, m_Tree->m_Nodes[job.A], results);
+        }
+        else if (job.B >= 0) {
+          //Different nodes.
+          GetOverlapsBetweenDifferentNodes(*m_Tree, m_Tree->m_Nodes[job.A], m_Tree->m_Nodes[job.B], results);
+        }
+        else {
+          //A is an internal node, B is a leaf.
+          TestLeafJob(Tree::Encode(job.B), job.A, results);
+        }
+      }
+      else {
+        //A is a leaf, B is internal.
+        //Note that two leaves never form a job. The collection handles them directly; a single test isn't worth an atomic increment.
+        TestLeafJob(Tree::Encode(job.A), job.B, results);
+      }
+    }
+
+    int32_t GetJobCount() const { return m_Jobs.m_Count; }
+
+    //Runs a full self test: collects jobs, spreads them over the dispatcher's workers, and releases the jobs.
+    //overlapHandlers must hold one handler per dispatcher thread; handler i only ever receives overlaps from worker i.
+    void SelfTest(const Tree& tree, TOverlapHandler* overlapHandlers, CepuUtil::IThreadDispatcher* threadDispatcher, CepuUtil::BufferPool* pool)
+    {
+      PrepareJobs(tree, overlapHandlers, threadDispatcher->GetThreadCount(), pool);
+      threadDispatcher->DispatchTasks(GetJobCount(), [this](int32_t jobIndex, int32_t workerIndex) { ExecuteJob(jobIndex, workerIndex); });
+      CompleteSelfTest();
+    }
+
+  private:
+    //A pair of node indices to test against each other. A == B means overlaps within a single node. An encoded (negative) index is a leaf.
+    struct Job
+    {
+      int32_t A;
+      int32_t B;
+    };
+
+    void TestLeafJob(int32_t leafIndex, int32_t nodeIndex, TOverlapHandler& results)
+    {
+      auto leaf = m_Tree->m_Leaves[leafIndex];
+      auto& childOwningLeaf = (&m_Tree->m_Nodes[leaf.GetNodeIndex()].A)[leaf.GetChildIndex()];
+      TestLeafAgainstNode(*m_Tree, leafIndex, childOwningLeaf.Min, childOwningLeaf.Max, nodeIndex, results);
+    }
+
+    void DispatchTestForLeaf(int32_t leafIndex, const NodeChild& leafChild, int32_t nodeIndex, int32_t nodeLeafCount, TOverlapHandler& results)
+    {
+      if (nodeIndex < 0) {
+        results.Handle(leafIndex, Tree::Encode(nodeIndex));
+      }
+      else {
+        if (nodeLeafCount <= m_LeafThreshold)
+          m_Jobs.Add(Job{ Tree::Encode(leafIndex), nodeIndex }, m_Pool);
+        else
+          CollectLeafAgainstNode(leafIndex, leafChild, nodeIndex, results);
+      }
+    }
+
+    void CollectLeafAgainstNode(int32_t leafIndex, const NodeChild& leafChild, int32_t nodeIndex, TOverlapHandler& results)
+    {
+      auto& node = m_Tree->m_Nodes[nodeIndex];
+      auto& a = node.A;
+      auto& b = node.B;
+      auto aIntersects = CepuUtil::BoundingBox::Intersects(leafChild.Min, leafChild.Max, a.Min, a.Max);
+      auto bIntersects = CepuUtil::BoundingBox::Intersects(leafChild.Min, leafChild.Max, b.Min, b.Max);
+      if (aIntersects)
+        DispatchTestForLeaf(leafIndex, leafChild, a.Index, a.LeafCount, results);
+      if (bIntersects)
+        DispatchTestForLeaf(leafIndex, leafChild, b.Index, b.LeafCount, results);
+    }
+
+    void DispatchTestForNodes(const NodeChild& a, const NodeChild& b, TOverlapHandler& results)
+    {
+      if (a.Index >= 0) {
+        if (b.Index >= 0) {
+          if (a.LeafCount + b.LeafCount <= m_LeafThreshold)
+            m_Jobs.Add(Job{ a.Index, b.Index }, m_Pool);
+          else
+            CollectJobsBetweenDifferentNodes(m_Tree->m_Nodes[a.Index], m_Tree->m_Nodes[b.Index], results);
+        }
+        else {
+          //leaf B versus node A.
+          CollectLeafAgainstNode(Tree::Encode(b.Index), b, a.Index, results);
+        }
+      }
+      else if (b.Index >= 0) {
+        //leaf A versus node B.
+        CollectLeafAgainstNode(Tree::Encode(a.Index), a, b.Index, results);
+      }
+      else {
+        //Two leaves.
+        results.Handle(Tree::Encode(a.Index), Tree::Encode(b.Index));
+      }
+    }
+
+    void CollectJobsBetweenDifferentNodes(const Node& a, const Node& b, TOverlapHandler& results)
+    {
+      //There are no shared children, so test them all.
+      auto& aa = a.A;
+      auto& ab = a.B;
+      auto& ba = b.A;
+      auto& bb = b.B;
+      auto aaIntersects = Intersects(aa, ba);
+      auto abIntersects = Intersects(aa, bb);
+      auto baIntersects = Intersects(ab, ba);
+      auto bbIntersects = Intersects(ab, bb);
+
+      if (aaIntersects)
+        DispatchTestForNodes(aa, ba, results);
+      if (abIntersects)
+        DispatchTestForNodes(aa, bb, results);
+      if (baIntersects)
+        DispatchTestForNodes(ab, ba, results);
+      if (bbIntersects)
+        DispatchTestForNodes(ab, bb, results);
+    }
+
+    void CollectJobsInNode(int32_t nodeIndex, int32_t leafCount, TOverlapHandler& results)
+    {
+      if (leafCount <= m_LeafThreshold) {
+        m_Jobs.Add(Job{ nodeIndex, nodeIndex }, m_Pool);
+        return;
+      }
+
+      auto& node = m_Tree->m_Nodes[nodeIndex];
+      auto& a = node.A;
+      auto& b = node.B;
+
+      bool ab = Intersects(a, b);
+
+      if (a.Index >= 0)
+        CollectJobsInNode(a.Index, a.LeafCount, results);
+      if (b.Index >= 0)
+        CollectJobsInNode(b.Index, b.LeafCount, results);
+
+      //Test all different nodes.
+      if (ab)
+        DispatchTestForNodes(a, b, results);
+    }
+
+    const Tree* m_Tree = nullptr;
+    TOverlapHandler* m_OverlapHandlers = nullptr;
+    CepuUtil::BufferPool* m_Pool = nullptr;
+    CepuUtil::QuickList<Job> m_Jobs;
+    int32_t m_NextJobIndex = -1;
+    int32_t m_LeafThreshold = 0;
+  };
+}
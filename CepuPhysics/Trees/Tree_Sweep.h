@@ -0,0 +1,123 @@
+#pragma once
+#include "Tree.h"
+#include "RayData.h"
+#include "BoundingBox.h"
+#include "Memory/BufferPool.h"
+#include "Memory/QuickList.h"
+
+namespace CepuPhysics
+{
+  //Sweep handlers are invoked as results.TestLeaf(int32_t treeIndex, int32_t leafIndex, float t, float& maximumT), in order of increasing t.
+  //t is the time at which the swept bounds first touch the leaf's bounds, clamped to 0 for leaves they already overlap at the start.
+  //A handler that finds an actual impact at time T can lower maximumT to T; since leaves arrive in order, the sweep then ends as soon as the next candidate starts later than T.
+  //Setting maximumT below 0 stops the sweep outright.
+
+  //Min-heap of pending subtrees and leaves, keyed by the time the swept bounds reach them.
+  struct SweepQueue
+  {
+    struct Entry
+    {
+      float T;
+      int32_t TreeIndex;
+      int32_t Index;
+    };
+
+    void Push(const Entry& entry, CepuUtil::BufferPool& pool)
+    {
+      auto index = m_Entries.m_Count;
+      m_Entries.Allocate(&pool);
+      while (index > 0) {
+        auto parentIndex = (index - 1) >> 1;
+        auto& parent = m_Entries[parentIndex];
+        if (parent.T <= entry.T)
+          break;
+        m_Entries[index] = parent;
+        index = parentIndex;
+      }
+      m_Entries[index] = entry;
+    }
+
+    Entry Pop()
+    {
+      auto& entries = m_Entries.m_Span;
+      auto result = entries[0];
+      auto count = --m_Entries.m_Count;
+      auto last = entries[count];
+      int32_t index = 0;
+      while (true) {
+        auto childIndex = (index << 1) + 1;
+        if (childIndex >= count)
+          break;
+        if (childIndex + 1 < count && entries[childIndex + 1].T < entries[childIndex].T)
+          ++childIndex;
+        if (last.T <= entries[childIndex].T)
+          break;
+        entries[index] = entries[childIndex];
+        index = childIndex;
+      }
+      if (count > 0)
+        entries[index] = last;
+      return result;
+    }
+
+    CepuUtil::QuickList<Entry> m_Entries;
+  };
+
+  //Sweeps bounds along velocity * t for t in [0, maximumT] through several trees at once, reporting the leaves of all of them in one order of first contact.
+  //Each node is tested by casting a ray from the center of the swept bounds against the node's bounds expanded by the swept bounds' half extents.
+  //The queue's memory is taken from the pool and returned before this returns.
+  template<typename TSweepLeafHandler>
+  void Sweep(const Tree* const* trees, int32_t treeCount, const CepuUtil::BoundingBox& bounds, const glm::vec3& velocity, float maximumT,
+    CepuUtil::BufferPool& pool, TSweepLeafHandler& results)
+  {
+    auto center = (bounds.m_Min + bounds.m_Max) * 0.5f;
+    auto halfExtents = (bounds.m_Max - bounds.m_Min) * 0.5f;
+    auto inverseVelocity = TreeRay::ComputeInverseDirection(velocity);
+    SweepQueue queue;
+    queue.m_Entries = CepuUtil::QuickList<SweepQueue::Entry>(64, &pool);
+    auto pushChild = [&](int32_t treeIndex, const NodeChild& child) {
+      float t;
+      if (TreeRay::Intersects(center, inverseVelocity, maximumT, child.Min - halfExtents, child.Max + halfExtents, t))
+        queue.Push({ glm::max(0.f, t), treeIndex, child.Index }, pool);
+    };
+    for (int32_t treeIndex = 0; treeIndex < treeCount; ++treeIndex) {
+      auto& tree = *trees[treeIndex];
+      //A tree with one leaf keeps it in the root's child A; child B is empty.
+      auto& root = tree.m_Nodes[0];
+      for (int32_t i = 0; i < glm::min(tree.m_LeafCount, 2); ++i)
+        pushChild(treeIndex, (&root.A)[i]);
+    }
+    while (queue.m_Entries.m_Count > 0) {
+      auto entry = queue.Pop();
+      //Everything left in the queue starts at least this late, so nothing else can matter once this entry is past the maximum.
+      if (entry.T > maximumT)
+        break;
+      if (entry.Index < 0) {
+        results.TestLeaf(entry.TreeIndex, Tree::Encode(entry.Index), entry.T, maximumT);
+      }
+      else {
+        auto& node = trees[entry.TreeIndex]->m_Nodes[entry.Index];
+        pushChild(entry.TreeIndex, node.A);
+        pushChild(entry.TreeIndex, node.B);
+      }
+    }
+    queue.m_Entries.Dispose(&pool);
+  }
+
+  //Drops the tree index for sweeps against a single tree.
+  template<typename TSweepLeafHandler>
+  struct SingleTreeSweepHandler
+  {
+    TSweepLeafHandler& m_Inner;
+    void TestLeaf(int32_t treeIndex, int32_t leafIndex, float t, float& maximumT) { m_Inner.TestLeaf(leafIndex, t, maximumT); }
+  };
+
+  //Single tree variant; handlers are invoked as results.TestLeaf(int32_t leafIndex, float t, float& maximumT).
+  template<typename TSweepLeafHandler>
+  void Sweep(const Tree& tree, const CepuUtil::BoundingBox& bounds, const glm::vec3& velocity, float maximumT, CepuUtil::BufferPool& pool, TSweepLeafHandler& results)
+  {
+    const Tree* trees[] = { &tree };
+    SingleTreeSweepHandler<TSweepLeafHandler> treeResults{ results };
+    Sweep(trees, 1, bounds, velocity, maximumT, pool, treeResults);
+  }
+}
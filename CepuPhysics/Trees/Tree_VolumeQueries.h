@@ -0,0 +1,169 @@
+#pragma once
+#include "Tree.h"
+#include "BoundingBox.h"
+
+namespace CepuPhysics
+{
+  //Leaf handlers for volume queries are invoked as results.Handle(int32_t leafIndex) and return whether the query should keep going.
+  //Returning false stops the traversal immediately; the query then returns false as well, so callers chaining several queries can stop too.
+
+  enum class VolumeContainment
+  {
+    DISJOINT,
+    INTERSECTS,
+    //The bounds are entirely inside the volume, so everything below them is too and needs no further tests.
+    CONTAINS
+  };
+
+  //Query volumes classify node bounds with Classify(const glm::vec3& min, const glm::vec3& max) returning a VolumeContainment.
+  //Anything implementing that can be passed to GetOverlapsWithVolume.
+  struct BoxQueryVolume
+  {
+    glm::vec3 Min;
+    glm::vec3 Max;
+
+    VolumeContainment Classify(const glm::vec3& min, const glm::vec3& max) const
+    {
+      if (!CepuUtil::BoundingBox::Intersects(Min, Max, min, max))
+        return VolumeContainment::DISJOINT;
+      if (min.x >= Min.x && min.y >= Min.y && min.z >= Min.z && max.x <= Max.x && max.y <= Max.y && max.z <= Max.z)
+        return VolumeContainment::CONTAINS;
+      return VolumeContainment::INTERSECTS;
+    }
+  };
+
+  struct SphereQueryVolume
+  {
+    glm::vec3 Center;
+    float Radius;
+
+    VolumeContainment Classify(const glm::vec3& min, const glm::vec3& max) const
+    {
+      //Closest point on the box for overlap, farthest corner for containment.
+      auto closestOffset = glm::clamp(Center, min, max) - Center;
+      auto radiusSquared = Radius * Radius;
+      if (glm::dot(closestOffset, closestOffset) > radiusSquared)
+        return VolumeContainment::DISJOINT;
+      auto farthestOffset = glm::max(glm::abs(min - Center), glm::abs(max - Center));
+      if (glm::dot(farthestOffset, farthestOffset) <= radiusSquared)
+        return VolumeContainment::CONTAINS;
+      return VolumeContainment::INTERSECTS;
+    }
+  };
+
+  //Convex volume bounded by six planes. Each plane is stored as (normal, offset) with the normal pointing into the frustum, so a point p is inside a plane when
+  //dot(normal, p) + offset >= 0. Normals don't need to be unit length.
+  //Like any plane based test, boxes near the frustum's corners that straddle two planes without touching the frustum can be reported as intersecting.
+  struct Frustum
+  {
+    glm::vec4 Planes[6];
+
+    //Extracts the planes of a view projection matrix's clip volume (OpenGL convention, -w <= z <= w, which is glm's default), in world space.
+    static void CreateFromViewProjection(const glm::mat4& viewProjection, Frustum& o_frustum)
+    {
+      glm::vec4 rows[4];
+      for (int32_t i = 0; i < 4; ++i)
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+      o_frustum.Planes[0] = rows[3] + rows[0];
+      o_frustum.Planes[1] = rows[3] - rows[0];
+      o_frustum.Planes[2] = rows[3] + rows[1];
+      o_frustum.Planes[3] = rows[3] - rows[1];
+      o_frustum.Planes[4] = rows[3] + rows[2];
+      o_frustum.Planes[5] = rows[3] - rows[2];
+    }
+
+    VolumeContainment Classify(const glm::vec3& min, const glm::vec3& max) const
+    {
+      auto result = VolumeContainment::CONTAINS;
+      for (int32_t i = 0; i < 6; ++i) {
+        auto& plane = Planes[i];
+        //The corner farthest along the normal decides whether any of the box is inside the plane, the nearest corner whether all of it is.
+        glm::vec3 farthest(plane.x >= 0 ? max.x : min.x, plane.y >= 0 ? max.y : min.y, plane.z >= 0 ? max.z : min.z);
+        if (plane.x * farthest.x + plane.y * farthest.y + plane.z * farthest.z + plane.w < 0)
+          return VolumeContainment::DISJOINT;
+        glm::vec3 nearest(plane.x >= 0 ? min.x : max.x, plane.y >= 0 ? min.y : max.y, plane.z >= 0 ? min.z : max.z);
+        if (plane.x * nearest.x + plane.y * nearest.y + plane.z * nearest.z + plane.w < 0)
+          result = VolumeContainment::INTERSECTS;
+      }
+      return result;
+    }
+  };
+
+  //Traversal stack size of a single GetOverlapsWithVolumeFrom call. Each visited node pops one entry and pushes at most two, so this only overflows for trees deeper than this;
+  //anything that doesn't fit gets a traversal of its own.
+  constexpr const int32_t VOLUME_TRAVERSAL_STACK_CAPACITY = 256;
+
+  template<typename TVolume, typename TLeafHandler>
+  bool GetOverlapsWithVolumeFrom(const Tree& tree, int32_t nodeIndex, bool contained, const TVolume& volume, TLeafHandler& results)
+  {
+    struct StackEntry
+    {
+      int32_t NodeIndex;
+      //Set once an ancestor's bounds were found entirely inside the volume; the node's children are then reported without testing.
+      bool Contained;
+    };
+    StackEntry stack[VOLUME_TRAVERSAL_STACK_CAPACITY];
+    int32_t stackCount = 1;
+    stack[0] = { nodeIndex, contained };
+    while (stackCount > 0) {
+      auto entry = stack[--stackCount];
+      auto& node = tree.m_Nodes[entry.NodeIndex];
+      //B is pushed first so A, which sits right after its parent in memory, is visited first.
+      for (int32_t i = 1; i >= 0; --i) {
+        auto& child = (&node.A)[i];
+        auto childContained = entry.Contained;
+        if (!childContained) {
+          auto containment = volume.Classify(child.Min, child.Max);
+          if (containment == VolumeContainment::DISJOINT)
+            continue;
+          childContained = containment == VolumeContainment::CONTAINS;
+        }
+        if (child.Index < 0) {
+          if (!results.Handle(Tree::Encode(child.Index)))
+            return false;
+        }
+        else if (stackCount < VOLUME_TRAVERSAL_STACK_CAPACITY) {
+          stack[stackCount++] = { child.Index, childContained };
+        }
+        else if (!GetOverlapsWithVolumeFrom(tree, child.Index, childContained, volume, results)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  //Reports every leaf whose bounds overlap the volume. Returns false if the handler stopped the query early.
+  template<typename TVolume, typename TLeafHandler>
+  bool GetOverlapsWithVolume(const Tree& tree, const TVolume& volume, TLeafHandler& results)
+  {
+    if (tree.m_LeafCount == 0)
+      return true;
+    if (tree.m_LeafCount == 1) {
+      //The root's only leaf lives in child A; child B is empty.
+      auto& root = tree.m_Nodes[0];
+      if (volume.Classify(root.A.Min, root.A.Max) == VolumeContainment::DISJOINT)
+        return true;
+      return results.Handle(Tree::Encode(root.A.Index));
+    }
+    return GetOverlapsWithVolumeFrom(tree, 0, false, volume, results);
+  }
+
+  template<typename TLeafHandler>
+  bool GetOverlaps(const Tree& tree, const CepuUtil::BoundingBox& bounds, TLeafHandler& results)
+  {
+    return GetOverlapsWithVolume(tree, BoxQueryVolume{ bounds.m_Min, bounds.m_Max }, results);
+  }
+
+  template<typename TLeafHandler>
+  bool GetOverlaps(const Tree& tree, const glm::vec3& center, float radius, TLeafHandler& results)
+  {
+    return GetOverlapsWithVolume(tree, SphereQueryVolume{ center, radius }, results);
+  }
+
+  template<typename TLeafHandler>
+  bool GetOverlaps(const Tree& tree, const Frustum& frustum, TLeafHandler& results)
+  {
+    return GetOverlapsWithVolume(tree, frustum, results);
+  }
+}
@@ -0,0 +1,459 @@
+#pragma once
+#include "Tree.h"
+#include "Tree_IntertreeQueries.h"
+#include "Tree_RayCast.h"
+#include "Memory/BufferPool.h"
+#include "Math/Vector.h"
+
+namespace CepuPhysics
+{
+  //Node of a WideTree. Child bounds are stored component-wise so one SIMD compare per bound tests every child against a query at once.
+  //Indices use the same encoding as NodeChild::Index. Slots past the node's child count are zeroed padding; ChildMask keeps them out of every test, since no choice of
+  //bounds is safe against queries with unbounded or infinite extents.
+  template<int32_t WIDTH>
+  struct alignas(WIDTH * sizeof(float)) WideNode
+  {
+    float MinX[WIDTH];
+    float MinY[WIDTH];
+    float MinZ[WIDTH];
+    float MaxX[WIDTH];
+    float MaxY[WIDTH];
+    float MaxZ[WIDTH];
+    int32_t Index[WIDTH];
+    //Bit i is set if slot i holds a child.
+    uint32_t ChildMask;
+
+    void SetChildBounds(int32_t childIndex, const glm::vec3& min, const glm::vec3& max);
+    //Merges the bounds of every occupied slot.
+    void GetBounds(glm::vec3& o_min, glm::vec3& o_max) const;
+    //Returns a bitmask with bit i set if child i overlaps the given bounds.
+    uint32_t GetOverlapMask(const glm::vec3& min, const glm::vec3& max) const;
+    //Slab tests the ray against every child, like TreeRay::Intersects. Returns a bitmask with bit i set if child i is hit no farther than the ray's maximum,
+    //and writes the parameter at which the ray enters every slot's bounds to o_t, which must hold WIDTH floats aligned like the node.
+    uint32_t GetRayHitMask(const TreeRay& ray, float* o_t) const;
+  };
+
+  template<int32_t WIDTH>
+  void WideNode<WIDTH>::SetChildBounds(int32_t childIndex, const glm::vec3& min, const glm::vec3& max)
+  {
+    MinX[childIndex] = min.x;
+    MinY[childIndex] = min.y;
+    MinZ[childIndex] = min.z;
+    MaxX[childIndex] = max.x;
+    MaxY[childIndex] = max.y;
+    MaxZ[childIndex] = max.z;
+  }
+
+  template<int32_t WIDTH>
+  void WideNode<WIDTH>::GetBounds(glm::vec3& o_min, glm::vec3& o_max) const
+  {
+    o_min = glm::vec3(std::numeric_limits<float>::max());
+    o_max = glm::vec3(std::numeric_limits<float>::lowest());
+    for (int32_t i = 0; i < WIDTH; ++i) {
+      if (ChildMask & (1u << i)) {
+        o_min = glm::min(o_min, glm::vec3(MinX[i], MinY[i], MinZ[i]));
+        o_max = glm::max(o_max, glm::vec3(MaxX[i], MaxY[i], MaxZ[i]));
+      }
+    }
+  }
+
+  template<int32_t WIDTH>
+  uint32_t WideNode<WIDTH>::GetOverlapMask(const glm::vec3& min, const glm::vec3& max) const
+  {
+    uint32_t mask = 0;
+    for (int32_t i = 0; i < WIDTH; ++i) {
+      mask |= (uint32_t)(MinX[i] <= max.x && MaxX[i] >= min.x && MinY[i] <= max.y && MaxY[i] >= min.y && MinZ[i] <= max.z && MaxZ[i] >= min.z) << i;
+    }
+    return mask & ChildMask;
+  }
+
+  template<int32_t WIDTH>
+  uint32_t WideNode<WIDTH>::GetRayHitMask(const TreeRay& ray, float* o_t) const
+  {
+    uint32_t mask = 0;
+    for (int32_t i = 0; i < WIDTH; ++i) {
+      glm::vec3 min(MinX[i], MinY[i], MinZ[i]);
+      glm::vec3 max(MaxX[i], MaxY[i], MaxZ[i]);
+      mask |= (uint32_t)ray.Intersects(min, max, o_t[i]) << i;
+    }
+    return mask & ChildMask;
+  }
+
+#if !defined(CEPU_VECTOR_SCALAR)
+  template<>
+  inline uint32_t WideNode<4>::GetOverlapMask(const glm::vec3& min, const glm::vec3& max) const
+  {
+    auto overlapsX = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(MinX), _mm_set1_ps(max.x)), _mm_cmpge_ps(_mm_load_ps(MaxX), _mm_set1_ps(min.x)));
+    auto overlapsY = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(MinY), _mm_set1_ps(max.y)), _mm_cmpge_ps(_mm_load_ps(MaxY), _mm_set1_ps(min.y)));
+    auto overlapsZ = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(MinZ), _mm_set1_ps(max.z)), _mm_cmpge_ps(_mm_load_ps(MaxZ), _mm_set1_ps(min.z)));
+    return (uint32_t)_mm_movemask_ps(_mm_and_ps(overlapsX, _mm_and_ps(overlapsY, overlapsZ))) & ChildMask;
+  }
+
+  template<>
+  inline uint32_t WideNode<4>::GetRayHitMask(const TreeRay& ray, float* o_t) const
+  {
+    auto originX = _mm_set1_ps(ray.Origin.x), originY = _mm_set1_ps(ray.Origin.y), originZ = _mm_set1_ps(ray.Origin.z);
+    auto inverseX = _mm_set1_ps(ray.InverseDirection.x), inverseY = _mm_set1_ps(ray.InverseDirection.y), inverseZ = _mm_set1_ps(ray.InverseDirection.z);
+    auto t0X = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(MinX), originX), inverseX), t1X = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(MaxX), originX), inverseX);
+    auto t0Y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(MinY), originY), inverseY), t1Y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(MaxY), originY), inverseY);
+    auto t0Z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(MinZ), originZ), inverseZ), t1Z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(MaxZ), originZ), inverseZ);
+    auto entry = _mm_max_ps(_mm_min_ps(t0X, t1X), _mm_max_ps(_mm_min_ps(t0Y, t1Y), _mm_min_ps(t0Z, t1Z)));
+    auto exit = _mm_min_ps(_mm_max_ps(t0X, t1X), _mm_min_ps(_mm_max_ps(t0Y, t1Y), _mm_max_ps(t0Z, t1Z)));
+    _mm_store_ps(o_t, entry);
+    auto hit = _mm_and_ps(_mm_cmple_ps(entry, exit), _mm_and_ps(_mm_cmpge_ps(exit, _mm_setzero_ps()), _mm_cmple_ps(entry, _mm_set1_ps(ray.MaximumT))));
+    return (uint32_t)_mm_movemask_ps(hit) & ChildMask;
+  }
+#endif
+#if defined(__AVX__)
+  template<>
+  inline uint32_t WideNode<8>::GetOverlapMask(const glm::vec3& min, const glm::vec3& max) const
+  {
+    auto overlapsX = _mm256_and_ps(_mm256_cmp_ps(_mm256_load_ps(MinX), _mm256_set1_ps(max.x), _CMP_LE_OQ), _mm256_cmp_ps(_mm256_load_ps(MaxX), _mm256_set1_ps(min.x), _CMP_GE_OQ));
+    auto overlapsY = _mm256_and_ps(_mm256_cmp_ps(_mm256_load_ps(MinY), _mm256_set1_ps(max.y), _CMP_LE_OQ), _mm256_cmp_ps(_mm256_load_ps(MaxY), _mm256_set1_ps(min.y), _CMP_GE_OQ));
+    auto overlapsZ = _mm256_and_ps(_mm256_cmp_ps(_mm256_load_ps(MinZ), _mm256_set1_ps(max.z), _CMP_LE_OQ), _mm256_cmp_ps(_mm256_load_ps(MaxZ), _mm256_set1_ps(min.z), _CMP_GE_OQ));
+    return (uint32_t)_mm256_movemask_ps(_mm256_and_ps(overlapsX, _mm256_and_ps(overlapsY, overlapsZ))) & ChildMask;
+  }
+
+  template<>
+  inline uint32_t WideNode<8>::GetRayHitMask(const TreeRay& ray, float* o_t) const
+  {
+    auto originX = _mm256_set1_ps(ray.Origin.x), originY = _mm256_set1_ps(ray.Origin.y), originZ = _mm256_set1_ps(ray.Origin.z);
+    auto inverseX = _mm256_set1_ps(ray.InverseDirection.x), inverseY = _mm256_set1_ps(ray.InverseDirection.y), inverseZ = _mm256_set1_ps(ray.InverseDirection.z);
+    auto t0X = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(MinX), originX), inverseX), t1X = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(MaxX), originX), inverseX);
+    auto t0Y = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(MinY), originY), inverseY), t1Y = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(MaxY), originY), inverseY);
+    auto t0Z = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(MinZ), originZ), inverseZ), t1Z = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(MaxZ), originZ), inverseZ);
+    auto entry = _mm256_max_ps(_mm256_min_ps(t0X, t1X), _mm256_max_ps(_mm256_min_ps(t0Y, t1Y), _mm256_min_ps(t0Z, t1Z)));
+    auto exit = _mm256_min_ps(_mm256_max_ps(t0X, t1X), _mm256_min_ps(_mm256_max_ps(t0Y, t1Y), _mm256_max_ps(t0Z, t1Z)));
+    _mm256_store_ps(o_t, entry);
+    auto hit = _mm256_and_ps(_mm256_cmp_ps(entry, exit, _CMP_LE_OQ),
+      _mm256_and_ps(_mm256_cmp_ps(exit, _mm256_setzero_ps(), _CMP_GE_OQ), _mm256_cmp_ps(entry, _mm256_set1_ps(ray.MaximumT), _CMP_LE_OQ)));
+    return (uint32_t)_mm256_movemask_ps(hit) & ChildMask;
+  }
+#endif
+
+  //Read only tree with WIDTH children per node, collapsed from a binary Tree. Halves (4 wide) or thirds (8 wide) the depth of the binary tree,
+  //and every node visit tests all of its children with a handful of SIMD instructions. Meant for large, rarely changing sets like the static tree.
+  //Bounds changes can be refit in place, but adding or removing leaves in the source tree requires building again. Leaf indices are the source tree's.
+  template<int32_t WIDTH>
+  class WideTree
+  {
+  public:
+    static_assert(WIDTH >= 2 && WIDTH <= 32 && (WIDTH & (WIDTH - 1)) == 0, "Widths are powers of 2 so nodes can be aligned to their SIMD width, and child masks are 32 bit.");
+
+    //Replaces the contents with a collapsed copy of tree. Each node greedily absorbs the children of its largest (by surface area) internal children until it's full.
+    void Build(const Tree& tree, CepuUtil::BufferPool& pool);
+    void Dispose(CepuUtil::BufferPool& pool);
+    //Recomputes every node's child bounds from the leaf bounds of tree, which must hold the same leaves as when this was built. Their order within tree
+    //doesn't matter, so the source can be refined in between.
+    void Refit(const Tree& tree);
+    //Moves a single leaf's bounds and refits its ancestors.
+    void RefitLeaf(int32_t leafIndex, const glm::vec3& min, const glm::vec3& max);
+
+    //Reports the index of every leaf overlapping the query bounds. Same handler protocol as the binary tree's volume queries (Tree_VolumeQueries.h):
+    //results.Handle(int32_t leafIndex) returns false to stop the query, which then returns false too.
+    template<typename TLeafHandler>
+    bool GetOverlaps(const glm::vec3& min, const glm::vec3& max, TLeafHandler& results) const;
+    //Reports every overlapping pair between the leaves of a binary tree and this one. Handlers receive (leaf index in treeA, leaf index in this tree).
+    template<typename TOverlapHandler>
+    void GetOverlaps(const Tree& treeA, TOverlapHandler& results) const;
+    //Counterpart of the binary tree's RayCast in Tree_RayCast.h, with the same leaf tester protocol and nearest first order.
+    template<typename TRayLeafTester>
+    void RayCast(const glm::vec3& origin, const glm::vec3& direction, float& io_maximumT, TRayLeafTester& leafTester, int32_t id = 0) const;
+
+    CepuUtil::Buffer<WideNode<WIDTH>> m_Nodes;
+    int32_t m_NodeCount = 0;
+    int32_t m_LeafCount = 0;
+    //Slot holding each leaf and the parent slot of each node, encoded as nodeIndex * WIDTH + childIndex. The root's parent slot is -1.
+    CepuUtil::Buffer<int32_t> m_LeafSlots;
+    CepuUtil::Buffer<int32_t> m_ParentSlots;
+
+  private:
+    void CollapseNode(const Tree& tree, const NodeChild* sourceChildren, int32_t sourceChildCount, int32_t targetIndex, int32_t parentSlot);
+    template<typename TLeafHandler>
+    bool GetOverlaps(int32_t nodeIndex, const glm::vec3& min, const glm::vec3& max, TLeafHandler& results) const;
+    template<typename TRayLeafTester>
+    void RayCastFrom(int32_t childIndex, float childT, TreeRay& treeRay, const RayData& ray, TRayLeafTester& leafTester) const;
+    template<typename TOverlapHandler>
+    void DispatchTestForNodes(const Tree& treeA, const NodeChild& a, int32_t nodeIndexB, const glm::vec3& minB, const glm::vec3& maxB, float metricB,
+      TOverlapHandler& results) const;
+  };
+
+  using WideTree4 = WideTree<4>;
+  using WideTree8 = WideTree<8>;
+  //Widest tree whose node tests have a SIMD implementation on the target.
+#if defined(__AVX__)
+  using NativeWideTree = WideTree8;
+#else
+  using NativeWideTree = WideTree4;
+#endif
+
+  template<int32_t WIDTH>
+  void WideTree<WIDTH>::Build(const Tree& tree, CepuUtil::BufferPool& pool)
+  {
+    //Every wide node is seeded by a distinct binary node, so the binary node count bounds the wide node count.
+    auto nodeCapacity = glm::max(1, tree.m_NodeCount);
+    if (m_Nodes.GetLength() < nodeCapacity) {
+      if (m_Nodes.IsAllocated()) {
+        pool.Return(m_Nodes);
+        pool.Return(m_ParentSlots);
+      }
+      pool.TakeAtLeast(nodeCapacity, m_Nodes);
+      pool.TakeAtLeast(nodeCapacity, m_ParentSlots);
+    }
+    auto leafCapacity = glm::max(1, tree.m_LeafCount);
+    if (m_LeafSlots.GetLength() < leafCapacity) {
+      if (m_LeafSlots.IsAllocated())
+        pool.Return(m_LeafSlots);
+      pool.TakeAtLeast(leafCapacity, m_LeafSlots);
+    }
+    m_LeafCount = tree.m_LeafCount;
+    m_NodeCount = 1;
+    CollapseNode(tree, &tree.m_Nodes[0].A, glm::min(m_LeafCount, 2), 0, -1);
+  }
+
+  template<int32_t WIDTH>
+  void WideTree<WIDTH>::CollapseNode(const Tree& tree, const NodeChild* sourceChildren, int32_t sourceChildCount, int32_t targetIndex, int32_t parentSlot)
+  {
+    NodeChild children[WIDTH];
+    int32_t childCount = sourceChildCount;
+    for (int32_t i = 0; i < sourceChildCount; ++i)
+      children[i] = sourceChildren[i];
+    //Opening the largest child first keeps the big, likely to be hit volumes from costing an extra level.
+    while (childCount < WIDTH) {
+      int32_t bestChildIndex = -1;
+      float bestMetric = -1;
+      for (int32_t i = 0; i < childCount; ++i) {
+        if (children[i].Index >= 0) {
+          auto metric = Tree::ComputeBoundsMetric(children[i].Min, children[i].Max);
+          if (metric > bestMetric) {
+            bestMetric = metric;
+            bestChildIndex = i;
+          }
+        }
+      }
+      if (bestChildIndex < 0)
+        break;
+      auto& opened = tree.m_Nodes[children[bestChildIndex].Index];
+      children[bestChildIndex] = opened.A;
+      children[childCount++] = opened.B;
+    }
+
+    m_ParentSlots[targetIndex] = parentSlot;
+    auto& node = m_Nodes[targetIndex];
+    node.ChildMask = childCount == 32 ? ~0u : (1u << childCount) - 1;
+    for (int32_t i = 0; i < WIDTH; ++i) {
+      if (i < childCount) {
+        node.MinX[i] = children[i].Min.x;
+        node.MinY[i] = children[i].Min.y;
+        node.MinZ[i] = children[i].Min.z;
+        node.MaxX[i] = children[i].Max.x;
+        node.MaxY[i] = children[i].Max.y;
+        node.MaxZ[i] = children[i].Max.z;
+        node.Index[i] = children[i].Index;
+        if (children[i].Index < 0)
+          m_LeafSlots[Tree::Encode(children[i].Index)] = targetIndex * WIDTH + i;
+      }
+      else {
+        node.MinX[i] = node.MinY[i] = node.MinZ[i] = 0;
+        node.MaxX[i] = node.MaxY[i] = node.MaxZ[i] = 0;
+        node.Index[i] = -1;
+      }
+    }
+    //Children are emitted depth first, so every subtree is contiguous in memory.
+    for (int32_t i = 0; i < childCount; ++i) {
+      if (children[i].Index >= 0) {
+        auto childTargetIndex = m_NodeCount++;
+        node.Index[i] = childTargetIndex;
+        CollapseNode(tree, &tree.m_Nodes[children[i].Index].A, 2, childTargetIndex, targetIndex * WIDTH + i);
+      }
+    }
+  }
+
+  template<int32_t WIDTH>
+  void WideTree<WIDTH>::Refit(const Tree& tree)
+  {
+    assert(tree.m_LeafCount == m_LeafCount && "The source tree must hold the leaves this tree was built from.");
+    //Children are always emitted after their parents, so walking the nodes backwards refits every child before its parent reads it.
+    for (int32_t nodeIndex = m_NodeCount - 1; nodeIndex >= 0; --nodeIndex) {
+      auto& node = m_Nodes[nodeIndex];
+      for (int32_t i = 0; i < WIDTH; ++i) {
+        if ((node.ChildMask & (1u << i)) == 0)
+          continue;
+        auto childIndex = node.Index[i];
+        if (childIndex >= 0) {
+          glm::vec3 min, max;
+          m_Nodes[childIndex].GetBounds(min, max);
+          node.SetChildBounds(i, min, max);
+        }
+        else {
+          auto leaf = tree.m_Leaves[Tree::Encode(childIndex)];
+          auto& source = (&tree.m_Nodes[leaf.GetNodeIndex()].A)[leaf.GetChildIndex()];
+          node.SetChildBounds(i, source.Min, source.Max);
+        }
+      }
+    }
+  }
+
+  template<int32_t WIDTH>
+  void WideTree<WIDTH>::RefitLeaf(int32_t leafIndex, const glm::vec3& min, const glm::vec3& max)
+  {
+    assert(leafIndex >= 0 && leafIndex < m_LeafCount);
+    auto slot = m_LeafSlots[leafIndex];
+    glm::vec3 slotMin = min, slotMax = max;
+    while (slot >= 0) {
+      auto& node = m_Nodes[slot / WIDTH];
+      node.SetChildBounds(slot % WIDTH, slotMin, slotMax);
+      node.GetBounds(slotMin, slotMax);
+      slot = m_ParentSlots[slot / WIDTH];
+    }
+  }
+
+  template<int32_t WIDTH>
+  void WideTree<WIDTH>::Dispose(CepuUtil::BufferPool& pool)
+  {
+    if (m_Nodes.IsAllocated()) {
+      pool.Return(m_Nodes);
+      pool.Return(m_ParentSlots);
+    }
+    if (m_LeafSlots.IsAllocated())
+      pool.Return(m_LeafSlots);
+    m_NodeCount = 0;
+    m_LeafCount = 0;
+  }
+
+  template<int32_t WIDTH>
+  template<typename TLeafHandler>
+  bool WideTree<WIDTH>::GetOverlaps(const glm::vec3& min, const glm::vec3& max, TLeafHandler& results) const
+  {
+    if (m_LeafCount == 0)
+      return true;
+    return GetOverlaps(0, min, max, results);
+  }
+
+  template<int32_t WIDTH>
+  template<typename TLeafHandler>
+  bool WideTree<WIDTH>::GetOverlaps(int32_t nodeIndex, const glm::vec3& min, const glm::vec3& max, TLeafHandler& results) const
+  {
+    auto& node = m_Nodes[nodeIndex];
+    auto mask = node.GetOverlapMask(min, max);
+    for (int32_t i = 0; mask != 0; ++i, mask >>= 1) {
+      if (mask & 1) {
+        auto childIndex = node.Index[i];
+        if (!(childIndex >= 0 ? GetOverlaps(childIndex, min, max, results) : results.Handle(Tree::Encode(childIndex))))
+          return false;
+      }
+    }
+    return true;
+  }
+
+  template<int32_t WIDTH>
+  template<typename TRayLeafTester>
+  void WideTree<WIDTH>::RayCastFrom(int32_t childIndex, float childT, TreeRay& treeRay, const RayData& ray, TRayLeafTester& leafTester) const
+  {
+    struct StackEntry
+    {
+      int32_t Index;
+      float T;
+    };
+    StackEntry stack[RAY_TRAVERSAL_STACK_CAPACITY];
+    int32_t stackCount = 1;
+    stack[0] = { childIndex, childT };
+    while (stackCount > 0) {
+      auto entry = stack[--stackCount];
+      if (entry.T > treeRay.MaximumT)
+        continue;
+      if (entry.Index < 0) {
+        leafTester.TestLeaf(Tree::Encode(entry.Index), ray, treeRay.MaximumT);
+        continue;
+      }
+      auto& node = m_Nodes[entry.Index];
+      alignas(WIDTH * sizeof(float)) float t[WIDTH];
+      auto mask = node.GetRayHitMask(treeRay, t);
+      //Insertion sorted by descending t, so pushing in order leaves the nearest child on top of the stack.
+      StackEntry children[WIDTH];
+      int32_t childCount = 0;
+      for (int32_t i = 0; mask != 0; ++i, mask >>= 1) {
+        if (mask & 1) {
+          auto j = childCount++;
+          for (; j > 0 && children[j - 1].T < t[i]; --j)
+            children[j] = children[j - 1];
+          children[j] = { node.Index[i], t[i] };
+        }
+      }
+      for (int32_t i = 0; i < childCount; ++i) {
+        if (stackCount < RAY_TRAVERSAL_STACK_CAPACITY)
+          stack[stackCount++] = children[i];
+        else
+          RayCastFrom(children[i].Index, children[i].T, treeRay, ray, leafTester);
+      }
+    }
+  }
+
+  template<int32_t WIDTH>
+  template<typename TRayLeafTester>
+  void WideTree<WIDTH>::RayCast(const glm::vec3& origin, const glm::vec3& direction, float& io_maximumT, TRayLeafTester& leafTester, int32_t id) const
+  {
+    if (m_LeafCount == 0)
+      return;
+    TreeRay treeRay;
+    TreeRay::CreateFrom(origin, direction, io_maximumT, treeRay);
+    RayData ray;
+    ray.Origin = origin;
+    ray.Id = id;
+    ray.Direction = direction;
+    //Nothing stores the root's own bounds, so the traversal starts by testing its children.
+    RayCastFrom(0, -std::numeric_limits<float>::max(), treeRay, ray, leafTester);
+    io_maximumT = treeRay.MaximumT;
+  }
+
+  template<int32_t WIDTH>
+  template<typename TOverlapHandler>
+  void WideTree<WIDTH>::DispatchTestForNodes(const Tree& treeA, const NodeChild& a, int32_t nodeIndexB, const glm::vec3& minB, const glm::vec3& maxB,
+    float metricB, TOverlapHandler& results) const
+  {
+    //a is known to overlap the bounds of wide node nodeIndexB. Whichever side is larger gets split, so neither side ends up testing a tiny volume
+    //against a huge one level after level.
+    if (a.Index >= 0 && Tree::ComputeBoundsMetric(a.Min, a.Max) > metricB) {
+      auto& nodeA = treeA.m_Nodes[a.Index];
+      for (int32_t i = 0; i < 2; ++i) {
+        auto& childA = (&nodeA.A)[i];
+        if (CepuUtil::BoundingBox::Intersects(childA.Min, childA.Max, minB, maxB))
+          DispatchTestForNodes(treeA, childA, nodeIndexB, minB, maxB, metricB, results);
+      }
+      return;
+    }
+    auto& nodeB = m_Nodes[nodeIndexB];
+    auto mask = nodeB.GetOverlapMask(a.Min, a.Max);
+    for (int32_t j = 0; mask != 0; ++j, mask >>= 1) {
+      if ((mask & 1) == 0)
+        continue;
+      glm::vec3 childMinB(nodeB.MinX[j], nodeB.MinY[j], nodeB.MinZ[j]);
+      glm::vec3 childMaxB(nodeB.MaxX[j], nodeB.MaxY[j], nodeB.MaxZ[j]);
+      auto childIndexB = nodeB.Index[j];
+      if (childIndexB >= 0) {
+        DispatchTestForNodes(treeA, a, childIndexB, childMinB, childMaxB, Tree::ComputeBoundsMetric(childMinB, childMaxB), results);
+      }
+      else if (a.Index >= 0) {
+        //Leaf B versus node A. The leaf belongs to this tree, so the reported pairs have to be flipped back into (A, B) order.
+        FlippedOverlapHandler<TOverlapHandler> flippedResults{ results };
+        TestLeafAgainstNode(treeA, Tree::Encode(childIndexB), childMinB, childMaxB, a.Index, flippedResults);
+      }
+      else {
+        results.Handle(Tree::Encode(a.Index), Tree::Encode(childIndexB));
+      }
+    }
+  }
+
+  template<int32_t WIDTH>
+  template<typename TOverlapHandler>
+  void WideTree<WIDTH>::GetOverlaps(const Tree& treeA, TOverlapHandler& results) const
+  {
+    if (treeA.m_LeafCount == 0 || m_LeafCount == 0)
+      return;
+    //Nothing stores the wide root's bounds. Treating them as unbounded makes the first step test treeA's root children against the wide root's children.
+    glm::vec3 rootMin(std::numeric_limits<float>::lowest()), rootMax(std::numeric_limits<float>::max());
+    auto& rootA = treeA.m_Nodes[0];
+    for (int32_t i = 0; i < glm::min(treeA.m_LeafCount, 2); ++i)
+      DispatchTestForNodes(treeA, (&rootA.A)[i], 0, rootMin, rootMax, std::numeric_limits<float>::infinity(), results);
+  }
+}
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <stdint.h>
 
 #include "glm/glm.hpp"
 
@@ -0,0 +1,45 @@
+#pragma once
+#include "Vector3Wide.h"
+#include "QuaternionWide.h"
+
+namespace CepuUtil
+{
+  //Vector.COUNT 3x3 matrices. Like glm::mat3, m_X, m_Y and m_Z are the images of the x, y and z axes.
+  struct Matrix3x3Wide
+  {
+    //Same as glm::mat3(quaternion), lane by lane. The quaternions are assumed to be normalized.
+    static void CreateFromQuaternion(const QuaternionWide& q, Matrix3x3Wide& o_result)
+    {
+      auto qX2 = q.m_X + q.m_X;
+      auto qY2 = q.m_Y + q.m_Y;
+      auto qZ2 = q.m_Z + q.m_Z;
+
+      auto XX = qX2 * q.m_X;
+      auto YY = qY2 * q.m_Y;
+      auto ZZ = qZ2 * q.m_Z;
+      auto XY = qX2 * q.m_Y;
+      auto XZ = qX2 * q.m_Z;
+      auto XW = qX2 * q.m_W;
+      auto YZ = qY2 * q.m_Z;
+      auto YW = qY2 * q.m_W;
+      auto ZW = qZ2 * q.m_W;
+
+      Vector one(1.f);
+      o_result.m_X = Vector3Wide(one - YY - ZZ, XY + ZW, XZ - YW);
+      o_result.m_Y = Vector3Wide(XY - ZW, one - XX - ZZ, YZ + XW);
+      o_result.m_Z = Vector3Wide(XZ + YW, YZ - XW, one - XX - YY);
+    }
+
+    //Same as m * v.
+    static Vector3Wide Transform(const Vector3Wide& v, const Matrix3x3Wide& m) { return m.m_X * v.m_X + m.m_Y * v.m_Y + m.m_Z * v.m_Z; }
+    //Same as transpose(m) * v. For rotation matrices, that's the inverse rotation.
+    static Vector3Wide TransformByTransposed(const Vector3Wide& v, const Matrix3x3Wide& m)
+    {
+      return Vector3Wide(Vector3Wide::Dot(v, m.m_X), Vector3Wide::Dot(v, m.m_Y), Vector3Wide::Dot(v, m.m_Z));
+    }
+
+    Vector3Wide m_X;
+    Vector3Wide m_Y;
+    Vector3Wide m_Z;
+  };
+}
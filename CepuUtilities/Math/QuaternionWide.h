@@ -0,0 +1,34 @@
+#pragma once
+#include "Vector.h"
+
+namespace CepuUtil
+{
+  //Vector.COUNT quaternions stored component-wise.
+  struct QuaternionWide
+  {
+    static QuaternionWide Broadcast(const glm::quat& source)
+    {
+      QuaternionWide result;
+      result.m_X = Vector(source.x);
+      result.m_Y = Vector(source.y);
+      result.m_Z = Vector(source.z);
+      result.m_W = Vector(source.w);
+      return result;
+    }
+
+    void WriteSlot(int32_t slotIndex, const glm::quat& source)
+    {
+      m_X[slotIndex] = source.x;
+      m_Y[slotIndex] = source.y;
+      m_Z[slotIndex] = source.z;
+      m_W[slotIndex] = source.w;
+    }
+
+    glm::quat ReadSlot(int32_t slotIndex) const { return glm::quat(m_W[slotIndex], m_X[slotIndex], m_Y[slotIndex], m_Z[slotIndex]); }
+
+    Vector m_X;
+    Vector m_Y;
+    Vector m_Z;
+    Vector m_W = Vector(1.f);
+  };
+}
@@ -0,0 +1,165 @@
+#pragma once
+#if defined(__AVX512F__) || defined(__AVX__) || defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <immintrin.h>
+#endif
+
+namespace CepuUtil
+{
+  //Stand in for the Vector<float> the original C# relies on: a bundle of floats as wide as the widest float SIMD register the build targets.
+  //AVX-512 builds get 16 lanes, AVX/AVX2 builds 8 and SSE builds 4. Anything else falls back to a plain 4 lane array the compiler may or may not vectorize.
+  //Wide types (Vector3Wide, QuaternionWide, shape Wide types) are built out of these, one lane per instance (AoSoA layout).
+  struct Vector
+  {
+#if defined(__AVX512F__)
+    using Native = __m512;
+    static const int32_t COUNT = 16;
+#elif defined(__AVX__)
+    using Native = __m256;
+    static const int32_t COUNT = 8;
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    using Native = __m128;
+    static const int32_t COUNT = 4;
+#else
+#define CEPU_VECTOR_SCALAR
+    struct Native { float m_Lanes[4]; };
+    static const int32_t COUNT = 4;
+#endif
+
+    //Lanes are zeroed so unused slots in partially filled bundles never hold garbage.
+    Vector() : Vector(0.f) {}
+    Vector(Native v) : m_V(v) {}
+    explicit Vector(float scalar)
+    {
+#if defined(__AVX512F__)
+      m_V = _mm512_set1_ps(scalar);
+#elif defined(__AVX__)
+      m_V = _mm256_set1_ps(scalar);
+#elif defined(CEPU_VECTOR_SCALAR)
+      for (int32_t i = 0; i < COUNT; ++i)
+        m_V.m_Lanes[i] = scalar;
+#else
+      m_V = _mm_set1_ps(scalar);
+#endif
+    }
+
+    //Direct lane access for gathering into and scattering out of bundles. Not something to do in a hot inner loop.
+    float& operator[](int32_t index)       { assert(index >= 0 && index < COUNT); return reinterpret_cast<float*>(&m_V)[index]; }
+    float  operator[](int32_t index) const { assert(index >= 0 && index < COUNT); return reinterpret_cast<const float*>(&m_V)[index]; }
+
+    Native m_V;
+  };
+
+#if defined(CEPU_VECTOR_SCALAR)
+#define CEPU_VECTOR_LANEWISE(expression) Vector result; for (int32_t i = 0; i < Vector::COUNT; ++i) result[i] = expression; return result;
+  inline Vector operator+(const Vector& a, const Vector& b) { CEPU_VECTOR_LANEWISE(a[i] + b[i]) }
+  inline Vector operator-(const Vector& a, const Vector& b) { CEPU_VECTOR_LANEWISE(a[i] - b[i]) }
+  inline Vector operator*(const Vector& a, const Vector& b) { CEPU_VECTOR_LANEWISE(a[i] * b[i]) }
+  inline Vector operator/(const Vector& a, const Vector& b) { CEPU_VECTOR_LANEWISE(a[i] / b[i]) }
+  inline Vector operator-(const Vector& a)                  { CEPU_VECTOR_LANEWISE(-a[i]) }
+  inline Vector Min (const Vector& a, const Vector& b)      { CEPU_VECTOR_LANEWISE(a[i] < b[i] ? a[i] : b[i]) }
+  inline Vector Max (const Vector& a, const Vector& b)      { CEPU_VECTOR_LANEWISE(a[i] > b[i] ? a[i] : b[i]) }
+  inline Vector Abs (const Vector& a)                       { CEPU_VECTOR_LANEWISE(a[i] < 0 ? -a[i] : a[i]) }
+  inline Vector Sqrt(const Vector& a)                       { CEPU_VECTOR_LANEWISE(std::sqrt(a[i])) }
+  //Bit i of the result is set if lane i of a is less than or equal to lane i of b. NaN lanes compare false.
+  inline int32_t LessThanOrEqualMask(const Vector& a, const Vector& b)
+  {
+    int32_t mask = 0;
+    for (int32_t i = 0; i < Vector::COUNT; ++i)
+      mask |= (a[i] <= b[i] ? 1 : 0) << i;
+    return mask;
+  }
+  //Lane masks hold all bits set where a comparison holds and zero elsewhere. The scalar fallback shuffles the bits through integers.
+#define CEPU_VECTOR_MASK_LANEWISE(expression) Vector result; for (int32_t i = 0; i < Vector::COUNT; ++i) { uint32_t bits = (expression); memcpy(&result[i], &bits, sizeof(bits)); } return result;
+  inline uint32_t GetLaneBits(const Vector& v, int32_t i) { uint32_t bits; memcpy(&bits, &v.m_V.m_Lanes[i], sizeof(bits)); return bits; }
+  inline Vector LessThan          (const Vector& a, const Vector& b) { CEPU_VECTOR_MASK_LANEWISE(a[i] <  b[i] ? ~0u : 0u) }
+  inline Vector LessThanOrEqual   (const Vector& a, const Vector& b) { CEPU_VECTOR_MASK_LANEWISE(a[i] <= b[i] ? ~0u : 0u) }
+  inline Vector GreaterThan       (const Vector& a, const Vector& b) { CEPU_VECTOR_MASK_LANEWISE(a[i] >  b[i] ? ~0u : 0u) }
+  inline Vector GreaterThanOrEqual(const Vector& a, const Vector& b) { CEPU_VECTOR_MASK_LANEWISE(a[i] >= b[i] ? ~0u : 0u) }
+  inline Vector BitwiseAnd(const Vector& a, const Vector& b) { CEPU_VECTOR_MASK_LANEWISE(GetLaneBits(a, i) & GetLaneBits(b, i)) }
+  inline Vector BitwiseOr (const Vector& a, const Vector& b) { CEPU_VECTOR_MASK_LANEWISE(GetLaneBits(a, i) | GetLaneBits(b, i)) }
+  inline Vector AndNot    (const Vector& a, const Vector& b) { CEPU_VECTOR_MASK_LANEWISE(GetLaneBits(a, i) & ~GetLaneBits(b, i)) }
+  inline Vector ConditionalSelect(const Vector& mask, const Vector& ifTrue, const Vector& ifFalse) { CEPU_VECTOR_LANEWISE(GetLaneBits(mask, i) != 0 ? ifTrue[i] : ifFalse[i]) }
+  inline int32_t GetMask(const Vector& mask)
+  {
+    int32_t result = 0;
+    for (int32_t i = 0; i < Vector::COUNT; ++i)
+      result |= (GetLaneBits(mask, i) != 0 ? 1 : 0) << i;
+    return result;
+  }
+#undef CEPU_VECTOR_MASK_LANEWISE
+#undef CEPU_VECTOR_LANEWISE
+#else
+#if defined(__AVX512F__)
+#define CEPU_VECTOR_OP(name) _mm512_##name##_ps
+#elif defined(__AVX__)
+#define CEPU_VECTOR_OP(name) _mm256_##name##_ps
+#else
+#define CEPU_VECTOR_OP(name) _mm_##name##_ps
+#endif
+  inline Vector operator+(const Vector& a, const Vector& b) { return CEPU_VECTOR_OP(add)(a.m_V, b.m_V); }
+  inline Vector operator-(const Vector& a, const Vector& b) { return CEPU_VECTOR_OP(sub)(a.m_V, b.m_V); }
+  inline Vector operator*(const Vector& a, const Vector& b) { return CEPU_VECTOR_OP(mul)(a.m_V, b.m_V); }
+  inline Vector operator/(const Vector& a, const Vector& b) { return CEPU_VECTOR_OP(div)(a.m_V, b.m_V); }
+  inline Vector operator-(const Vector& a)                  { return Vector(0.f) - a; }
+  inline Vector Min (const Vector& a, const Vector& b)      { return CEPU_VECTOR_OP(min)(a.m_V, b.m_V); }
+  inline Vector Max (const Vector& a, const Vector& b)      { return CEPU_VECTOR_OP(max)(a.m_V, b.m_V); }
+  //AVX-512F has no float andnot (that's AVX-512DQ), but it does have abs. Narrower widths clear the sign bit by hand.
+#if defined(__AVX512F__)
+  inline Vector Abs (const Vector& a)                       { return _mm512_abs_ps(a.m_V); }
+#else
+  inline Vector Abs (const Vector& a)                       { return CEPU_VECTOR_OP(andnot)(Vector(-0.f).m_V, a.m_V); }
+#endif
+  inline Vector Sqrt(const Vector& a)                       { return CEPU_VECTOR_OP(sqrt)(a.m_V); }
+  //Bit i of the result is set if lane i of a is less than or equal to lane i of b. NaN lanes compare false.
+#if defined(__AVX512F__)
+  inline int32_t LessThanOrEqualMask(const Vector& a, const Vector& b) { return (int32_t)_mm512_cmp_ps_mask(a.m_V, b.m_V, _CMP_LE_OQ); }
+#elif defined(__AVX__)
+  inline int32_t LessThanOrEqualMask(const Vector& a, const Vector& b) { return _mm256_movemask_ps(_mm256_cmp_ps(a.m_V, b.m_V, _CMP_LE_OQ)); }
+#else
+  inline int32_t LessThanOrEqualMask(const Vector& a, const Vector& b) { return _mm_movemask_ps(_mm_cmple_ps(a.m_V, b.m_V)); }
+#endif
+
+  //Lane masks hold all bits set where a comparison holds and zero elsewhere. They combine with BitwiseAnd/BitwiseOr/AndNot and drive ConditionalSelect.
+  //NaN lanes compare false.
+#if defined(__AVX512F__)
+  //AVX-512 comparisons produce mask registers; they're expanded into lanes so masks look the same at every width. The float logic ops are AVX-512DQ, so go through integers.
+  inline Vector ExpandMask(__mmask16 mask) { return _mm512_castsi512_ps(_mm512_maskz_set1_epi32(mask, -1)); }
+  inline __mmask16 CompressMask(const Vector& mask) { auto bits = _mm512_castps_si512(mask.m_V); return _mm512_test_epi32_mask(bits, bits); }
+  inline Vector LessThan          (const Vector& a, const Vector& b) { return ExpandMask(_mm512_cmp_ps_mask(a.m_V, b.m_V, _CMP_LT_OQ)); }
+  inline Vector LessThanOrEqual   (const Vector& a, const Vector& b) { return ExpandMask(_mm512_cmp_ps_mask(a.m_V, b.m_V, _CMP_LE_OQ)); }
+  inline Vector GreaterThan       (const Vector& a, const Vector& b) { return ExpandMask(_mm512_cmp_ps_mask(a.m_V, b.m_V, _CMP_GT_OQ)); }
+  inline Vector GreaterThanOrEqual(const Vector& a, const Vector& b) { return ExpandMask(_mm512_cmp_ps_mask(a.m_V, b.m_V, _CMP_GE_OQ)); }
+  inline Vector BitwiseAnd(const Vector& a, const Vector& b) { return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a.m_V), _mm512_castps_si512(b.m_V))); }
+  inline Vector BitwiseOr (const Vector& a, const Vector& b) { return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(a.m_V), _mm512_castps_si512(b.m_V))); }
+  inline Vector AndNot    (const Vector& a, const Vector& b) { return _mm512_castsi512_ps(_mm512_andnot_si512(_mm512_castps_si512(b.m_V), _mm512_castps_si512(a.m_V))); }
+  inline Vector ConditionalSelect(const Vector& mask, const Vector& ifTrue, const Vector& ifFalse) { return _mm512_mask_blend_ps(CompressMask(mask), ifFalse.m_V, ifTrue.m_V); }
+  inline int32_t GetMask(const Vector& mask) { return (int32_t)CompressMask(mask); }
+#elif defined(__AVX__)
+  inline Vector LessThan          (const Vector& a, const Vector& b) { return _mm256_cmp_ps(a.m_V, b.m_V, _CMP_LT_OQ); }
+  inline Vector LessThanOrEqual   (const Vector& a, const Vector& b) { return _mm256_cmp_ps(a.m_V, b.m_V, _CMP_LE_OQ); }
+  inline Vector GreaterThan       (const Vector& a, const Vector& b) { return _mm256_cmp_ps(a.m_V, b.m_V, _CMP_GT_OQ); }
+  inline Vector GreaterThanOrEqual(const Vector& a, const Vector& b) { return _mm256_cmp_ps(a.m_V, b.m_V, _CMP_GE_OQ); }
+  inline Vector BitwiseAnd(const Vector& a, const Vector& b) { return _mm256_and_ps(a.m_V, b.m_V); }
+  inline Vector BitwiseOr (const Vector& a, const Vector& b) { return _mm256_or_ps(a.m_V, b.m_V); }
+  inline Vector AndNot    (const Vector& a, const Vector& b) { return _mm256_andnot_ps(b.m_V, a.m_V); }
+  inline Vector ConditionalSelect(const Vector& mask, const Vector& ifTrue, const Vector& ifFalse) { return _mm256_blendv_ps(ifFalse.m_V, ifTrue.m_V, mask.m_V); }
+  inline int32_t GetMask(const Vector& mask) { return _mm256_movemask_ps(mask.m_V); }
+#else
+  inline Vector LessThan          (const Vector& a, const Vector& b) { return _mm_cmplt_ps(a.m_V, b.m_V); }
+  inline Vector LessThanOrEqual   (const Vector& a, const Vector& b) { return _mm_cmple_ps(a.m_V, b.m_V); }
+  inline Vector GreaterThan       (const Vector& a, const Vector& b) { return _mm_cmpgt_ps(a.m_V, b.m_V); }
+  inline Vector GreaterThanOrEqual(const Vector& a, const Vector& b) { return _mm_cmpge_ps(a.m_V, b.m_V); }
+  inline Vector BitwiseAnd(const Vector& a, const Vector& b) { return _mm_and_ps(a.m_V, b.m_V); }
+  inline Vector BitwiseOr (const Vector& a, const Vector& b) { return _mm_or_ps(a.m_V, b.m_V); }
+  inline Vector AndNot    (const Vector& a, const Vector& b) { return _mm_andnot_ps(b.m_V, a.m_V); }
+  //Blends are SSE4.1; plain SSE builds have to do it with logic ops.
+  inline Vector ConditionalSelect(const Vector& mask, const Vector& ifTrue, const Vector& ifFalse) { return _mm_or_ps(_mm_and_ps(mask.m_V, ifTrue.m_V), _mm_andnot_ps(mask.m_V, ifFalse.m_V)); }
+  inline int32_t GetMask(const Vector& mask) { return _mm_movemask_ps(mask.m_V); }
+#endif
+#undef CEPU_VECTOR_OP
+#endif
+
+  inline Vector& operator+=(Vector& a, const Vector& b) { return a = a + b; }
+  inline Vector& operator-=(Vector& a, const Vector& b) { return a = a - b; }
+  inline Vector& operator*=(Vector& a, const Vector& b) { return a = a * b; }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "Vector.h"
+
+namespace CepuUtil
+{
+  //Vector.COUNT 3d vectors stored component-wise.
+  struct Vector3Wide
+  {
+    Vector3Wide() = default;
+    explicit Vector3Wide(const Vector& s) : m_X(s), m_Y(s), m_Z(s) {}
+    Vector3Wide(const Vector& x, const Vector& y, const Vector& z) : m_X(x), m_Y(y), m_Z(z) {}
+
+    //Fills every lane with the same vector.
+    static Vector3Wide Broadcast(const glm::vec3& source) { return Vector3Wide(Vector(source.x), Vector(source.y), Vector(source.z)); }
+
+    void WriteSlot(int32_t slotIndex, const glm::vec3& source)
+    {
+      m_X[slotIndex] = source.x;
+      m_Y[slotIndex] = source.y;
+      m_Z[slotIndex] = source.z;
+    }
+
+    glm::vec3 ReadSlot(int32_t slotIndex) const { return glm::vec3(m_X[slotIndex], m_Y[slotIndex], m_Z[slotIndex]); }
+
+    static Vector Dot(const Vector3Wide& a, const Vector3Wide& b) { return a.m_X * b.m_X + a.m_Y * b.m_Y + a.m_Z * b.m_Z; }
+    static Vector Length(const Vector3Wide& v) { return Sqrt(Dot(v, v)); }
+    static Vector3Wide Min(const Vector3Wide& a, const Vector3Wide& b) { return Vector3Wide(CepuUtil::Min(a.m_X, b.m_X), CepuUtil::Min(a.m_Y, b.m_Y), CepuUtil::Min(a.m_Z, b.m_Z)); }
+    static Vector3Wide Max(const Vector3Wide& a, const Vector3Wide& b) { return Vector3Wide(CepuUtil::Max(a.m_X, b.m_X), CepuUtil::Max(a.m_Y, b.m_Y), CepuUtil::Max(a.m_Z, b.m_Z)); }
+    static Vector3Wide Abs(const Vector3Wide& v) { return Vector3Wide(CepuUtil::Abs(v.m_X), CepuUtil::Abs(v.m_Y), CepuUtil::Abs(v.m_Z)); }
+    static Vector3Wide Cross(const Vector3Wide& a, const Vector3Wide& b)
+    {
+      return Vector3Wide(a.m_Y * b.m_Z - a.m_Z * b.m_Y, a.m_Z * b.m_X - a.m_X * b.m_Z, a.m_X * b.m_Y - a.m_Y * b.m_X);
+    }
+    //Picks ifTrue in lanes where the mask is set and ifFalse elsewhere.
+    static Vector3Wide ConditionalSelect(const Vector& mask, const Vector3Wide& ifTrue, const Vector3Wide& ifFalse)
+    {
+      return Vector3Wide(CepuUtil::ConditionalSelect(mask, ifTrue.m_X, ifFalse.m_X), CepuUtil::ConditionalSelect(mask, ifTrue.m_Y, ifFalse.m_Y),
+        CepuUtil::ConditionalSelect(mask, ifTrue.m_Z, ifFalse.m_Z));
+    }
+
+    Vector m_X;
+    Vector m_Y;
+    Vector m_Z;
+  };
+
+  inline Vector3Wide operator+(const Vector3Wide& a, const Vector3Wide& b) { return Vector3Wide(a.m_X + b.m_X, a.m_Y + b.m_Y, a.m_Z + b.m_Z); }
+  inline Vector3Wide operator-(const Vector3Wide& a, const Vector3Wide& b) { return Vector3Wide(a.m_X - b.m_X, a.m_Y - b.m_Y, a.m_Z - b.m_Z); }
+  inline Vector3Wide operator-(const Vector3Wide& v) { return Vector3Wide(-v.m_X, -v.m_Y, -v.m_Z); }
+  inline Vector3Wide operator*(const Vector3Wide& v, const Vector& s) { return Vector3Wide(v.m_X * s, v.m_Y * s, v.m_Z * s); }
+  inline Vector3Wide operator*(const Vector& s, const Vector3Wide& v) { return v * s; }
+  inline Vector3Wide operator+(const Vector3Wide& v, const Vector& s) { return Vector3Wide(v.m_X + s, v.m_Y + s, v.m_Z + s); }
+  inline Vector3Wide operator-(const Vector3Wide& v, const Vector& s) { return Vector3Wide(v.m_X - s, v.m_Y - s, v.m_Z - s); }
+  inline Vector3Wide& operator+=(Vector3Wide& a, const Vector3Wide& b) { return a = a + b; }
+  inline Vector3Wide& operator-=(Vector3Wide& a, const Vector3Wide& b) { return a = a - b; }
+}
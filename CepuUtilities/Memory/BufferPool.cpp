@@ -0,0 +1,159 @@
+#include "CepuUtilitiesPCH.h"
+#include "BufferPool.h"
+
+#include <new>
+
+namespace CepuUtil
+{
+  void BufferPool::PowerPool::Initialize(int32_t power, int32_t minimumBlockSize, int32_t expectedPooledCount, uint64_t* nativeAllocationCount)
+  {
+    m_Power = power;
+    m_NativeAllocationCount = nativeAllocationCount;
+    m_SuballocationSize = 1 << power;
+    m_BlockSize = glm::max(m_SuballocationSize, minimumBlockSize);
+    m_SuballocationsPerBlock = m_BlockSize / m_SuballocationSize;
+    m_SuballocationsPerBlockShift = SpanHelper::GetContainingPowerOf2(m_SuballocationsPerBlock);
+    m_SuballocationsPerBlockMask = (1 << m_SuballocationsPerBlockShift) - 1;
+    m_AvailableSlots.reserve(expectedPooledCount);
+    m_BlockCount = 0;
+    m_NextSlot = 0;
+  }
+
+  void BufferPool::PowerPool::AllocateBlock(int32_t blockIndex)
+  {
+    assert(m_Blocks[blockIndex] == nullptr);
+    m_Blocks[blockIndex] = (uint8_t*)::operator new((size_t)m_BlockSize, std::align_val_t(BLOCK_ALIGNMENT));
+    ++*m_NativeAllocationCount;
+  }
+
+  void BufferPool::PowerPool::EnsureCapacity(int32_t capacity)
+  {
+    auto neededBlockCount = (int32_t)(((int64_t)capacity + m_BlockSize - 1) / m_BlockSize);
+    if (m_BlockCount < neededBlockCount) {
+      if (neededBlockCount > (int32_t)m_Blocks.size())
+        m_Blocks.resize(neededBlockCount, nullptr);
+      for (int32_t i = m_BlockCount; i < neededBlockCount; ++i)
+        AllocateBlock(i);
+      m_BlockCount = neededBlockCount;
+    }
+  }
+
+  void BufferPool::PowerPool::Take(uint8_t*& o_memory, int32_t& o_id)
+  {
+    int32_t slot;
+    if (m_AvailableSlots.size() > 0) {
+      slot = m_AvailableSlots.back();
+      m_AvailableSlots.pop_back();
+    }
+    else {
+      slot = m_NextSlot++;
+    }
+    assert(slot < (1 << ID_POWER_SHIFT) && "Too many outstanding buffers in a single size class for the id encoding.");
+
+    auto blockIndex = slot >> m_SuballocationsPerBlockShift;
+    if (blockIndex >= m_BlockCount) {
+      //Blocks are never freed individually; Clear resets the slot counter along with the blocks.
+      //So any slot beyond the allocated blocks is fresh, and every block up to it needs to be allocated.
+      if (blockIndex >= (int32_t)m_Blocks.size())
+        m_Blocks.resize((size_t)1 << SpanHelper::GetContainingPowerOf2(blockIndex + 1), nullptr);
+      for (int32_t i = m_BlockCount; i <= blockIndex; ++i)
+        AllocateBlock(i);
+      m_BlockCount = blockIndex + 1;
+    }
+#ifdef _DEBUG
+    auto inserted = m_OutstandingSlots.insert(slot).second;
+    assert(inserted && "Slot was handed out while still outstanding; the available slot stack is corrupt.");
+#endif
+    auto indexInBlock = slot & m_SuballocationsPerBlockMask;
+    o_memory = m_Blocks[blockIndex] + (size_t)indexInBlock * m_SuballocationSize;
+    o_id = (m_Power << ID_POWER_SHIFT) | slot;
+  }
+
+  void BufferPool::PowerPool::Return(int32_t slotIndex)
+  {
+#ifdef _DEBUG
+    auto erased = m_OutstandingSlots.erase(slotIndex);
+    assert(erased == 1 && "Buffer was returned that wasn't outstanding. Double return, or a buffer from a different pool?");
+#endif
+    m_AvailableSlots.push_back(slotIndex);
+  }
+
+  void BufferPool::PowerPool::ReturnAll()
+  {
+    //Every slot below m_NextSlot lives in an existing block, so resetting the counter hands them all out again in order.
+    m_NextSlot = 0;
+    m_AvailableSlots.clear();
+#ifdef _DEBUG
+    m_OutstandingSlots.clear();
+#endif
+  }
+
+  void BufferPool::PowerPool::Clear()
+  {
+    for (int32_t i = 0; i < m_BlockCount; ++i) {
+      ::operator delete(m_Blocks[i], std::align_val_t(BLOCK_ALIGNMENT));
+      m_Blocks[i] = nullptr;
+    }
+    m_BlockCount = 0;
+    ReturnAll();
+  }
+
+  BufferPool::BufferPool(int32_t minimumBlockAllocationSize, int32_t expectedPooledResourceCount)
+  {
+    assert(minimumBlockAllocationSize > 0 && SpanHelper::IsPowerOf2(minimumBlockAllocationSize) && "Block allocation size must be a positive power of 2.");
+    for (int32_t i = 0; i < SPAN_COUNT_LIMIT; ++i)
+      m_Pools[i].Initialize(i, minimumBlockAllocationSize, expectedPooledResourceCount, &m_NativeAllocationCount);
+  }
+
+  BufferPool::~BufferPool()
+  {
+    Clear();
+  }
+
+  void BufferPool::TakeForPower(int32_t power, uint8_t*& o_memory, int32_t& o_id)
+  {
+    assert(power >= 0 && power < SPAN_COUNT_LIMIT && "Requested allocation is too large for the pool.");
+    m_Pools[power].Take(o_memory, o_id);
+  }
+
+  void BufferPool::ReturnUnsafely(int32_t id)
+  {
+    auto powerIndex = id >> ID_POWER_SHIFT;
+    auto slotIndex = id & ((1 << ID_POWER_SHIFT) - 1);
+    assert(powerIndex >= 0 && powerIndex < SPAN_COUNT_LIMIT && "Buffer id is corrupt; its power doesn't belong to any size class.");
+    m_Pools[powerIndex].Return(slotIndex);
+  }
+
+  void BufferPool::EnsureCapacityForPower(int32_t byteCount, int32_t power)
+  {
+    assert(power >= 0 && power < SPAN_COUNT_LIMIT);
+    m_Pools[power].EnsureCapacity(byteCount);
+  }
+
+  int32_t BufferPool::GetCapacityForPower(int32_t power) const
+  {
+    assert(power >= 0 && power < SPAN_COUNT_LIMIT);
+    auto& pool = m_Pools[power];
+    return pool.m_BlockCount * pool.m_BlockSize;
+  }
+
+  uint64_t BufferPool::GetTotalAllocatedByteCount() const
+  {
+    uint64_t sum = 0;
+    for (int32_t i = 0; i < SPAN_COUNT_LIMIT; ++i)
+      sum += (uint64_t)m_Pools[i].m_BlockCount * (uint64_t)m_Pools[i].m_BlockSize;
+    return sum;
+  }
+
+  void BufferPool::Clear()
+  {
+    for (int32_t i = 0; i < SPAN_COUNT_LIMIT; ++i)
+      m_Pools[i].Clear();
+  }
+
+  void BufferPool::ReturnAll()
+  {
+    for (int32_t i = 0; i < SPAN_COUNT_LIMIT; ++i)
+      m_Pools[i].ReturnAll();
+  }
+}
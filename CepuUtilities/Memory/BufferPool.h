@@ -1,46 +1,67 @@
 #pragma once
 #include "Buffer.h"
+#include "SpanHelper.h"
+#include <vector>
+#ifdef _DEBUG
+#include <unordered_set>
+#endif
 
 namespace CepuUtil
 {
+  //Unmanaged memory pool that suballocates from memory blocks pulled from the native heap.
+  //Every allocation belongs to a power of 2 size class. Each size class owns a set of blocks that are split into equally sized slots.
+  //Note that the pool is not thread safe. Give each thread its own pool (or external synchronization) if you need to allocate concurrently.
   class BufferPool
   {
   public:
+    //Buffer ids pack the size class power into the upper bits and the slot index within that power's pool into the lower bits.
+    static const int32_t ID_POWER_SHIFT = 26;
+    //Allocations are limited to 2^30 bytes; larger sizes don't fit in a positive int32 length.
+    static const int32_t SPAN_COUNT_LIMIT = 31;
+    //Every block (and therefore every suballocation of at least this size) starts on a cache line boundary.
+    static const int32_t BLOCK_ALIGNMENT = 64;
+
+    BufferPool(int32_t minimumBlockAllocationSize = 131072, int32_t expectedPooledResourceCount = 16);
+    ~BufferPool();
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    //Takes a buffer large enough to contain the requested number of elements. The buffer's length is the full capacity of the size class, so it may be larger than requested.
     template<typename T>  void TakeAtLeast(int count, Buffer<T>& o_buffer)
     {
-      //@TODO (alektron) Actually implement a pool
-      o_buffer = Buffer<T>(new T[count], count);
+      if (count == 0)
+        count = 1;
+      auto power = SpanHelper::GetContainingPowerOf2(count * (int32_t)sizeof(T));
+      uint8_t* memory;
+      int32_t id;
+      TakeForPower(power, memory, id);
+      o_buffer = Buffer<T>((T*)memory, (1 << power) / (int32_t)sizeof(T), id);
     }
 
+    //Takes a buffer with a length equal to the requested count. The underlying allocation may still be larger.
     template<typename T>  void Take(int count, Buffer<T>& o_buffer)
     {
-      //@TODO (alektron) Actually implement a pool
-      o_buffer = Buffer<T>(new T[count], count);
+      TakeAtLeast(count, o_buffer);
+      o_buffer = Buffer<T>(o_buffer.m_Memory, count, o_buffer.m_Id);
     }
 
+    //Returns a buffer to the pool and clears the reference so that it can't be accidentally reused.
     template<typename T>  void Return(Buffer<T>& buffer)
     {
-      //@TODO (alektron) Actually implement a pool
-      delete[] buffer.m_Memory;
+      assert(buffer.IsAllocated() && buffer.m_Id >= 0 && "Only buffers taken from a pool can be returned to it.");
+      ReturnUnsafely(buffer.m_Id);
+      buffer = Buffer<T>();
     }
 
+    //Returns the slot associated with the given id without touching any buffer instance. Any buffers referring to the slot are left dangling.
+    void ReturnUnsafely(int32_t id);
+
     template<typename T> static int GetCapacityForCount(int count)
     {
-      auto RoundUpToPowerOf2 = [](int32_t v)
-      {
-        v--;
-        v |= v >> 1;
-        v |= v >> 2;
-        v |= v >> 4;
-        v |= v >> 8;
-        v |= v >> 16;
-        v++;
-        return v;
-      };
-
+      //Must match the capacity handed out by TakeAtLeast; otherwise resizes would never settle.
       if (count == 0)
         count = 1;
-      return (int32_t)RoundUpToPowerOf2(((uint32_t)(count * sizeof(T))) / sizeof(T));
+      return (1 << SpanHelper::GetContainingPowerOf2(count * (int32_t)sizeof(T))) / (int32_t)sizeof(T);
     }
 
     template<typename T>  void ResizeToAtLeast(Buffer<T>& o_buffer, int32_t targetSize, int32_t copyCount)
@@ -62,6 +83,55 @@ namespace CepuUtil
         o_buffer = newBuffer;
       }
     }
+
+    //Makes sure the size class of the given power has enough blocks to hand out byteCount bytes without hitting the native heap.
+    void EnsureCapacityForPower(int32_t byteCount, int32_t power);
+    int32_t GetCapacityForPower(int32_t power) const;
+    //Total number of bytes allocated from the native heap across all size classes.
+    uint64_t GetTotalAllocatedByteCount() const;
+    //Number of blocks ever pulled from the native heap. Stays constant across a frame that is served entirely by pooled memory.
+    uint64_t GetNativeAllocationCount() const { return m_NativeAllocationCount; }
+
+    //Frees all blocks back to the native heap at once. Any outstanding buffers become invalid.
+    void Clear();
+    //Returns every outstanding buffer at once but keeps the blocks around, so the next round of takes doesn't touch the native heap.
+    //Any outstanding buffers become invalid.
+    void ReturnAll();
+
+  private:
+    void TakeForPower(int32_t power, uint8_t*& o_memory, int32_t& o_id);
+
+    struct PowerPool
+    {
+      void Initialize(int32_t power, int32_t minimumBlockSize, int32_t expectedPooledCount, uint64_t* nativeAllocationCount);
+      void EnsureCapacity(int32_t capacity);
+      void AllocateBlock(int32_t blockIndex);
+      void Take(uint8_t*& o_memory, int32_t& o_id);
+      void Return(int32_t slotIndex);
+      void ReturnAll();
+      void Clear();
+
+      std::vector<uint8_t*> m_Blocks;
+      //Slots that were returned and can be handed out again. Slots beyond m_NextSlot have never been used.
+      std::vector<int32_t> m_AvailableSlots;
+      int32_t m_NextSlot = 0;
+
+      int32_t m_Power = 0;
+      int32_t m_SuballocationSize = 0;
+      int32_t m_SuballocationsPerBlock = 0;
+      int32_t m_SuballocationsPerBlockShift = 0;
+      int32_t m_SuballocationsPerBlockMask = 0;
+      int32_t m_BlockSize = 0;
+      int32_t m_BlockCount = 0;
+      //Shared with the owning BufferPool.
+      uint64_t* m_NativeAllocationCount = nullptr;
+
+#ifdef _DEBUG
+      std::unordered_set<int32_t> m_OutstandingSlots;
+#endif
+    };
+
+    PowerPool m_Pools[SPAN_COUNT_LIMIT];
+    uint64_t m_NativeAllocationCount = 0;
   };
 }
-
@@ -0,0 +1,104 @@
+#include "CepuUtilitiesPCH.h"
+#include "FrameArena.h"
+
+namespace CepuUtil
+{
+  FrameArena::FrameArena(BufferPool* pool, int32_t initialCapacityInBytes)
+    : m_Pool(pool)
+  {
+    assert(pool != nullptr && "The arena needs a pool to pull its blocks from.");
+    TakeBlock(0, glm::max(initialCapacityInBytes, ALIGNMENT));
+    m_BlockCount = 1;
+  }
+
+  FrameArena::~FrameArena()
+  {
+    Dispose();
+  }
+
+  void FrameArena::TakeBlock(int32_t blockIndex, int32_t minimumByteCount)
+  {
+    assert(blockIndex < MAXIMUM_BLOCK_COUNT && "Arena ran out of block slots; is something allocating without ever rewinding?");
+    if (m_Blocks[blockIndex].IsAllocated())
+      m_Pool->Return(m_Blocks[blockIndex]);
+    //BufferPool blocks are cache line aligned and every size class at or above the alignment keeps that alignment, so offsets are all that need rounding.
+    m_Pool->TakeAtLeast(glm::max(minimumByteCount, ALIGNMENT), m_Blocks[blockIndex]);
+  }
+
+  int32_t FrameArena::GetUsedByteCount() const
+  {
+    //Count the full capacity of any block we've moved past; the unused tail of a block is still lost to the frame.
+    int32_t used = m_Offset;
+    for (int32_t i = 0; i < m_CurrentBlock; ++i)
+      used += m_Blocks[i].GetLength();
+    return used;
+  }
+
+  uint8_t* FrameArena::Allocate(int32_t byteCount)
+  {
+    assert(byteCount > 0);
+    auto alignedByteCount = (byteCount + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (m_Offset + alignedByteCount > m_Blocks[m_CurrentBlock].GetLength()) {
+      //Doesn't fit in the current block. Blocks after the current one are always empty, so the next one can be reused or swapped for a bigger one freely.
+      ++m_CurrentBlock;
+      m_Offset = 0;
+      if (m_CurrentBlock == m_BlockCount) {
+        TakeBlock(m_CurrentBlock, glm::max(alignedByteCount, m_Blocks[m_CurrentBlock - 1].GetLength() * 2));
+        ++m_BlockCount;
+      }
+      else if (alignedByteCount > m_Blocks[m_CurrentBlock].GetLength()) {
+        TakeBlock(m_CurrentBlock, glm::max(alignedByteCount, m_Blocks[m_CurrentBlock - 1].GetLength() * 2));
+      }
+    }
+    auto memory = m_Blocks[m_CurrentBlock].m_Memory + m_Offset;
+    m_Offset += alignedByteCount;
+    m_HighWaterMark = glm::max(m_HighWaterMark, GetUsedByteCount());
+    return memory;
+  }
+
+  void FrameArena::ReturnUnsafely(uint8_t* memory, int32_t byteCount)
+  {
+    auto alignedByteCount = (byteCount + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (m_Offset >= alignedByteCount && memory == m_Blocks[m_CurrentBlock].m_Memory + m_Offset - alignedByteCount)
+      m_Offset -= alignedByteCount;
+  }
+
+  FrameArena::Mark FrameArena::GetMark() const
+  {
+    Mark mark;
+    mark.m_BlockIndex = m_CurrentBlock;
+    mark.m_Offset = m_Offset;
+    return mark;
+  }
+
+  void FrameArena::Rewind(const Mark& mark)
+  {
+    assert((mark.m_BlockIndex < m_CurrentBlock || (mark.m_BlockIndex == m_CurrentBlock && mark.m_Offset <= m_Offset)) &&
+      "Can only rewind to a mark captured earlier than the current position. Were marks rewound out of order?");
+    m_CurrentBlock = mark.m_BlockIndex;
+    m_Offset = mark.m_Offset;
+  }
+
+  void FrameArena::Reset()
+  {
+    m_CurrentBlock = 0;
+    m_Offset = 0;
+    if (m_BlockCount > 1) {
+      //The last frame didn't fit in a single block. Replace the chain with one block that holds the peak so the next frame stays in one contiguous region.
+      for (int32_t i = 1; i < m_BlockCount; ++i)
+        m_Pool->Return(m_Blocks[i]);
+      m_BlockCount = 1;
+      TakeBlock(0, m_HighWaterMark);
+    }
+    m_HighWaterMark = 0;
+  }
+
+  void FrameArena::Dispose()
+  {
+    for (int32_t i = 0; i < m_BlockCount; ++i)
+      m_Pool->Return(m_Blocks[i]);
+    m_BlockCount = 0;
+    m_CurrentBlock = 0;
+    m_Offset = 0;
+  }
+}
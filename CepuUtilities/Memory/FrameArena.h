@@ -0,0 +1,85 @@
+#pragma once
+#include "Buffer.h"
+
+namespace CepuUtil
+{
+  class BufferPool;
+
+  //Linear allocator for temporaries whose lifetimes nest within a frame (or any other scope).
+  //Allocations bump a pointer through blocks taken from a backing BufferPool; individual returns are (almost) free and
+  //memory is reclaimed wholesale by rewinding to a previously captured mark.
+  //Blocks are kept across rewinds, so once the arena has seen a frame's peak usage, later frames don't touch the backing pool at all.
+  //Exposes the same TakeAtLeast/Take/Return/GetCapacityForCount interface as BufferPool, so it can back QuickLists.
+  //Like BufferPool, the arena is not thread safe; give each worker its own.
+  class FrameArena
+  {
+  public:
+    //Every allocation starts on a cache line boundary, matching the alignment of BufferPool blocks.
+    static const int32_t ALIGNMENT = 64;
+    //Every new block is at least twice as large as the previous one, so this is never reached before the pool's allocation limit.
+    static const int32_t MAXIMUM_BLOCK_COUNT = 32;
+
+    struct Mark
+    {
+      int32_t m_BlockIndex = 0;
+      int32_t m_Offset = 0;
+    };
+
+    FrameArena(BufferPool* pool, int32_t initialCapacityInBytes = 65536);
+    ~FrameArena();
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    //Takes a buffer that can hold exactly count elements. Unlike BufferPool, the arena doesn't round up to size classes.
+    template<typename T> void TakeAtLeast(int32_t count, Buffer<T>& o_buffer)
+    {
+      if (count == 0)
+        count = 1;
+      o_buffer = Buffer<T>((T*)Allocate(count * (int32_t)sizeof(T)), count);
+    }
+
+    template<typename T> void Take(int32_t count, Buffer<T>& o_buffer)
+    {
+      TakeAtLeast(count, o_buffer);
+    }
+
+    //Memory is only reclaimed by rewinding. The exception is the most recent allocation, which is popped so that take/return pairs don't leak space.
+    template<typename T> void Return(Buffer<T>& buffer)
+    {
+      assert(buffer.IsAllocated() && buffer.m_Id == -1 && "Buffers taken from a BufferPool can't be returned to an arena.");
+      ReturnUnsafely((uint8_t*)buffer.m_Memory, buffer.GetLength() * (int32_t)sizeof(T));
+      buffer = Buffer<T>();
+    }
+
+    template<typename T> static int32_t GetCapacityForCount(int32_t count)
+    {
+      return count == 0 ? 1 : count;
+    }
+
+    Mark GetMark() const;
+    //Releases every allocation made since the mark was captured. Any buffers taken after it become invalid.
+    void Rewind(const Mark& mark);
+    //Releases everything. If the last frame spilled over into multiple blocks, they are consolidated into one block large enough for the peak usage.
+    void Reset();
+    //Returns every block to the backing pool.
+    void Dispose();
+
+    int32_t GetBlockCount() const { return m_BlockCount; }
+    //Most bytes that were simultaneously in use since the last Reset.
+    int32_t GetHighWaterMark() const { return m_HighWaterMark; }
+
+  private:
+    uint8_t* Allocate(int32_t byteCount);
+    void ReturnUnsafely(uint8_t* memory, int32_t byteCount);
+    void TakeBlock(int32_t blockIndex, int32_t minimumByteCount);
+    int32_t GetUsedByteCount() const;
+
+    BufferPool* m_Pool = nullptr;
+    Buffer<uint8_t> m_Blocks[MAXIMUM_BLOCK_COUNT];
+    int32_t m_BlockCount = 0;
+
+    int32_t m_CurrentBlock = 0;
+    int32_t m_Offset = 0;
+    int32_t m_HighWaterMark = 0;
+  };
+}
@@ -0,0 +1,202 @@
+#pragma once
+#include "Buffer.h"
+#include "SpanHelper.h"
+
+namespace CepuUtil
+{
+  //Dictionary built on top of pooled buffers instead of the native heap.
+  //Keys and values live in dense arrays in insertion order (until removals swap elements around), and an open addressed (linear probing) table maps keys to
+  //their element index. The table is kept at least twice as large as the element capacity so probe runs stay short.
+  //TEqualityComparer must provide static int32_t Hash(const TKey&) and static bool Equals(const TKey&, const TKey&). Hashes don't need to be well mixed.
+  //Like QuickList, the dictionary doesn't remember its pool; every operation that may allocate takes it explicitly, and it must always be the same one.
+  template<typename TKey, typename TValue, typename TEqualityComparer>
+  struct QuickDictionary
+  {
+    QuickDictionary() = default;
+
+    template<typename TPool> QuickDictionary(int32_t initialCapacity, TPool* pool)
+    {
+      pool->TakeAtLeast(initialCapacity, m_Keys);
+      pool->TakeAtLeast(m_Keys.GetLength(), m_Values);
+      TakeTable(m_Keys.GetLength(), pool);
+      m_Count = 0;
+    }
+
+    int32_t GetHomeSlot(const TKey& key) const
+    {
+      //Fibonacci hashing spreads weak hashes across the table; the top bits of the product are the best mixed.
+      return (int32_t)(((uint32_t)TEqualityComparer::Hash(key) * 2654435769u) >> (32 - m_TableShift));
+    }
+
+    //Finds the table slot holding the key, or the empty slot where it would go. Returns whether the key was found.
+    bool GetTableIndices(const TKey& key, int32_t& o_tableIndex, int32_t& o_elementIndex) const
+    {
+      if (!m_Table.IsAllocated()) {
+        //Default constructed dictionaries have no table until the first add.
+        o_tableIndex = 0;
+        o_elementIndex = -1;
+        return false;
+      }
+      o_tableIndex = GetHomeSlot(key);
+      while (true) {
+        //Table entries store element index + 1, so a zeroed table is an empty one.
+        auto entry = m_Table[o_tableIndex];
+        if (entry == 0) {
+          o_elementIndex = -1;
+          return false;
+        }
+        if (TEqualityComparer::Equals(m_Keys[entry - 1], key)) {
+          o_elementIndex = entry - 1;
+          return true;
+        }
+        o_tableIndex = (o_tableIndex + 1) & m_TableMask;
+      }
+    }
+
+    int32_t IndexOf(const TKey& key) const
+    {
+      int32_t tableIndex, elementIndex;
+      GetTableIndices(key, tableIndex, elementIndex);
+      return elementIndex;
+    }
+
+    bool ContainsKey(const TKey& key) const { return IndexOf(key) >= 0; }
+
+    bool TryGetValue(const TKey& key, TValue& o_value) const
+    {
+      auto elementIndex = IndexOf(key);
+      if (elementIndex < 0)
+        return false;
+      o_value = m_Values[elementIndex];
+      return true;
+    }
+
+    //Returns true and the key's element index if it's already present. Otherwise adds the key with an uninitialized value, resizing if necessary, and returns false.
+    template<typename TPool> bool FindOrAllocateSlot(const TKey& key, TPool* pool, int32_t& o_elementIndex)
+    {
+      int32_t tableIndex;
+      if (GetTableIndices(key, tableIndex, o_elementIndex))
+        return true;
+      if (m_Count == m_Keys.GetLength()) {
+        Resize(glm::max(1, m_Count * 2), pool);
+        GetTableIndices(key, tableIndex, o_elementIndex);
+      }
+      o_elementIndex = m_Count++;
+      m_Keys[o_elementIndex] = key;
+      m_Table[tableIndex] = o_elementIndex + 1;
+      return false;
+    }
+
+    //Adds the pair if the key isn't present yet. Returns whether it was added.
+    template<typename TPool> bool Add(const TKey& key, const TValue& value, TPool* pool)
+    {
+      int32_t elementIndex;
+      if (FindOrAllocateSlot(key, pool, elementIndex))
+        return false;
+      m_Values[elementIndex] = value;
+      return true;
+    }
+
+    //Removes the element at the given index by moving the last element into its slot. Doesn't preserve order.
+    void FastRemoveAt(int32_t elementIndex)
+    {
+      assert(elementIndex >= 0 && elementIndex < m_Count);
+      int32_t tableIndex, foundIndex;
+      auto found = GetTableIndices(m_Keys[elementIndex], tableIndex, foundIndex);
+      assert(found && foundIndex == elementIndex && "Every element should be in the table.");
+      //Backward shift deletion: pull later entries of the probe run back into the hole unless that would move them in front of their home slot.
+      auto next = (tableIndex + 1) & m_TableMask;
+      while (m_Table[next] != 0) {
+        auto home = GetHomeSlot(m_Keys[m_Table[next] - 1]);
+        if (((next - home) & m_TableMask) >= ((next - tableIndex) & m_TableMask)) {
+          m_Table[tableIndex] = m_Table[next];
+          tableIndex = next;
+        }
+        next = (next + 1) & m_TableMask;
+      }
+      m_Table[tableIndex] = 0;
+
+      auto lastIndex = --m_Count;
+      if (elementIndex < lastIndex) {
+        GetTableIndices(m_Keys[lastIndex], tableIndex, foundIndex);
+        m_Table[tableIndex] = elementIndex + 1;
+        m_Keys[elementIndex] = m_Keys[lastIndex];
+        m_Values[elementIndex] = m_Values[lastIndex];
+      }
+    }
+
+    bool FastRemove(const TKey& key)
+    {
+      auto elementIndex = IndexOf(key);
+      if (elementIndex < 0)
+        return false;
+      FastRemoveAt(elementIndex);
+      return true;
+    }
+
+    void Clear()
+    {
+      m_Table.Clear(0, m_Table.GetLength());
+      m_Count = 0;
+    }
+
+    template<typename TPool> void EnsureCapacity(int32_t count, TPool* pool)
+    {
+      if (count > m_Keys.GetLength())
+        Resize(count, pool);
+    }
+
+    //Changes the element capacity to the size class that fits newSize and rebuilds the table to match. The count can't be shrunk below the current count.
+    template<typename TPool> void Resize(int32_t newSize, TPool* pool)
+    {
+      auto targetSize = TPool::template GetCapacityForCount<TKey>(glm::max(m_Count, newSize));
+      if (targetSize == m_Keys.GetLength())
+        return;
+      Buffer<TKey> newKeys;
+      Buffer<TValue> newValues;
+      pool->TakeAtLeast(targetSize, newKeys);
+      pool->TakeAtLeast(newKeys.GetLength(), newValues);
+      if (m_Keys.IsAllocated()) {
+        m_Keys.CopyTo(0, newKeys, 0, m_Count);
+        m_Values.CopyTo(0, newValues, 0, m_Count);
+        pool->Return(m_Keys);
+        pool->Return(m_Values);
+        pool->Return(m_Table);
+      }
+      m_Keys = newKeys;
+      m_Values = newValues;
+      TakeTable(m_Keys.GetLength(), pool);
+      for (int32_t i = 0; i < m_Count; ++i) {
+        auto tableIndex = GetHomeSlot(m_Keys[i]);
+        while (m_Table[tableIndex] != 0)
+          tableIndex = (tableIndex + 1) & m_TableMask;
+        m_Table[tableIndex] = i + 1;
+      }
+    }
+
+    //Returns the backing buffers to the pool. The dictionary must not be used again until it is reinitialized.
+    template<typename TPool> void Dispose(TPool* pool)
+    {
+      pool->Return(m_Keys);
+      pool->Return(m_Values);
+      pool->Return(m_Table);
+      m_Count = 0;
+    }
+
+    Buffer<TKey> m_Keys;
+    Buffer<TValue> m_Values;
+    Buffer<int32_t> m_Table;
+    int32_t m_Count = 0;
+    int32_t m_TableMask = 0;
+    int32_t m_TableShift = 0;
+
+  private:
+    template<typename TPool> void TakeTable(int32_t elementCapacity, TPool* pool)
+    {
+      m_TableShift = SpanHelper::GetContainingPowerOf2(glm::max(2, elementCapacity * 2));
+      pool->Take(1 << m_TableShift, m_Table);
+      m_TableMask = (1 << m_TableShift) - 1;
+      m_Table.Clear(0, m_Table.GetLength());
+    }
+  };
+}
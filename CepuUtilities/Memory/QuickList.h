@@ -0,0 +1,147 @@
+#pragma once
+#include "Buffer.h"
+
+namespace CepuUtil
+{
+  //Container supporting list-like behaviors built on top of pooled buffers instead of the native heap.
+  //Any type with BufferPool's TakeAtLeast/Return/GetCapacityForCount interface can back the list (BufferPool, FrameArena).
+  //The list doesn't remember its pool; every operation that may allocate takes it explicitly, and it must always be the same one.
+  //Be very careful when copying; the copy shares the underlying span but has its own count.
+  template<typename T>
+  struct QuickList
+  {
+    QuickList() = default;
+
+    template<typename TPool> QuickList(int32_t initialCapacity, TPool* pool)
+    {
+      pool->TakeAtLeast(initialCapacity, m_Span);
+      m_Count = 0;
+    }
+
+    T& operator[](int32_t index) const
+    {
+      assert(index >= 0 && index < m_Count && "Index must be within the list's count.");
+      return m_Span[index];
+    }
+
+    //Changes the capacity of the list to the size class that fits newSize. Elements beyond the new capacity are dropped.
+    template<typename TPool> void Resize(int32_t newSize, TPool* pool)
+    {
+      auto targetSize = TPool::template GetCapacityForCount<T>(newSize);
+      if (targetSize != m_Span.GetLength()) {
+        auto oldSpan = m_Span;
+        pool->TakeAtLeast(targetSize, m_Span);
+        auto newCount = glm::min(m_Count, m_Span.GetLength());
+        if (oldSpan.IsAllocated()) {
+          oldSpan.CopyTo(0, m_Span, 0, newCount);
+          pool->Return(oldSpan);
+        }
+        m_Count = newCount;
+      }
+    }
+
+    template<typename TPool> void EnsureCapacity(int32_t count, TPool* pool)
+    {
+      if (count > m_Span.GetLength())
+        Resize(count, pool);
+    }
+
+    //Returns the backing span to the pool. The list must not be used again until it is reinitialized.
+    template<typename TPool> void Dispose(TPool* pool)
+    {
+      pool->Return(m_Span);
+      m_Count = 0;
+    }
+
+    //Appends a slot to the list without initializing it and returns a reference to it, resizing if necessary.
+    template<typename TPool> T& Allocate(TPool* pool)
+    {
+      if (m_Count == m_Span.GetLength())
+        Resize(glm::max(1, m_Count * 2), pool);
+      return AllocateUnsafely();
+    }
+
+    //Appends a slot to the list without checking capacity.
+    T& AllocateUnsafely()
+    {
+      assert(m_Count < m_Span.GetLength() && "Unsafe adders can only be used if the capacity is guaranteed to hold the new size.");
+      return m_Span[m_Count++];
+    }
+
+    template<typename TPool> void Add(const T& element, TPool* pool)
+    {
+      if (m_Count == m_Span.GetLength())
+        Resize(glm::max(1, m_Count * 2), pool);
+      AddUnsafely(element);
+    }
+
+    //Appends an element without checking capacity.
+    void AddUnsafely(const T& element)
+    {
+      assert(m_Count < m_Span.GetLength() && "Unsafe adders can only be used if the capacity is guaranteed to hold the new size.");
+      m_Span[m_Count++] = element;
+    }
+
+    template<typename TPool> void AddRange(const T* elements, int32_t count, TPool* pool)
+    {
+      EnsureCapacity(m_Count + count, pool);
+      AddRangeUnsafely(elements, count);
+    }
+
+    void AddRangeUnsafely(const T* elements, int32_t count)
+    {
+      assert(m_Count + count <= m_Span.GetLength() && "Unsafe adders can only be used if the capacity is guaranteed to hold the new size.");
+      memcpy(m_Span.m_Memory + m_Count, elements, sizeof(T) * count);
+      m_Count += count;
+    }
+
+    int32_t IndexOf(const T& element) const
+    {
+      for (int32_t i = 0; i < m_Count; ++i) {
+        if (m_Span[i] == element)
+          return i;
+      }
+      return -1;
+    }
+
+    bool Contains(const T& element) const { return IndexOf(element) >= 0; }
+
+    //Removes the element at the given index, preserving the order of the remaining elements.
+    void RemoveAt(int32_t index)
+    {
+      assert(index >= 0 && index < m_Count);
+      --m_Count;
+      if (index < m_Count)
+        memmove(m_Span.m_Memory + index, m_Span.m_Memory + index + 1, sizeof(T) * (m_Count - index));
+    }
+
+    //Removes the element at the given index by moving the last element into its slot. Doesn't preserve order.
+    void FastRemoveAt(int32_t index)
+    {
+      assert(index >= 0 && index < m_Count);
+      --m_Count;
+      if (index < m_Count)
+        m_Span[index] = m_Span[m_Count];
+    }
+
+    void Pop(T& o_element)
+    {
+      assert(m_Count > 0);
+      o_element = m_Span[--m_Count];
+    }
+
+    bool TryPop(T& o_element)
+    {
+      if (m_Count > 0) {
+        o_element = m_Span[--m_Count];
+        return true;
+      }
+      return false;
+    }
+
+    void Clear() { m_Count = 0; }
+
+    Buffer<T> m_Span;
+    int32_t m_Count = 0;
+  };
+}
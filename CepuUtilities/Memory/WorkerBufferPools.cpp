@@ -0,0 +1,50 @@
+#include "CepuUtilitiesPCH.h"
+#include "WorkerBufferPools.h"
+
+namespace CepuUtil
+{
+  WorkerBufferPools::WorkerBufferPools(BufferPool* sharedPool, int32_t workerCount, int32_t largeAllocationThreshold, int32_t workerBlockAllocationSize)
+    : m_SharedPool(sharedPool), m_LargeAllocationThreshold(largeAllocationThreshold)
+  {
+    assert(sharedPool != nullptr && "Large allocations need a shared pool to fall through to.");
+    assert(workerCount > 0 && "There must be at least one worker.");
+    assert(largeAllocationThreshold > 0);
+    m_Pools.resize(workerCount);
+    for (int32_t i = 0; i < workerCount; ++i)
+      m_Pools[i] = new BufferPool(workerBlockAllocationSize);
+  }
+
+  WorkerBufferPools::~WorkerBufferPools()
+  {
+    for (auto pool : m_Pools)
+      delete pool;
+  }
+
+  void WorkerBufferPools::ReturnAll()
+  {
+    for (auto pool : m_Pools)
+      pool->ReturnAll();
+  }
+
+  void WorkerBufferPools::Clear()
+  {
+    for (auto pool : m_Pools)
+      pool->Clear();
+  }
+
+  uint64_t WorkerBufferPools::GetTotalAllocatedByteCount() const
+  {
+    uint64_t sum = 0;
+    for (auto pool : m_Pools)
+      sum += pool->GetTotalAllocatedByteCount();
+    return sum;
+  }
+
+  uint64_t WorkerBufferPools::GetNativeAllocationCount() const
+  {
+    uint64_t sum = 0;
+    for (auto pool : m_Pools)
+      sum += pool->GetNativeAllocationCount();
+    return sum;
+  }
+}
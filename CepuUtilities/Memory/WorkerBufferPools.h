@@ -0,0 +1,72 @@
+#pragma once
+#include "BufferPool.h"
+#include <mutex>
+
+namespace CepuUtil
+{
+  //Per-worker front-end to a shared BufferPool for multithreaded phases.
+  //Each worker gets its own pool that only it touches, so small scratch allocations never take a lock or hit the native heap once warmed up.
+  //Allocations at or above the large allocation threshold fall through to the shared pool under a lock; those are rare enough that contention doesn't matter,
+  //and routing them to the shared pool keeps big one-off blocks from getting stranded in a single worker's pool.
+  //Routing is decided purely by the size class encoded in a buffer's id, so Return doesn't need to know where a buffer came from.
+  class WorkerBufferPools
+  {
+  public:
+    WorkerBufferPools(BufferPool* sharedPool, int32_t workerCount, int32_t largeAllocationThreshold = 1 << 20, int32_t workerBlockAllocationSize = 16384);
+    ~WorkerBufferPools();
+    WorkerBufferPools(const WorkerBufferPools&) = delete;
+    WorkerBufferPools& operator=(const WorkerBufferPools&) = delete;
+
+    template<typename T> void TakeAtLeast(int32_t workerIndex, int32_t count, Buffer<T>& o_buffer)
+    {
+      assert(workerIndex >= 0 && workerIndex < GetWorkerCount());
+      if (IsLargePower(SpanHelper::GetContainingPowerOf2((count == 0 ? 1 : count) * (int32_t)sizeof(T)))) {
+        std::lock_guard<std::mutex> lock(m_SharedLock);
+        m_SharedPool->TakeAtLeast(count, o_buffer);
+      }
+      else
+        m_Pools[workerIndex]->TakeAtLeast(count, o_buffer);
+    }
+
+    template<typename T> void Take(int32_t workerIndex, int32_t count, Buffer<T>& o_buffer)
+    {
+      TakeAtLeast(workerIndex, count, o_buffer);
+      o_buffer = Buffer<T>(o_buffer.m_Memory, count, o_buffer.m_Id);
+    }
+
+    //Buffers must be returned by the same worker that took them, unless they came from the shared pool.
+    template<typename T> void Return(int32_t workerIndex, Buffer<T>& buffer)
+    {
+      assert(workerIndex >= 0 && workerIndex < GetWorkerCount());
+      if (IsLargePower(buffer.m_Id >> BufferPool::ID_POWER_SHIFT)) {
+        std::lock_guard<std::mutex> lock(m_SharedLock);
+        m_SharedPool->Return(buffer);
+      }
+      else
+        m_Pools[workerIndex]->Return(buffer);
+    }
+
+    //Returns everything taken from the worker pools in one go. Call this at the end of a phase, once no worker holds onto scratch memory anymore.
+    //Note that buffers which fell through to the shared pool are not affected; they must be returned explicitly.
+    void ReturnAll();
+    //Frees all worker pool blocks back to the native heap.
+    void Clear();
+
+    //Direct access to a worker's pool for code that wants a plain BufferPool (e.g. to pass into a QuickList). Only the owning worker may use it.
+    BufferPool& GetPool(int32_t workerIndex) { assert(workerIndex >= 0 && workerIndex < GetWorkerCount()); return *m_Pools[workerIndex]; }
+    BufferPool& GetSharedPool() { return *m_SharedPool; }
+    int32_t GetWorkerCount() const { return (int32_t)m_Pools.size(); }
+    uint64_t GetTotalAllocatedByteCount() const;
+    //Native heap block allocations made by the worker pools. Doesn't include the shared pool.
+    uint64_t GetNativeAllocationCount() const;
+
+  private:
+    //Take and Return must agree on the route, so both decide based on the size class rather than the requested byte count.
+    bool IsLargePower(int32_t power) const { return (1 << power) >= m_LargeAllocationThreshold; }
+
+    std::vector<BufferPool*> m_Pools;
+    BufferPool* m_SharedPool = nullptr;
+    std::mutex m_SharedLock;
+    int32_t m_LargeAllocationThreshold = 0;
+  };
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+namespace CepuUtil
+{
+  namespace SpanHelper
+  {
+    //Returns the smallest power p such that (1 << p) >= i. Note that this returns 0 for both 0 and 1.
+    inline int32_t GetContainingPowerOf2(int32_t i)
+    {
+      assert(i >= 0 && "Negative counts have no containing power of 2.");
+      //@TODO (alektron) Use intrinsic for leading zeroes
+      uint32_t v = i > 0 ? (uint32_t)i - 1 : 0;
+      int32_t power = 0;
+      if (v >= 1u << 16) { v >>= 16; power += 16; }
+      if (v >= 1u <<  8) { v >>=  8; power +=  8; }
+      if (v >= 1u <<  4) { v >>=  4; power +=  4; }
+      if (v >= 1u <<  2) { v >>=  2; power +=  2; }
+      if (v >= 1u <<  1) { v >>=  1; power +=  1; }
+      return power + (int32_t)v;
+    }
+
+    inline bool IsPowerOf2(int32_t i)
+    {
+      return i > 0 && (i & (i - 1)) == 0;
+    }
+  }
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <functional>
+#include "Interlocked.h"
+
+namespace CepuUtil
+{
+  class BufferPool;
+
+  //Provides multithreading dispatch primitives, a thread count, and per thread resource pools for the simulation to use.
+  //Dispatchers are expected to be long lived; the simulation calls DispatchWorkers many times per frame, so spinning up threads per dispatch would be prohibitively slow.
+  class IThreadDispatcher
+  {
+  public:
+    virtual ~IThreadDispatcher() = default;
+
+    //Number of workers available for dispatch.
+    virtual int32_t GetThreadCount() const = 0;
+
+    //Invokes workerBody once on each of min(GetThreadCount(), maximumWorkerCount) workers, passing the worker index in [0, workerCount).
+    //Returns once every invocation has finished. The calling thread may act as one of the workers.
+    virtual void DispatchWorkers(const std::function<void(int32_t)>& workerBody, int32_t maximumWorkerCount = INT32_MAX) = 0;
+
+    //Invokes task(taskIndex, workerIndex) once for every task index in [0, taskCount), spread over the workers. Returns once every task has finished.
+    //The default implementation has workers claim tasks one at a time from a shared counter. Implementations with smarter scheduling (like work stealing) can override it.
+    virtual void DispatchTasks(int32_t taskCount, const std::function<void(int32_t, int32_t)>& task, int32_t maximumWorkerCount = INT32_MAX)
+    {
+      if (taskCount <= 0)
+        return;
+      int32_t taskCounter = -1;
+      DispatchWorkers([&](int32_t workerIndex) {
+        int32_t taskIndex;
+        while ((taskIndex = Interlocked::Increment(taskCounter)) < taskCount)
+          task(taskIndex, workerIndex);
+      }, maximumWorkerCount < taskCount ? maximumWorkerCount : taskCount);
+    }
+
+    //Gets the memory pool associated with a given worker. A worker's pool may only be used by that worker during a dispatch,
+    //or by the dispatching thread while no dispatch is running.
+    virtual BufferPool* GetThreadMemoryPool(int32_t workerIndex) = 0;
+  };
+}
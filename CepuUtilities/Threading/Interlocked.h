@@ -0,0 +1,33 @@
+#pragma once
+#include <atomic>
+
+namespace CepuUtil
+{
+  //Atomic operations on plain int32 fields, mirroring the Interlocked functions the original C# relies on.
+  //Lets data that's normally only touched by one thread (like MetaNode::RefineFlag) live in ordinary structs and be synchronized only where needed.
+  //All operations are sequentially consistent.
+  namespace Interlocked
+  {
+    static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t) && alignof(std::atomic<int32_t>) == alignof(int32_t),
+      "Interlocked operations reinterpret int32 fields as atomics; that requires matching layout.");
+
+    inline std::atomic<int32_t>& AsAtomic(int32_t& location) { return *reinterpret_cast<std::atomic<int32_t>*>(&location); }
+
+    //Returns the incremented value.
+    inline int32_t Increment(int32_t& location) { return AsAtomic(location).fetch_add(1) + 1; }
+    //Returns the decremented value.
+    inline int32_t Decrement(int32_t& location) { return AsAtomic(location).fetch_sub(1) - 1; }
+    //Returns the new value.
+    inline int32_t Add(int32_t& location, int32_t value) { return AsAtomic(location).fetch_add(value) + value; }
+    //Returns the original value.
+    inline int32_t Exchange(int32_t& location, int32_t value) { return AsAtomic(location).exchange(value); }
+    //Stores value if the location holds comparand. Returns the original value either way.
+    inline int32_t CompareExchange(int32_t& location, int32_t value, int32_t comparand)
+    {
+      AsAtomic(location).compare_exchange_strong(comparand, value);
+      return comparand;
+    }
+    inline int32_t Read(int32_t& location) { return AsAtomic(location).load(); }
+    inline void Write(int32_t& location, int32_t value) { AsAtomic(location).store(value); }
+  }
+}
@@ -0,0 +1,150 @@
+#include "CepuUtilitiesPCH.h"
+#include "ThreadDispatcher.h"
+
+namespace CepuUtil
+{
+  ThreadDispatcher::ThreadDispatcher(int32_t threadCount, int32_t threadPoolBlockAllocationSize)
+    : m_ThreadCount(threadCount), m_TaskDeques(threadCount), m_WorkerPools(&m_LargeAllocationPool, threadCount, 1 << 20, threadPoolBlockAllocationSize)
+  {
+    assert(threadCount > 0 && "A dispatcher needs at least one thread.");
+    for (auto& deque : m_TaskDeques)
+      deque.m_Range.store(0, std::memory_order_relaxed);
+    //The dispatching thread acts as worker 0.
+    m_Threads.reserve(threadCount - 1);
+    for (int32_t i = 1; i < threadCount; ++i)
+      m_Threads.emplace_back(&ThreadDispatcher::WorkerLoop, this, i);
+  }
+
+  ThreadDispatcher::~ThreadDispatcher()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_Lock);
+      m_Disposed.store(true);
+      m_DispatchState.store((uint64_t)++m_Generation << 32);
+    }
+    m_WorkAvailable.notify_all();
+    for (auto& thread : m_Threads)
+      thread.join();
+  }
+
+  void ThreadDispatcher::WorkerLoop(int32_t workerIndex)
+  {
+    uint64_t observedState = 0;
+    while (true) {
+      auto state = m_DispatchState.load(std::memory_order_acquire);
+      for (int32_t i = 0; i < SPIN_COUNT && state == observedState; ++i) {
+        std::this_thread::yield();
+        state = m_DispatchState.load(std::memory_order_acquire);
+      }
+      if (state == observedState) {
+        std::unique_lock<std::mutex> lock(m_Lock);
+        m_WorkAvailable.wait(lock, [&] { return m_DispatchState.load(std::memory_order_acquire) != observedState; });
+        state = m_DispatchState.load(std::memory_order_acquire);
+      }
+      observedState = state;
+      if (m_Disposed.load())
+        return;
+      //Workers beyond the requested count sit this dispatch out. They aren't counted, so they must not touch any of the dispatch's state.
+      if (workerIndex < (int32_t)(uint32_t)state) {
+        (*m_WorkerBody)(workerIndex);
+        if (m_RemainingWorkerCount.fetch_sub(1) == 1) {
+          std::lock_guard<std::mutex> lock(m_Lock);
+          m_WorkCompleted.notify_one();
+        }
+      }
+    }
+  }
+
+  void ThreadDispatcher::DispatchWorkers(const std::function<void(int32_t)>& workerBody, int32_t maximumWorkerCount)
+  {
+    assert(maximumWorkerCount > 0 && "Dispatches need at least one worker.");
+    assert(m_WorkerBody == nullptr && "Dispatches can't be nested or issued from multiple threads at once.");
+    auto workerCount = glm::min(m_ThreadCount, maximumWorkerCount);
+    if (workerCount == 1) {
+      //No point in waking anyone up.
+      workerBody(0);
+      return;
+    }
+    m_WorkerBody = &workerBody;
+    m_RemainingWorkerCount.store(workerCount - 1);
+    {
+      std::lock_guard<std::mutex> lock(m_Lock);
+      m_DispatchState.store(((uint64_t)++m_Generation << 32) | (uint32_t)workerCount, std::memory_order_release);
+    }
+    m_WorkAvailable.notify_all();
+
+    workerBody(0);
+
+    for (int32_t i = 0; i < SPIN_COUNT && m_RemainingWorkerCount.load() > 0; ++i)
+      std::this_thread::yield();
+    if (m_RemainingWorkerCount.load() > 0) {
+      std::unique_lock<std::mutex> lock(m_Lock);
+      m_WorkCompleted.wait(lock, [&] { return m_RemainingWorkerCount.load() == 0; });
+    }
+    m_WorkerBody = nullptr;
+  }
+
+  void ThreadDispatcher::DispatchTasks(int32_t taskCount, const std::function<void(int32_t, int32_t)>& task, int32_t maximumWorkerCount)
+  {
+    if (taskCount <= 0)
+      return;
+    auto workerCount = glm::min(glm::min(m_ThreadCount, maximumWorkerCount), taskCount);
+    //Every worker starts out with an equal contiguous slice. Neighbouring tasks tend to touch neighbouring memory, so keeping slices contiguous
+    //(and stealing contiguous halves) keeps each worker's accesses coherent for as long as the load is balanced.
+    for (int32_t i = 0; i < workerCount; ++i) {
+      auto start = (int32_t)((int64_t)taskCount * i / workerCount);
+      auto end = (int32_t)((int64_t)taskCount * (i + 1) / workerCount);
+      m_TaskDeques[i].m_Range.store(PackRange(start, end), std::memory_order_relaxed);
+    }
+    DispatchWorkers([&](int32_t workerIndex) {
+      int32_t taskIndex;
+      while (TryPopTask(workerIndex, taskIndex) || TryStealTasks(workerIndex, workerCount, taskIndex))
+        task(taskIndex, workerIndex);
+    }, workerCount);
+  }
+
+  bool ThreadDispatcher::TryPopTask(int32_t workerIndex, int32_t& o_taskIndex)
+  {
+    auto& range = m_TaskDeques[workerIndex].m_Range;
+    auto current = range.load();
+    while (true) {
+      auto start = GetRangeStart(current);
+      auto end = GetRangeEnd(current);
+      if (start >= end)
+        return false;
+      //Thieves take from the other end of the same packed value, so the owner has to compare exchange as well.
+      if (range.compare_exchange_weak(current, PackRange(start + 1, end))) {
+        o_taskIndex = start;
+        return true;
+      }
+    }
+  }
+
+  bool ThreadDispatcher::TryStealTasks(int32_t workerIndex, int32_t workerCount, int32_t& o_taskIndex)
+  {
+    //Only called once this worker's own deque is empty. Nobody else ever grows a deque, so it stays empty until we refill it below.
+    for (int32_t i = 1; i < workerCount; ++i) {
+      auto victimIndex = workerIndex + i;
+      if (victimIndex >= workerCount)
+        victimIndex -= workerCount;
+      auto& victimRange = m_TaskDeques[victimIndex].m_Range;
+      auto current = victimRange.load();
+      while (true) {
+        auto start = GetRangeStart(current);
+        auto end = GetRangeEnd(current);
+        auto count = end - start;
+        if (count <= 0)
+          break;
+        //Take the back half, rounding up so that a lone remaining task can be stolen too.
+        auto stolenStart = end - (count + 1) / 2;
+        if (victimRange.compare_exchange_weak(current, PackRange(start, stolenStart))) {
+          //Run the first stolen task right away; the rest go into our own deque where they can be stolen again.
+          m_TaskDeques[workerIndex].m_Range.store(PackRange(stolenStart + 1, end));
+          o_taskIndex = stolenStart;
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "IThreadDispatcher.h"
+#include "Memory/BufferPool.h"
+#include "Memory/WorkerBufferPools.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace CepuUtil
+{
+  //Built-in IThreadDispatcher backed by a set of persistent worker threads.
+  //The thread calling DispatchWorkers/DispatchTasks acts as worker 0, so a dispatcher with a thread count of N spins up N - 1 threads.
+  //Idle workers spin briefly before going to sleep, so back to back dispatches within a frame don't pay for a full wake up each time.
+  //
+  //DispatchTasks uses per-worker work-stealing deques. Every dispatch starts by handing each worker a contiguous range of task indices.
+  //Workers pop tasks off the front of their own range; a worker that runs dry steals the back half of another worker's range.
+  //Tasks are never added during a dispatch, so a deque is just a packed [start, end) pair that both ends update with a compare exchange.
+  //
+  //Each worker also owns a memory pool (see WorkerBufferPools) for scratch allocations made during dispatches.
+  //Not reentrant: a dispatch must not be started from within a dispatch or from two threads at once.
+  class ThreadDispatcher : public IThreadDispatcher
+  {
+  public:
+    ThreadDispatcher(int32_t threadCount, int32_t threadPoolBlockAllocationSize = 16384);
+    ~ThreadDispatcher() override;
+    ThreadDispatcher(const ThreadDispatcher&) = delete;
+    ThreadDispatcher& operator=(const ThreadDispatcher&) = delete;
+
+    int32_t GetThreadCount() const override { return m_ThreadCount; }
+    void DispatchWorkers(const std::function<void(int32_t)>& workerBody, int32_t maximumWorkerCount = INT32_MAX) override;
+    void DispatchTasks(int32_t taskCount, const std::function<void(int32_t, int32_t)>& task, int32_t maximumWorkerCount = INT32_MAX) override;
+    BufferPool* GetThreadMemoryPool(int32_t workerIndex) override { return &m_WorkerPools.GetPool(workerIndex); }
+
+    WorkerBufferPools& GetWorkerPools() { return m_WorkerPools; }
+
+  private:
+    //Kept on separate cache lines; every idle worker hammers on other workers' deques while stealing.
+    struct alignas(64) TaskDeque
+    {
+      //Start index in the upper 32 bits, end index in the lower 32 bits. Empty when start >= end.
+      std::atomic<uint64_t> m_Range;
+    };
+
+    //Number of times an idle worker (or a dispatcher waiting on its workers) yields before blocking.
+    static const int32_t SPIN_COUNT = 1024;
+
+    static uint64_t PackRange(int32_t start, int32_t end) { return ((uint64_t)(uint32_t)start << 32) | (uint32_t)end; }
+    static int32_t GetRangeStart(uint64_t range) { return (int32_t)(range >> 32); }
+    static int32_t GetRangeEnd(uint64_t range) { return (int32_t)(uint32_t)range; }
+
+    void WorkerLoop(int32_t workerIndex);
+    bool TryPopTask(int32_t workerIndex, int32_t& o_taskIndex);
+    bool TryStealTasks(int32_t workerIndex, int32_t workerCount, int32_t& o_taskIndex);
+
+    int32_t m_ThreadCount = 0;
+    std::vector<std::thread> m_Threads;
+    std::vector<TaskDeque> m_TaskDeques;
+
+    //Dispatch generation in the upper 32 bits, participating worker count in the lower 32 bits.
+    //Both live in one atomic so a worker that wakes up late can tell whether it is part of the dispatch it observed without reading anything else;
+    //only participating workers touch m_WorkerBody, and the dispatcher can't move on to the next dispatch until they are done with it.
+    std::atomic<uint64_t> m_DispatchState{ 0 };
+    uint32_t m_Generation = 0;
+    const std::function<void(int32_t)>* m_WorkerBody = nullptr;
+    std::atomic<int32_t> m_RemainingWorkerCount{ 0 };
+    std::atomic<bool> m_Disposed{ false };
+
+    std::mutex m_Lock;
+    std::condition_variable m_WorkAvailable;
+    std::condition_variable m_WorkCompleted;
+
+    BufferPool m_LargeAllocationPool;
+    WorkerBufferPools m_WorkerPools;
+  };
+}
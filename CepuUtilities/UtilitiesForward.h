@@ -5,7 +5,12 @@ namespace CepuUtil
   template<typename>
   class Buffer;
 
+  template<typename>
+  struct QuickList;
+
   class BufferPool;
+  class WorkerBufferPools;
+  class FrameArena;
 
   struct BoundingBox;
 
@@ -12,6 +12,8 @@
 #include "BodySet.h"
 #include "BodyDescription.h"
 #include "Bodies.h"
+#include "Threading/ThreadDispatcher.h"
+#include "WideTreeBenchmark.h"
 
 #include <Windows.h>
 #include "glew.h"
@@ -207,8 +209,14 @@ public:
   std::vector<Vertex>* m_DebugDraw = nullptr;
 };
 
-int main()
+int main(int argc, char** argv)
 {
+  //Prints the wide tree benchmark instead of opening the demo.
+  if (argc > 1 && strcmp(argv[1], "-widetreebenchmark") == 0) {
+    RunWideTreeBenchmark();
+    return 0;
+  }
+
   HWND window;
 
   //Create window and initialize OpenGL.
@@ -381,6 +389,7 @@ int main()
   
 
   CepuUtil::BufferPool bufferPool;
+  CepuUtil::ThreadDispatcher threadDispatcher(glm::max(1, (int32_t)std::thread::hardware_concurrency()));
   CepuPhysics::BroadPhase broadPhase(bufferPool);
   CepuPhysics::Shapes shapes(&bufferPool, 128);
   CepuPhysics::Bodies bodies(&bufferPool, &shapes, &broadPhase, 128, 0);
@@ -418,6 +427,7 @@ int main()
     bodyDesc.m_Velocity.m_Linear = glm::vec3(vx, vy, vz);
 
     bodyDesc.m_Collidable.m_Shape = boxShape;
+    bodyDesc.m_Collidable.m_Continuity = CepuPhysics::ContinuousDetection::Passive();
     if (i == 2)
       bodyDesc.m_Collidable.m_Shape = bigBoxShape;
 
@@ -456,11 +466,10 @@ int main()
       body.GetPose().m_Position += body.GetVelocity().m_Linear;
     }
 
-    for (auto bodyHandle : bodyHandles) {
-      bodies.UpdateBounds(bodyHandle);
-    }
+    //The fake integration above moves each body by its velocity per frame, so a frame is one unit of time.
+    bodies.PredictBoundingBoxes(1, &threadDispatcher);
 
-    broadPhase.Update();
+    broadPhase.Update(&threadDispatcher);
 
     for (auto bodyHandle : bodyHandles) {
       auto body = bodies.GetBodyRef(bodyHandle);
@@ -0,0 +1,218 @@
+#include "pch.h"
+#include "WideTreeBenchmark.h"
+
+#include "Memory/BufferPool.h"
+#include "BoundingBox.h"
+#include "Trees/Tree.h"
+#include "Trees/WideTree.h"
+#include "Trees/Tree_VolumeQueries.h"
+#include "Trees/Tree_RayCast.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+using namespace CepuPhysics;
+using namespace CepuUtil;
+
+struct BenchmarkLeafCounter
+{
+  int64_t m_Count = 0;
+  bool Handle(int32_t) { ++m_Count; return true; }
+  void Handle(int32_t, int32_t) { ++m_Count; }
+};
+
+//Tests the ray against the leaf's own bounds, like a shape test would. With m_ClosestOnly the maximum shrinks to every hit, which is what closest hit queries
+//do; otherwise every leaf along the ray is visited.
+struct BenchmarkRayTester
+{
+  const Buffer<BoundingBox>& m_LeafBounds;
+  bool m_ClosestOnly;
+  int64_t m_HitCount = 0;
+
+  void TestLeaf(int32_t leafIndex, const RayData& ray, float& maximumT)
+  {
+    float t;
+    auto& bounds = m_LeafBounds[leafIndex];
+    if (TreeRay::Intersects(ray.Origin, TreeRay::ComputeInverseDirection(ray.Direction), maximumT, bounds.m_Min, bounds.m_Max, t)) {
+      ++m_HitCount;
+      if (m_ClosestOnly)
+        maximumT = glm::max(0.f, t);
+    }
+  }
+};
+
+struct BenchmarkRay
+{
+  glm::vec3 Origin;
+  glm::vec3 Direction;
+};
+
+struct BenchmarkScene
+{
+  BenchmarkScene(BufferPool& pool, int32_t leafCount, int32_t otherLeafCount) : m_Tree(pool, leafCount), m_OtherTree(pool, otherLeafCount) {}
+
+  Buffer<BoundingBox> m_LeafBounds;
+  Tree m_Tree;
+  //Smaller tree standing in for the active set in intertree queries.
+  Buffer<BoundingBox> m_OtherLeafBounds;
+  Tree m_OtherTree;
+  std::vector<BoundingBox> m_SmallQueries;
+  std::vector<BoundingBox> m_LargeQueries;
+  std::vector<BenchmarkRay> m_Rays;
+};
+
+struct BenchmarkTotals
+{
+  int64_t m_SmallBoxHits;
+  int64_t m_LargeBoxHits;
+  int64_t m_ClosestRayHits;
+  double m_ClosestRayTSum;
+  int64_t m_AllRayHits;
+  int64_t m_IntertreePairs;
+};
+
+static double GetSeconds()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static BoundingBox CreateRandomBox(std::mt19937& random, float range, float maximumSize)
+{
+  std::uniform_real_distribution<float> position(-range, range), size(0.f, maximumSize);
+  glm::vec3 min(position(random), position(random), position(random));
+  return BoundingBox{ min, min + glm::vec3(size(random), size(random), size(random)) };
+}
+
+static void CreateScene(int32_t leafCount, int32_t otherLeafCount, int32_t queryCount, uint32_t seed, BufferPool& pool, BenchmarkScene& o_scene)
+{
+  std::mt19937 random(seed);
+  //Keeps the density of the leaves, and so the number of hits per query, roughly independent of the leaf count.
+  auto range = 10 * std::cbrt((float)leafCount);
+  pool.Take(leafCount, o_scene.m_LeafBounds);
+  for (int32_t i = 0; i < leafCount; ++i)
+    o_scene.m_LeafBounds[i] = CreateRandomBox(random, range, 5);
+  o_scene.m_Tree.BuildFrom(o_scene.m_LeafBounds, pool);
+
+  pool.Take(otherLeafCount, o_scene.m_OtherLeafBounds);
+  for (int32_t i = 0; i < otherLeafCount; ++i)
+    o_scene.m_OtherLeafBounds[i] = CreateRandomBox(random, range, 5);
+  o_scene.m_OtherTree.BuildFrom(o_scene.m_OtherLeafBounds, pool);
+
+  std::uniform_real_distribution<float> unit(-1.f, 1.f);
+  for (int32_t i = 0; i < queryCount; ++i) {
+    o_scene.m_SmallQueries.push_back(CreateRandomBox(random, range, 5));
+    o_scene.m_LargeQueries.push_back(CreateRandomBox(random, range, 50));
+    BenchmarkRay ray;
+    ray.Origin = glm::vec3(unit(random), unit(random), unit(random)) * range;
+    ray.Direction = glm::vec3(unit(random), unit(random), unit(random));
+    o_scene.m_Rays.push_back(ray);
+  }
+}
+
+static void DisposeScene(BufferPool& pool, BenchmarkScene& scene)
+{
+  pool.Return(scene.m_LeafBounds);
+  pool.Return(scene.m_OtherLeafBounds);
+  scene.m_Tree.Dispose(pool);
+  scene.m_OtherTree.Dispose(pool);
+}
+
+//Small adapters so the binary tree and the wide trees run through the same timing code.
+struct BinaryTreeQueries
+{
+  const Tree& m_Tree;
+  int32_t GetNodeCount() const { return m_Tree.m_NodeCount; }
+  void GetOverlaps(const BoundingBox& bounds, BenchmarkLeafCounter& results) const { CepuPhysics::GetOverlaps(m_Tree, bounds, results); }
+  void RayCast(const BenchmarkRay& ray, float& maximumT, BenchmarkRayTester& tester) const { CepuPhysics::RayCast(m_Tree, ray.Origin, ray.Direction, maximumT, tester); }
+  void GetOverlaps(const Tree& other, BenchmarkLeafCounter& results) const { CepuPhysics::GetOverlaps(other, m_Tree, results); }
+};
+
+template<int32_t WIDTH>
+struct WideTreeQueries
+{
+  const WideTree<WIDTH>& m_Tree;
+  int32_t GetNodeCount() const { return m_Tree.m_NodeCount; }
+  void GetOverlaps(const BoundingBox& bounds, BenchmarkLeafCounter& results) const { m_Tree.GetOverlaps(bounds.m_Min, bounds.m_Max, results); }
+  void RayCast(const BenchmarkRay& ray, float& maximumT, BenchmarkRayTester& tester) const { m_Tree.RayCast(ray.Origin, ray.Direction, maximumT, tester); }
+  void GetOverlaps(const Tree& other, BenchmarkLeafCounter& results) const { m_Tree.GetOverlaps(other, results); }
+};
+
+template<typename TQueries>
+static void RunQueries(const char* name, const TQueries& queries, const BenchmarkScene& scene, BenchmarkTotals& o_totals)
+{
+  auto queryCount = (int32_t)scene.m_SmallQueries.size();
+
+  auto start = GetSeconds();
+  BenchmarkLeafCounter smallBoxResults;
+  for (auto& query : scene.m_SmallQueries)
+    queries.GetOverlaps(query, smallBoxResults);
+  auto smallBoxEnd = GetSeconds();
+  BenchmarkLeafCounter largeBoxResults;
+  for (auto& query : scene.m_LargeQueries)
+    queries.GetOverlaps(query, largeBoxResults);
+  auto largeBoxEnd = GetSeconds();
+
+  BenchmarkRayTester closestTester{ scene.m_LeafBounds, true };
+  double closestTSum = 0;
+  for (auto& ray : scene.m_Rays) {
+    auto maximumT = 1000.f;
+    queries.RayCast(ray, maximumT, closestTester);
+    closestTSum += maximumT;
+  }
+  auto closestRayEnd = GetSeconds();
+  BenchmarkRayTester allTester{ scene.m_LeafBounds, false };
+  for (auto& ray : scene.m_Rays) {
+    auto maximumT = 1000.f;
+    queries.RayCast(ray, maximumT, allTester);
+  }
+  auto allRayEnd = GetSeconds();
+
+  BenchmarkLeafCounter pairResults;
+  queries.GetOverlaps(scene.m_OtherTree, pairResults);
+  auto intertreeEnd = GetSeconds();
+
+  o_totals = { smallBoxResults.m_Count, largeBoxResults.m_Count, closestTester.m_HitCount, closestTSum, allTester.m_HitCount, pairResults.m_Count };
+  auto perQuery = 1e9 / queryCount;
+  printf("  %-8s nodes %7d | box small %7.1f ns large %8.1f ns | ray closest %7.1f ns all %8.1f ns | intertree %8.3f ms\n", name, queries.GetNodeCount(),
+    (smallBoxEnd - start) * perQuery, (largeBoxEnd - smallBoxEnd) * perQuery, (closestRayEnd - largeBoxEnd) * perQuery, (allRayEnd - closestRayEnd) * perQuery,
+    (intertreeEnd - allRayEnd) * 1e3);
+}
+
+template<int32_t WIDTH>
+static void RunWideQueries(const char* name, const BenchmarkScene& scene, BufferPool& pool, const BenchmarkTotals& expectedTotals)
+{
+  WideTree<WIDTH> wideTree;
+  auto start = GetSeconds();
+  wideTree.Build(scene.m_Tree, pool);
+  auto buildTime = GetSeconds() - start;
+  BenchmarkTotals totals;
+  RunQueries(name, WideTreeQueries<WIDTH>{ wideTree }, scene, totals);
+  printf("  %-8s build %.3f ms\n", "", buildTime * 1e3);
+  //Traversal order differs, but the leaves found and the closest hits can't. How often a closest hit query shrinks its maximum does depend on the order,
+  //so that count isn't compared.
+  if (totals.m_SmallBoxHits != expectedTotals.m_SmallBoxHits || totals.m_LargeBoxHits != expectedTotals.m_LargeBoxHits ||
+    totals.m_ClosestRayTSum != expectedTotals.m_ClosestRayTSum || totals.m_AllRayHits != expectedTotals.m_AllRayHits ||
+    totals.m_IntertreePairs != expectedTotals.m_IntertreePairs)
+    printf("  %-8s RESULTS DIFFER FROM THE BINARY TREE\n", name);
+  wideTree.Dispose(pool);
+}
+
+void RunWideTreeBenchmark(int32_t leafCount, int32_t queryCount, uint32_t seed)
+{
+  assert(leafCount > 0 && queryCount > 0);
+  BufferPool pool;
+  auto otherLeafCount = glm::max(1, leafCount / 4);
+  BenchmarkScene scene(pool, leafCount, otherLeafCount);
+  CreateScene(leafCount, otherLeafCount, queryCount, seed, pool, scene);
+  printf("Wide tree benchmark: %d leaves, %d queries of each kind, %d leaves in the intertree query's other tree; times are per query\n",
+    leafCount, queryCount, scene.m_OtherTree.m_LeafCount);
+  BenchmarkTotals binaryTotals;
+  RunQueries("binary", BinaryTreeQueries{ scene.m_Tree }, scene, binaryTotals);
+  printf("  %-8s hits: box small %lld large %lld, rays closest %lld all %lld, intertree pairs %lld\n", "", (long long)binaryTotals.m_SmallBoxHits,
+    (long long)binaryTotals.m_LargeBoxHits, (long long)binaryTotals.m_ClosestRayHits, (long long)binaryTotals.m_AllRayHits, (long long)binaryTotals.m_IntertreePairs);
+  RunWideQueries<4>("wide 4", scene, pool, binaryTotals);
+  RunWideQueries<8>("wide 8", scene, pool, binaryTotals);
+  DisposeScene(pool, scene);
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+//Measures box query, ray cast and intertree throughput of a binary Tree against its WideTree4 and WideTree8 copies on leafCount random boxes, and prints one line
+//per tree. Every wide query's results are checked against the binary tree's. Meant to be run from a release build; width 8 only gets its SIMD node
+//tests when AVX is enabled, and runs the scalar fallback otherwise.
+void RunWideTreeBenchmark(int32_t leafCount = 100000, int32_t queryCount = 100000, uint32_t seed = 1);